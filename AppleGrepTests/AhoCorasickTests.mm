@@ -0,0 +1,74 @@
+#import <XCTest/XCTest.h>
+
+#include <string>
+#include <vector>
+
+#include "MatchTestSupport.hpp"
+#include "aho_corasick.hpp"
+
+namespace {
+
+// Every occurrence of every pattern, in the order findAll() promises
+NSString* naiveFindAll(const std::vector<std::string>& patterns, const std::string& text) {
+    std::vector<Match> matches;
+    for (size_t i = 0; i < text.size(); ++i) {
+        for (uint32_t id = 0; id < patterns.size(); ++id) {
+            const std::string& pattern = patterns[id];
+            if (!pattern.empty() && text.compare(i, pattern.size(), pattern) == 0) {
+                matches.push_back({i, id});
+            }
+        }
+    }
+    return describeMatches(matches);
+}
+
+} // namespace
+
+@interface AhoCorasickTests : XCTestCase
+@end
+
+@implementation AhoCorasickTests
+
+- (void)testOverlappingAndNestedPatterns {
+    const std::vector<std::string> patterns = {"he", "she", "his", "hers", "e"};
+    const std::string text = "ushers and his sheep";
+    AhoCorasickMatcher matcher(patterns, false);
+    XCTAssertEqualObjects(findAllMatches(matcher, text), naiveFindAll(patterns, text));
+}
+
+- (void)testDuplicatePatternsReportEveryId {
+    AhoCorasickMatcher matcher({"abc", "b", "abc"}, false);
+    XCTAssertEqualObjects(findAllMatches(matcher, "xabcx"), @"1:0 1:2 2:1");
+}
+
+- (void)testRangeKeepsMatchesStartingInside {
+    const std::string text = "needle needle needle";
+    AhoCorasickMatcher matcher({"needle"}, false);
+    std::vector<Match> matches;
+    matcher.findAll(text.data(), text.size(), 3, 10, matches);
+    XCTAssertEqualObjects(describeMatches(matches), @"7:0");
+}
+
+- (void)testFoldCase {
+    AhoCorasickMatcher matcher({"Error", "WARN"}, true);
+    XCTAssertEqualObjects(findAllMatches(matcher, "error: warn ERROR"), @"0:0 7:1 12:0");
+}
+
+// With every byte value in the set no byte is left for the shared unused
+// class, so the alphabet has 257 classes. Deep states whose children
+// include 0xff must still be found by the sparse child search.
+- (void)testAllByteValues {
+    std::vector<std::string> patterns;
+    for (int c = 0; c < 256; ++c) patterns.push_back(std::string(3, static_cast<char>(c)));
+    patterns.push_back("abcdefg\xff" "h");
+    patterns.push_back("abcdefgA");
+    patterns.push_back("\xfe\xff\xfe\xff\xfe\xff");
+
+    const std::string text = "xx abcdefgA abcdefg\xff" "h yy\n"
+                             "\xfe\xff\xfe\xff\xfe\xff\xff\xff\xff\n\n\n";
+    AhoCorasickMatcher matcher(patterns, false);
+    XCTAssertEqualObjects(findAllMatches(matcher, text), naiveFindAll(patterns, text));
+    XCTAssertEqualObjects(findAllMatches(matcher, "abcdefgA abcdefg\xff" "h"), @"0:257 9:256");
+}
+
+@end
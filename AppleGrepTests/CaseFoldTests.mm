@@ -0,0 +1,91 @@
+#import <XCTest/XCTest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MatchTestSupport.hpp"
+#include "case_fold.hpp"
+#include "regex_matcher.hpp"
+#include "unicode_fold_matcher.hpp"
+
+namespace {
+
+NSString* findFolded(const std::vector<std::string>& patterns, const std::string& text) {
+    std::unique_ptr<PatternMatcher> matcher = compileFoldedLiterals(patterns);
+    return findAllMatches(*matcher, text);
+}
+
+// The members of `code_point`'s orbit, in the order simpleFold() visits them
+std::vector<uint32_t> orbit(uint32_t code_point) {
+    std::vector<uint32_t> members = {code_point};
+    for (uint32_t next = simpleFold(code_point); next != code_point; next = simpleFold(next)) {
+        members.push_back(next);
+    }
+    return members;
+}
+
+} // namespace
+
+@interface CaseFoldTests : XCTestCase
+@end
+
+@implementation CaseFoldTests
+
+- (void)testSimpleFoldOrbits {
+    XCTAssertTrue(orbit('k') == std::vector<uint32_t>({'k', 0x212A, 'K'}));
+    XCTAssertTrue(orbit(0x3C3) == std::vector<uint32_t>({0x3C3, 0x3A3, 0x3C2}));
+    XCTAssertTrue(orbit('1') == std::vector<uint32_t>({'1'}));
+    XCTAssertEqual(foldCanonical(0x212A), foldCanonical('k'));
+    XCTAssertEqual(foldCanonical(0x1E9E), foldCanonical(0xDF));
+    XCTAssertNotEqual(foldCanonical('s'), foldCanonical(0xDF));
+}
+
+- (void)testUtf8Decoding {
+    uint32_t code_point;
+    XCTAssertEqual(decodeUtf8(reinterpret_cast<const unsigned char*>("\xe2\x84\xaa"), 3, code_point), 3u);
+    XCTAssertEqual(code_point, 0x212Au);
+
+    // Truncated and stray continuation bytes decode one byte at a time
+    XCTAssertEqual(decodeUtf8(reinterpret_cast<const unsigned char*>("\xe2\x84"), 2, code_point), 1u);
+    XCTAssertEqual(code_point, kInvalidUtf8 + 0xe2);
+    XCTAssertEqual(decodeUtf8(reinterpret_cast<const unsigned char*>("\x84"), 1, code_point), 1u);
+    XCTAssertEqual(code_point, kInvalidUtf8 + 0x84);
+
+    std::string encoded;
+    appendUtf8(0x212A, encoded);
+    appendUtf8(kInvalidUtf8 + 0xff, encoded);
+    XCTAssertTrue(encoded == "\xe2\x84\xaa\xff");
+}
+
+- (void)testAsciiPatternsFoldAscii {
+    XCTAssertEqualObjects(findFolded({"Error"}, "ERROR error eRRoR"), @"0:0 6:0 12:0");
+    // An ASCII letter only matches its two ASCII cases
+    XCTAssertEqualObjects(findFolded({"k"}, "K \xe2\x84\xaa k"), @"0:0 6:0");
+}
+
+// A match may be longer or shorter in bytes than the pattern
+- (void)testNonAsciiPatternsMatchTheirOrbit {
+    const std::string kelvin = "\xe2\x84\xaa";
+    XCTAssertEqualObjects(findFolded({kelvin + "elvin"}, "kelvin " + kelvin + "ELVIN KELVIN"),
+                          @"0:0 7:0 16:0");
+    // Final sigma, capital and small sigma are one orbit
+    XCTAssertEqualObjects(findFolded({"\xce\xa3\xce\x91\xce\xa3"},
+                                     "\xcf\x83\xce\xb1\xcf\x82 \xce\xa3\xce\xb1\xcf\x83"),
+                          @"0:0 7:0");
+    XCTAssertEqualObjects(findFolded({"stra\xc3\x9f" "e"}, "STRA\xe1\xba\x9e" "E strasse"), @"0:0");
+}
+
+- (void)testMixedPatternSet {
+    XCTAssertEqualObjects(findFolded({"WARN", "\xc3\xa9t\xc3\xa9"}, "warn \xc3\x89T\xc3\x89 Warn"),
+                          @"0:0 5:1 11:0");
+}
+
+- (void)testRegexFoldsCharacters {
+    std::string error;
+    std::unique_ptr<PatternMatcher> matcher = compileRegexes({"^\xc3\xa9t\xc3\xa9+$"}, true, error);
+    XCTAssertTrue(matcher != nullptr);
+    XCTAssertEqualObjects(findAllMatches(*matcher, "\xc3\x89T\xc3\x89\xc3\xa9\nete\n"), @"0:0");
+}
+
+@end
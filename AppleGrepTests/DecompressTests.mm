@@ -0,0 +1,137 @@
+#import <XCTest/XCTest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "decompress.hpp"
+
+namespace {
+
+void appendLittle16(std::string& out, uint32_t value) {
+    out += static_cast<char>(value & 0xff);
+    out += static_cast<char>(value >> 8 & 0xff);
+}
+
+void appendLittle32(std::string& out, uint32_t value) {
+    appendLittle16(out, value & 0xffff);
+    appendLittle16(out, value >> 16);
+}
+
+// A gzip member header with `extra` as its extra field
+std::string gzipHeader(const std::string& extra) {
+    std::string header("\x1f\x8b\x08\x04\0\0\0\0\0\xff", 10);
+    appendLittle16(header, static_cast<uint32_t>(extra.size()));
+    return header + extra;
+}
+
+// One BGZF member holding `text`
+std::string bgzfMember(const std::string& text) {
+    std::string deflated(compressBound(static_cast<uLong>(text.size())) + 64, '\0');
+    z_stream stream = {};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    stream.avail_in = static_cast<uInt>(text.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&deflated[0]);
+    stream.avail_out = static_cast<uInt>(deflated.size());
+    deflate(&stream, Z_FINISH);
+    deflated.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    // The BC subfield holds the member's length less one
+    std::string extra("BC\x02\0", 4);
+    appendLittle16(extra, static_cast<uint32_t>(18 + deflated.size() + 8 - 1));
+    std::string member = gzipHeader(extra) + deflated;
+    appendLittle32(member, static_cast<uint32_t>(
+        crc32(0, reinterpret_cast<const Bytef*>(text.data()), static_cast<uInt>(text.size()))));
+    appendLittle32(member, static_cast<uint32_t>(text.size()));
+    return member;
+}
+
+// Everything `source` produces, or "error: ..." after what it produced
+std::string readAll(StreamSource& source) {
+    std::string text;
+    char buffer[4096];
+    std::string error;
+    for (;;) {
+        const ssize_t got = source.read(buffer, sizeof(buffer), error);
+        if (got < 0) return text + "error: " + error;
+        if (got == 0) return text;
+        text.append(buffer, static_cast<size_t>(got));
+    }
+}
+
+// `bytes` copied to the very end of a mapping whose next page is
+// inaccessible, so reading past them faults
+class GuardedBytes {
+public:
+    explicit GuardedBytes(const std::string& bytes) {
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        pages = (bytes.size() + page - 1) / page * page + page;
+        void* mapped = mmap(nullptr, pages, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (mapped == MAP_FAILED) return;
+        base = static_cast<char*>(mapped);
+        mprotect(base + pages - page, page, PROT_NONE);
+        data = base + pages - page - bytes.size();
+        memcpy(data, bytes.data(), bytes.size());
+        length = bytes.size();
+    }
+    ~GuardedBytes() {
+        if (base) munmap(base, pages);
+    }
+
+    char* data = nullptr;
+    size_t length = 0;
+
+private:
+    char* base = nullptr;
+    size_t pages = 0;
+};
+
+} // namespace
+
+@interface DecompressTests : XCTestCase
+@end
+
+@implementation DecompressTests
+
+- (void)testBgzfMembersDecodeInOrder {
+    const std::string input = bgzfMember("first line\n") + bgzfMember("second line\n") +
+                              bgzfMember("third line\n");
+    Compression compression;
+    std::string error;
+    std::unique_ptr<StreamSource> source =
+        openDecompressed(input.data(), input.size(), compression, error);
+    XCTAssertTrue(source != nullptr);
+    XCTAssertTrue(compression == Compression::Gzip);
+    XCTAssertTrue(readAll(*source) == "first line\nsecond line\nthird line\n");
+}
+
+// A member cut off just after its BC subfield header: the subfield's
+// length must not be read past the end of the input, and the member is left
+// to the streaming decoder to reject
+- (void)testTruncatedBgzfHeaderAtEndOfInput {
+    std::string extra("XY\x02\0zz", 6);
+    extra += std::string("BC\x02\0", 4);
+    const std::string truncated = gzipHeader(extra);
+    XCTAssertEqual(truncated.size(), 22u);
+
+    GuardedBytes input(bgzfMember("kept\n") + truncated);
+    XCTAssertTrue(input.data != nullptr);
+    Compression compression;
+    std::string error;
+    std::unique_ptr<StreamSource> source =
+        openDecompressed(input.data, input.length, compression, error);
+    XCTAssertTrue(source != nullptr);
+    const std::string result = readAll(*source);
+    const std::string expected_error = "error: truncated gzip input";
+    XCTAssertTrue(result.size() >= expected_error.size() &&
+                  result.compare(result.size() - expected_error.size(), std::string::npos,
+                                 expected_error) == 0);
+}
+
+@end
@@ -0,0 +1,234 @@
+#import <XCTest/XCTest.h>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "glob_set.hpp"
+#include "path_filter.hpp"
+
+namespace {
+
+// The id GlobSet::match() returns for `path`, or -1 for no match
+long matchId(const GlobSet& globs, std::string_view path, bool is_directory = false) {
+    const uint32_t id = globs.match(path, is_directory);
+    return id == GlobSet::kNoMatch ? -1 : static_cast<long>(id);
+}
+
+// A temporary directory holding the ignore files of a walk root, removed
+// again on destruction
+class IgnoreDirectory {
+public:
+    IgnoreDirectory() {
+        const char* tmp = std::getenv("TMPDIR");
+        path = std::string(tmp && *tmp ? tmp : "/tmp");
+        if (path.back() != '/') path += '/';
+        path += "applegrep-glob-XXXXXX";
+        if (!mkdtemp(&path[0])) path.clear();
+    }
+    ~IgnoreDirectory() {
+        for (const std::string& name : names) unlink((path + "/" + name).c_str());
+        for (auto it = subdirectories.rbegin(); it != subdirectories.rend(); ++it) {
+            rmdir((path + "/" + *it).c_str());
+        }
+        if (!path.empty()) rmdir(path.c_str());
+    }
+
+    void write(const std::string& name, const std::string& text) {
+        const size_t slash = name.rfind('/');
+        if (slash != std::string::npos && mkdir((path + "/" + name.substr(0, slash)).c_str(), 0700) == 0) {
+            subdirectories.push_back(name.substr(0, slash));
+        }
+        const int fd = open((path + "/" + name).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) return;
+        if (::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size())) {
+            names.push_back(name);
+        }
+        close(fd);
+    }
+
+    // The layer for `directory` (relative, "" for the root) under `parent`,
+    // as the walker enters it
+    std::shared_ptr<const IgnoreLayer> enter(const PathFilter& filter, const std::string& directory,
+                                             const std::shared_ptr<const IgnoreLayer>& parent) const {
+        const std::string full = directory.empty() ? path : path + "/" + directory;
+        const int fd = open(full.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) return parent;
+        const bool has_gitignore = faccessat(fd, ".gitignore", F_OK, 0) == 0;
+        const bool has_ignore = faccessat(fd, ".ignore", F_OK, 0) == 0;
+        std::shared_ptr<const IgnoreLayer> layer =
+            filter.enter(fd, full.size() + 1, has_gitignore, has_ignore, parent);
+        close(fd);
+        return layer;
+    }
+
+    // Whether the walker skips `relative`, a path below the root
+    bool skips(const PathFilter& filter, const std::string& relative, bool is_directory,
+               const IgnoreLayer* layer) const {
+        return filter.skip(path + "/" + relative, path.size() + 1, is_directory, layer);
+    }
+
+    bool valid() const { return !path.empty(); }
+
+private:
+    std::string path;
+    std::vector<std::string> names;
+    std::vector<std::string> subdirectories;
+};
+
+} // namespace
+
+@interface GlobTests : XCTestCase
+@end
+
+@implementation GlobTests
+
+// A glob without '/' matches the last component at any depth; with one it
+// matches the whole path, and a leading '/' only anchors it
+- (void)testSlashDecidesWhatIsMatched {
+    GlobSet globs;
+    globs.add("*.o", false);
+    globs.add("/build", false);
+    globs.add("doc/*.txt", false);
+    globs.finish();
+
+    XCTAssertEqual(matchId(globs, "main.o"), 0);
+    XCTAssertEqual(matchId(globs, "src/lib/main.o"), 0);
+    XCTAssertEqual(matchId(globs, "main.oo"), -1);
+    XCTAssertEqual(matchId(globs, "build"), 1);
+    XCTAssertEqual(matchId(globs, "src/build"), -1);
+    XCTAssertEqual(matchId(globs, "doc/a.txt"), 2);
+    XCTAssertEqual(matchId(globs, "doc/x/a.txt"), -1);
+    XCTAssertEqual(matchId(globs, "src/doc/a.txt"), -1);
+}
+
+- (void)testWildcardsInTheMiddle {
+    GlobSet globs;
+    globs.add("test_*_data", false);
+    globs.add("v?.[0-9]", false);
+    globs.add("a\\*b", false);
+    globs.finish();
+
+    XCTAssertEqual(matchId(globs, "src/test_unit_data"), 0);
+    XCTAssertEqual(matchId(globs, "test__data"), 0);
+    XCTAssertEqual(matchId(globs, "test_a/b_data"), -1);
+    XCTAssertEqual(matchId(globs, "v1.2"), 1);
+    XCTAssertEqual(matchId(globs, "v12.2"), -1);
+    XCTAssertEqual(matchId(globs, "v1.x"), -1);
+    XCTAssertEqual(matchId(globs, "a*b"), 2);
+    XCTAssertEqual(matchId(globs, "axb"), -1);
+}
+
+- (void)testDoubleStar {
+    GlobSet globs;
+    globs.add("**/cache", false);
+    globs.add("src/**/gen", false);
+    globs.add("out/**", false);
+    globs.finish();
+
+    XCTAssertEqual(matchId(globs, "cache"), 0);
+    XCTAssertEqual(matchId(globs, "a/b/cache"), 0);
+    XCTAssertEqual(matchId(globs, "src/gen"), 1);
+    XCTAssertEqual(matchId(globs, "src/a/b/gen"), 1);
+    XCTAssertEqual(matchId(globs, "lib/src/gen"), -1);
+    XCTAssertEqual(matchId(globs, "out/x"), 2);
+    XCTAssertEqual(matchId(globs, "out/x/y.o"), 2);
+    XCTAssertEqual(matchId(globs, "out"), -1);
+}
+
+- (void)testHighestIdWinsAndDirectoryOnly {
+    GlobSet globs;
+    globs.add("*.log", false);
+    globs.add("debug.log", false);
+    globs.add("tmp", true);
+    globs.finish();
+
+    XCTAssertEqual(matchId(globs, "x.log"), 0);
+    XCTAssertEqual(matchId(globs, "a/debug.log"), 1);
+    XCTAssertEqual(matchId(globs, "tmp", true), 2);
+    XCTAssertEqual(matchId(globs, "tmp", false), -1);
+}
+
+// The last matching --glob wins; with includes, unmatched files are
+// skipped but directories are still walked
+- (void)testGlobOverrides {
+    PathFilter filter;
+    filter.setIgnoreFiles(false);
+    filter.addGlob("*.cpp");
+    filter.addGlob("!test_*");
+    filter.finish();
+
+    XCTAssertFalse(filter.skip("root/a.cpp", 5, false, nullptr));
+    XCTAssertTrue(filter.skip("root/test_a.cpp", 5, false, nullptr));
+    XCTAssertTrue(filter.skip("root/a.h", 5, false, nullptr));
+    XCTAssertFalse(filter.skip("root/src", 5, true, nullptr));
+    XCTAssertTrue(filter.skip("root/test_dir", 5, true, nullptr));
+}
+
+- (void)testIgnoreFileRules {
+    IgnoreDirectory root;
+    XCTAssertTrue(root.valid());
+    root.write(".gitignore", "# build output\n*.log\n!keep.log\nbuild/\n\\#notes\ntrailing \n");
+    PathFilter filter;
+    filter.finish();
+    std::shared_ptr<const IgnoreLayer> layer = root.enter(filter, "", nullptr);
+    XCTAssertTrue(layer != nullptr);
+
+    XCTAssertTrue(root.skips(filter, "x.log", false, layer.get()));
+    XCTAssertTrue(root.skips(filter, "a/b/x.log", false, layer.get()));
+    XCTAssertFalse(root.skips(filter, "keep.log", false, layer.get()));
+    XCTAssertTrue(root.skips(filter, "build", true, layer.get()));
+    XCTAssertFalse(root.skips(filter, "build", false, layer.get()));
+    XCTAssertTrue(root.skips(filter, "#notes", false, layer.get()));
+    XCTAssertFalse(root.skips(filter, "# build output", false, layer.get()));
+    XCTAssertTrue(root.skips(filter, "trailing", false, layer.get()));
+    XCTAssertFalse(root.skips(filter, "main.c", false, layer.get()));
+}
+
+// The deepest ignore file with a matching rule decides, and .ignore beats
+// .gitignore in the same directory
+- (void)testDeeperAndIgnoreFilesWin {
+    IgnoreDirectory root;
+    XCTAssertTrue(root.valid());
+    root.write(".gitignore", "*.log\nsecret\n");
+    root.write(".ignore", "!secret\n");
+    root.write("sub/.gitignore", "!*.log\n/local\n");
+    PathFilter filter;
+    filter.finish();
+    std::shared_ptr<const IgnoreLayer> top = root.enter(filter, "", nullptr);
+    std::shared_ptr<const IgnoreLayer> sub = root.enter(filter, "sub", top);
+
+    XCTAssertFalse(root.skips(filter, "secret", false, top.get()));
+    XCTAssertTrue(root.skips(filter, "x.log", false, top.get()));
+    XCTAssertFalse(root.skips(filter, "sub/x.log", false, sub.get()));
+    XCTAssertTrue(root.skips(filter, "sub/local", false, sub.get()));
+    XCTAssertFalse(root.skips(filter, "local", false, top.get()));
+    XCTAssertFalse(root.skips(filter, "sub/deeper/local", false, sub.get()));
+}
+
+// A matching --glob include is kept whatever the ignore files say
+- (void)testGlobBeatsIgnoreFiles {
+    IgnoreDirectory root;
+    XCTAssertTrue(root.valid());
+    root.write(".gitignore", "*.log\n*.tmp\n");
+    PathFilter filter;
+    filter.addGlob("!*.c");
+    filter.addGlob("*.log");
+    filter.finish();
+    std::shared_ptr<const IgnoreLayer> layer = root.enter(filter, "", nullptr);
+
+    XCTAssertFalse(root.skips(filter, "x.log", false, layer.get()));
+    XCTAssertTrue(root.skips(filter, "x.tmp", false, layer.get()));
+    XCTAssertTrue(root.skips(filter, "x.c", false, layer.get()));
+
+    filter.setIgnoreFiles(false);
+    XCTAssertTrue(root.enter(filter, "", nullptr) == nullptr);
+}
+
+@end
@@ -0,0 +1,25 @@
+#pragma once
+
+#import <Foundation/Foundation.h>
+
+#include <string>
+#include <vector>
+
+#include "pattern_matcher.hpp"
+
+// "position:id" for each match, so a failing assertion shows the whole list
+inline NSString* describeMatches(const std::vector<Match>& matches) {
+    std::string text;
+    for (const Match& match : matches) {
+        if (!text.empty()) text += ' ';
+        text += std::to_string(match.position) + ":" + std::to_string(match.pattern_id);
+    }
+    return @(text.c_str());
+}
+
+// Every match of `matcher` in the whole of `text`
+inline NSString* findAllMatches(const PatternMatcher& matcher, const std::string& text) {
+    std::vector<Match> matches;
+    matcher.findAll(text.data(), text.size(), 0, text.size(), matches);
+    return describeMatches(matches);
+}
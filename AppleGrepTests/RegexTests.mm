@@ -0,0 +1,146 @@
+#import <XCTest/XCTest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MatchTestSupport.hpp"
+#include "lazy_dfa.hpp"
+#include "regex_matcher.hpp"
+
+namespace {
+
+// "line:id" (lines numbered from 1) for each line the regexes match, or the
+// compile error
+NSString* matchingLines(const std::vector<std::string>& patterns, const std::string& text,
+                        bool fold_case = false) {
+    std::string error;
+    std::unique_ptr<PatternMatcher> matcher = compileRegexes(patterns, fold_case, error);
+    if (!matcher) return @(("error: " + error).c_str());
+
+    std::vector<Match> matches;
+    matcher->findAll(text.data(), text.size(), 0, text.size(), matches);
+    std::string lines;
+    for (const Match& match : matches) {
+        const size_t line = 1 + std::count(text.begin(), text.begin() + match.position, '\n');
+        if (!lines.empty()) lines += ' ';
+        lines += std::to_string(line) + ":" + std::to_string(match.pattern_id);
+    }
+    return @(lines.c_str());
+}
+
+bool parses(const std::string& pattern) {
+    RegexNode root;
+    std::string error;
+    return parseRegex(pattern, false, root, error);
+}
+
+} // namespace
+
+@interface RegexTests : XCTestCase
+@end
+
+@implementation RegexTests
+
+- (void)testAlternationAndGrouping {
+    const std::string text = "grey\ngray\ngriy\ngr\n";
+    XCTAssertEqualObjects(matchingLines({"gr(e|a)y"}, text), @"1:0 2:0");
+    XCTAssertEqualObjects(matchingLines({"gr(e|a|)y?$"}, text), @"1:0 2:0 4:0");
+}
+
+- (void)testRepetition {
+    const std::string text = "ab\naab\naaab\naaaab\nb\n";
+    XCTAssertEqualObjects(matchingLines({"^a{2,3}b"}, text), @"2:0 3:0");
+    XCTAssertEqualObjects(matchingLines({"^a+b"}, text), @"1:0 2:0 3:0 4:0");
+    XCTAssertEqualObjects(matchingLines({"^a*b$"}, text), @"1:0 2:0 3:0 4:0 5:0");
+    XCTAssertEqualObjects(matchingLines({"^a?b"}, text), @"1:0 5:0");
+    XCTAssertEqualObjects(matchingLines({"^a{4,}b"}, text), @"4:0");
+}
+
+- (void)testBracketsAndShorthands {
+    const std::string text = "id=42\nid=x\nname: bob\n\tindented\n";
+    XCTAssertEqualObjects(matchingLines({"id=[[:digit:]]+"}, text), @"1:0");
+    XCTAssertEqualObjects(matchingLines({"id=\\d"}, text), @"1:0");
+    XCTAssertEqualObjects(matchingLines({"id=[^0-9]"}, text), @"2:0");
+    XCTAssertEqualObjects(matchingLines({"^\\w+:"}, text), @"3:0");
+    XCTAssertEqualObjects(matchingLines({"^\\s"}, text), @"4:0");
+    XCTAssertEqualObjects(matchingLines({"^[]a-]"}, "]x\n-y\nz\n"), @"1:0 2:0");
+}
+
+- (void)testAnchorsHoldPerLine {
+    const std::string text = "start end\nend start\n\n";
+    XCTAssertEqualObjects(matchingLines({"^start"}, text), @"1:0");
+    XCTAssertEqualObjects(matchingLines({"start$"}, text), @"2:0");
+    XCTAssertEqualObjects(matchingLines({"^$"}, text), @"3:0");
+    XCTAssertEqualObjects(matchingLines({"end.start"}, text), @"2:0");
+}
+
+// As in GNU grep -E, a stray ')', a leading '*' and a '{' that starts no
+// bound are ordinary characters
+- (void)testLiteralSpecials {
+    const std::string text = "a)b\nab\n*a\nx{y\n";
+    XCTAssertEqualObjects(matchingLines({"a)b"}, text), @"1:0");
+    XCTAssertEqualObjects(matchingLines({"*a"}, text), @"3:0");
+    XCTAssertEqualObjects(matchingLines({"x{y"}, text), @"4:0");
+}
+
+// Each line is reported once, with the first pattern that matches in it
+- (void)testSeveralPatterns {
+    const std::string text = "ERROR disk full\nWARN slow\nERROR WARN both\nok\n";
+    XCTAssertEqualObjects(matchingLines({"WARN", "ERROR [a-z]+"}, text), @"1:1 2:0 3:0");
+    XCTAssertEqualObjects(matchingLines({"", "ok"}, text), @"4:1");
+}
+
+// The literal prefilter must not change which lines match
+- (void)testPrefilterAgreesWithPlainDfa {
+    const std::string text = "x timeout=30\ntimeout=\nERROR a timeout=7\nERROR b\n";
+    XCTAssertEqualObjects(matchingLines({"ERROR .* timeout=\\d+"}, text), @"3:0");
+    XCTAssertEqualObjects(matchingLines({"(E|e)RROR.*(t|T)imeout=[0-9]+"}, text), @"3:0");
+}
+
+- (void)testFoldCase {
+    const std::string text = "Error\nERROR\nerr0r\n";
+    XCTAssertEqualObjects(matchingLines({"^error$"}, text, true), @"1:0 2:0");
+    XCTAssertEqualObjects(matchingLines({"^[e]RR"}, text, true), @"1:0 2:0 3:0");
+}
+
+- (void)testSyntaxErrors {
+    XCTAssertTrue(parses("a(b|c)*d{2,3}"));
+    XCTAssertFalse(parses("a(b"));
+    XCTAssertFalse(parses("[abc"));
+    XCTAssertFalse(parses("a{3,2}"));
+    XCTAssertFalse(parses("a{1001}"));
+
+    std::string error;
+    XCTAssertTrue(compileRegexes({"ok", "(("}, false, error) == nullptr);
+    XCTAssertFalse(error.empty());
+}
+
+// A cache too small for the DFA is dropped and rebuilt mid-line; the
+// answers must stay those of an unbounded cache
+- (void)testCacheFlushKeepsResults {
+    RegexNode root;
+    std::string error;
+    XCTAssertTrue(parseRegex("a[ab]{10}$", false, root, error));
+    Nfa nfa;
+    nfa.add(root, 0);
+    nfa.finish();
+
+    LazyDfa small(nfa, 4 << 10);
+    LazyDfa large(nfa, 64 << 20);
+    uint64_t state = 1;
+    for (int line = 0; line < 200; ++line) {
+        std::string text;
+        for (int i = 0; i < 300; ++i) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            text += (state >> 63) ? 'a' : 'b';
+        }
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+        XCTAssertEqual(small.matchLine(bytes, text.size()), large.matchLine(bytes, text.size()));
+    }
+    XCTAssertGreaterThan(small.flushes(), 0u);
+    XCTAssertEqual(large.flushes(), 0u);
+}
+
+@end
@@ -0,0 +1,226 @@
+#include "aho_corasick.hpp"
+
+#include <algorithm>
+
+#include "case_fold.hpp"
+
+namespace {
+
+// States within this depth of the root get dense rows, as long as the rows
+// fit the budget; they absorb nearly all transitions on non-matching text
+constexpr size_t kDenseDepth = 4;
+constexpr size_t kDenseBudgetBytes = 8 << 20;
+
+// Set on dense-row entries whose target state reports at least one pattern
+constexpr uint32_t kMatchFlag = 1u << 31;
+
+std::vector<std::string> foldAll(const std::vector<std::string>& patterns) {
+    std::vector<std::string> folded;
+    folded.reserve(patterns.size());
+    for (const std::string& pattern : patterns) folded.push_back(foldAscii(pattern));
+    return folded;
+}
+
+} // namespace
+
+AhoCorasickMatcher::AhoCorasickMatcher(const std::vector<std::string>& patterns, bool fold_case)
+    : AhoCorasickMatcher(fold_case ? foldAll(patterns) : patterns) {
+    if (fold_case) {
+        for (int c = 'A'; c <= 'Z'; ++c) byte_classes[c] = byte_classes[c | 0x20];
+    }
+}
+
+AhoCorasickMatcher::AhoCorasickMatcher(const std::vector<std::string>& patterns) {
+    // 1. Byte classes: every byte that occurs in a pattern is its own class,
+    // numbered in byte order so sorted patterns stay sorted by class; the
+    // remaining bytes share class 0
+    bool seen[256] = {};
+    for (const std::string& pattern : patterns) {
+        for (unsigned char c : pattern) seen[c] = true;
+        max_length = std::max(max_length, pattern.size());
+    }
+    class_count = 1;
+    for (int c = 0; c < 256; ++c) {
+        byte_classes[c] = seen[c] ? static_cast<uint16_t>(class_count++) : 0;
+    }
+
+    // 2. Build the trie from the sorted patterns. Insertion in sorted order
+    // only ever extends the path of the previous pattern, so each node's
+    // children are created in class order and no per-node search is needed.
+    std::vector<uint32_t> order;
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        if (!patterns[id].empty()) order.push_back(static_cast<uint32_t>(id));
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return patterns[a] < patterns[b];
+    });
+
+    pattern_length.assign(patterns.size(), 0);
+    same_pattern.assign(patterns.size(), kNone);
+
+    std::vector<uint32_t> first_child(1, kNone), next_sibling(1, kNone);
+    std::vector<uint16_t> node_class(1, 0);
+    std::vector<uint32_t> node_output(1, kNone);
+    std::vector<uint32_t> path(1, 0);              // node at each depth of the previous pattern
+    std::vector<uint32_t> path_last_child(1, kNone);
+    const std::string* previous = nullptr;
+    uint32_t previous_id = kNone;
+
+    for (uint32_t id : order) {
+        const std::string& pattern = patterns[id];
+        pattern_length[id] = static_cast<uint32_t>(pattern.size());
+
+        size_t common = 0;
+        if (previous) {
+            const size_t limit = std::min(previous->size(), pattern.size());
+            while (common < limit && (*previous)[common] == pattern[common]) ++common;
+        }
+
+        uint32_t node = path[common];
+        path.resize(pattern.size() + 1);
+        path_last_child.resize(pattern.size() + 1, kNone);
+        for (size_t depth = common; depth < pattern.size(); ++depth) {
+            const uint32_t child = static_cast<uint32_t>(first_child.size());
+            first_child.push_back(kNone);
+            next_sibling.push_back(kNone);
+            node_class.push_back(byte_classes[static_cast<unsigned char>(pattern[depth])]);
+            node_output.push_back(kNone);
+
+            if (path_last_child[depth] == kNone) {
+                first_child[node] = child;
+            } else {
+                next_sibling[path_last_child[depth]] = child;
+            }
+            path_last_child[depth] = child;
+            path_last_child[depth + 1] = kNone;
+            node = child;
+            path[depth + 1] = child;
+        }
+
+        // Identical patterns end at the same node; chain them in id order
+        if (node_output[node] == kNone) {
+            node_output[node] = id;
+        } else {
+            same_pattern[previous_id] = id;
+        }
+        previous = &pattern;
+        previous_id = id;
+    }
+
+    // 3. Renumber breadth-first: siblings become contiguous and every state
+    // comes after all states of smaller depth
+    const size_t state_count = first_child.size();
+    child_begin.assign(state_count + 1, 0);
+    state_class.assign(state_count, 0);
+    output.assign(state_count, kNone);
+    std::vector<uint32_t> bfs(1, 0);
+    size_t shallow = 0;
+    {
+        std::vector<uint8_t> depth(1, 0);
+        for (size_t s = 0; s < bfs.size(); ++s) {
+            const uint32_t node = bfs[s];
+            state_class[s] = node_class[node];
+            output[s] = node_output[node];
+            child_begin[s] = static_cast<uint32_t>(bfs.size());
+            if (depth[s] <= kDenseDepth) shallow = s + 1;
+            for (uint32_t child = first_child[node]; child != kNone; child = next_sibling[child]) {
+                bfs.push_back(child);
+                depth.push_back(static_cast<uint8_t>(std::min<size_t>(depth[s] + 1, 255)));
+            }
+        }
+        child_begin[state_count] = static_cast<uint32_t>(state_count);
+    }
+    first_child = {};
+    next_sibling = {};
+    node_class = {};
+    node_output = {};
+    bfs = {};
+
+    // 4. Failure links, dictionary links and dense rows, in one breadth-first
+    // sweep: everything a state needs comes from states numbered before it
+    dense_count = std::max<size_t>(1, std::min(shallow, kDenseBudgetBytes / (class_count * sizeof(uint32_t))));
+    dense.assign(dense_count * class_count, 0);
+    fail.assign(state_count, 0);
+    dict_link.assign(state_count, kNone);
+
+    auto reports = [&](uint32_t state) {
+        return output[state] != kNone || dict_link[state] != kNone;
+    };
+
+    for (uint32_t s = 0; s < state_count; ++s) {
+        for (uint32_t child = child_begin[s]; child < child_begin[s + 1]; ++child) {
+            const uint32_t target = s == 0 ? 0 : next(fail[s], state_class[child]) & ~kMatchFlag;
+            fail[child] = target;
+            dict_link[child] = output[target] != kNone ? target : dict_link[target];
+        }
+        if (s < dense_count) {
+            uint32_t* row = &dense[s * class_count];
+            for (size_t c = 0; c < class_count; ++c) {
+                row[c] = s == 0 ? 0 : dense[fail[s] * class_count + c];
+            }
+            for (uint32_t child = child_begin[s]; child < child_begin[s + 1]; ++child) {
+                row[state_class[child]] = child | (reports(child) ? kMatchFlag : 0);
+            }
+        }
+    }
+}
+
+uint32_t AhoCorasickMatcher::next(uint32_t state, uint16_t byte_class) const {
+    for (;;) {
+        if (state < dense_count) return dense[state * class_count + byte_class];
+
+        // Children are sorted by class
+        const uint16_t* begin = state_class.data() + child_begin[state];
+        const uint16_t* end = state_class.data() + child_begin[state + 1];
+        const uint16_t* hit = std::lower_bound(begin, end, byte_class);
+        if (hit != end && *hit == byte_class) {
+            const uint32_t child = static_cast<uint32_t>(hit - state_class.data());
+            return child | (output[child] != kNone || dict_link[child] != kNone ? kMatchFlag : 0);
+        }
+        state = fail[state];
+    }
+}
+
+void AhoCorasickMatcher::findAll(const char* text, size_t text_length, size_t from, size_t to,
+                                 std::vector<Match>& matches) const {
+    if (max_length == 0 || from >= to) return;
+
+    // Matches starting before `to` may end up to max_length - 1 bytes later
+    const size_t end = std::min(text_length, to + max_length - 1);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    const size_t first = matches.size();
+
+    const uint32_t* rows = dense.data();
+    uint32_t state = 0;
+    for (size_t i = from; i < end; ++i) {
+        const uint16_t byte_class = byte_classes[bytes[i]];
+        state = state < dense_count ? rows[state * class_count + byte_class]
+                                    : next(state, byte_class);
+        if (!(state & kMatchFlag)) continue;
+        state &= ~kMatchFlag;
+
+        // The state and every dictionary suffix of it end a pattern here
+        for (uint32_t t = output[state] != kNone ? state : dict_link[state];
+             t != kNone; t = dict_link[t]) {
+            for (uint32_t id = output[t]; id != kNone; id = same_pattern[id]) {
+                const size_t start = i + 1 - pattern_length[id];
+                if (start < to) matches.push_back({start, id});
+            }
+        }
+    }
+
+    // Found in order of end position; the contract is start position, then id
+    std::sort(matches.begin() + first, matches.end());
+}
+
+size_t AhoCorasickMatcher::memoryUsage() const {
+    return sizeof(*this) +
+           child_begin.capacity() * sizeof(uint32_t) +
+           state_class.capacity() * sizeof(uint16_t) +
+           fail.capacity() * sizeof(uint32_t) +
+           output.capacity() * sizeof(uint32_t) +
+           dict_link.capacity() * sizeof(uint32_t) +
+           dense.capacity() * sizeof(uint32_t) +
+           pattern_length.capacity() * sizeof(uint32_t) +
+           same_pattern.capacity() * sizeof(uint32_t);
+}
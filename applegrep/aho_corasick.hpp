@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pattern_matcher.hpp"
+
+// Aho-Corasick automaton for large literal sets (thousands to hundreds of
+// thousands of patterns). Every input byte is consumed exactly once.
+//
+// Layout, chosen to keep the hot part of the automaton in cache:
+//  - bytes are mapped to equivalence classes first; all bytes that occur in
+//    no pattern share one class, so rows are as narrow as the pattern
+//    alphabet rather than 256 wide;
+//  - states are numbered in breadth-first order, so a state's children are
+//    contiguous and all shallow states form a prefix of the numbering;
+//  - that prefix (the root and the states near it, where the scan spends
+//    most of its time) gets dense, fully resolved transition rows;
+//  - deeper states keep only their sparse child list and a failure link.
+//
+// With fold_case the automaton is built from the lower-cased patterns and
+// each upper-case letter is mapped to its lower-case byte class.
+class AhoCorasickMatcher : public PatternMatcher {
+public:
+    AhoCorasickMatcher(const std::vector<std::string>& patterns, bool fold_case);
+
+    const char* name() const override { return "aho-corasick"; }
+
+    void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                 std::vector<Match>& matches) const override;
+
+    size_t memoryUsage() const override;
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    explicit AhoCorasickMatcher(const std::vector<std::string>& patterns);
+
+    uint32_t next(uint32_t state, uint16_t byte_class) const;
+
+    // Up to 257 classes: every byte value plus the shared unused class
+    uint16_t byte_classes[256];
+    size_t class_count = 0;
+    size_t max_length = 0;
+
+    // Per state, in breadth-first order
+    std::vector<uint32_t> child_begin;   // children are [child_begin[s], child_begin[s + 1])
+    std::vector<uint16_t> state_class;   // class of the edge into each state
+    std::vector<uint32_t> fail;
+    std::vector<uint32_t> output;        // first pattern ending here, or kNone
+    std::vector<uint32_t> dict_link;     // nearest suffix state with an output
+
+    // Dense rows for states [0, dense_count)
+    size_t dense_count = 0;
+    std::vector<uint32_t> dense;
+
+    // Per pattern
+    std::vector<uint32_t> pattern_length;
+    std::vector<uint32_t> same_pattern;  // next id with an identical string
+};
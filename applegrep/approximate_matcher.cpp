@@ -0,0 +1,153 @@
+#include "approximate_matcher.hpp"
+
+#include <algorithm>
+
+#include "case_fold.hpp"
+#include "line_ranges.hpp"
+#include "multi_literal_matcher.hpp"
+
+namespace {
+
+// Pieces shorter than this match almost everywhere; Myers alone is faster
+constexpr size_t kMinPieceLength = 3;
+
+// Candidates are collected this many start positions at a time
+constexpr size_t kPrefilterWindow = 64 << 10;
+
+} // namespace
+
+ApproximateMatcher::ApproximateMatcher(const std::string& pattern, uint32_t max_errors,
+                                       bool fold_case, std::unique_ptr<PatternMatcher> prefilter)
+    : last_bit(uint64_t(1) << (pattern.size() - 1)),
+      pattern_length(static_cast<uint32_t>(pattern.size())),
+      max_errors(max_errors),
+      prefilter(std::move(prefilter)) {
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(pattern[i]);
+        peq[c] |= uint64_t(1) << i;
+        if (fold_case && isAsciiLetter(c)) peq[c ^ 0x20] |= uint64_t(1) << i;
+    }
+    engine_name = "myers";
+    if (this->prefilter) engine_name += std::string(" + ") + this->prefilter->name() + " prefilter";
+}
+
+void ApproximateMatcher::scanLine(const unsigned char* text, size_t begin, size_t end,
+                                  std::vector<Match>& matches) const {
+    // Column j of the vertical deltas is row j + 1 of the edit distance
+    // table against the text so far; the top row is all zeros (a match may
+    // start anywhere), so nothing is shifted into bit 0
+    uint64_t pv = ~uint64_t(0), mv = 0;
+    uint32_t score = pattern_length;
+
+    bool in_run = false;
+    uint32_t best_errors = 0;
+    size_t best_end = 0;
+    for (size_t j = begin; j < end; ++j) {
+        const uint64_t eq = peq[text[j]];
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last_bit) {
+            ++score;
+        } else if (mh & last_bit) {
+            --score;
+        }
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        if (score <= max_errors) {
+            if (!in_run || score < best_errors) {
+                best_errors = score;
+                best_end = j;
+            }
+            in_run = true;
+        } else if (in_run) {
+            matches.push_back({best_end, 0, best_errors});
+            in_run = false;
+        }
+    }
+    if (in_run) matches.push_back({best_end, 0, best_errors});
+}
+
+void ApproximateMatcher::findAll(const char* text, size_t text_length, size_t from, size_t to,
+                                 std::vector<Match>& matches) const {
+    // Lines starting in [from, to) belong to this range
+    size_t line = firstLineStart(text, text_length, from);
+    if (line >= to || line >= text_length) return;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+
+    if (!prefilter) {
+        while (line < to && line < text_length) {
+            const size_t line_end = lineEnd(text, text_length, line);
+            scanLine(bytes, line, line_end, matches);
+            line = line_end + 1;
+        }
+        return;
+    }
+
+    // Same scheme as RegexMatcher: run Myers on each line holding a piece,
+    // once per line
+    const size_t scan_end = lineEnd(text, text_length, to - 1);
+    std::vector<Match> candidates;
+    for (size_t window = line; window < scan_end; window += kPrefilterWindow) {
+        candidates.clear();
+        prefilter->findAll(text, text_length, window,
+                           std::min(scan_end, window + kPrefilterWindow), candidates);
+        for (const Match& candidate : candidates) {
+            if (candidate.position < line) continue;
+
+            const size_t line_start = lineStart(text, line, candidate.position);
+            const size_t line_end = lineEnd(text, text_length, candidate.position);
+            scanLine(bytes, line_start, line_end, matches);
+            line = line_end + 1;
+        }
+    }
+}
+
+size_t ApproximateMatcher::memoryUsage() const {
+    return sizeof(*this) + engine_name.capacity() + (prefilter ? prefilter->memoryUsage() : 0);
+}
+
+std::unique_ptr<PatternMatcher> compileApproximate(const std::vector<std::string>& patterns,
+                                                   uint32_t max_errors, bool fold_case,
+                                                   std::string& error) {
+    if (patterns.size() != 1 || patterns[0].empty()) {
+        error = "--max-errors takes exactly one non-empty pattern";
+        return nullptr;
+    }
+    const std::string& pattern = patterns[0];
+    if (pattern.size() > kApproximateMaxLength) {
+        error = "--max-errors patterns are limited to " + std::to_string(kApproximateMaxLength) +
+                " bytes";
+        return nullptr;
+    }
+    if (max_errors >= pattern.size()) {
+        // Deleting the whole pattern would match everywhere
+        error = "--max-errors must be less than the pattern length";
+        return nullptr;
+    }
+
+    // Cut the pattern into max_errors + 1 pieces; each edit touches at most
+    // one, so one piece occurs unchanged in any match
+    std::vector<std::string> pieces;
+    const size_t piece_count = max_errors + 1;
+    for (size_t i = 0; i < piece_count; ++i) {
+        const size_t begin = i * pattern.size() / piece_count;
+        const size_t end = (i + 1) * pattern.size() / piece_count;
+        pieces.push_back(pattern.substr(begin, end - begin));
+    }
+    std::unique_ptr<PatternMatcher> prefilter;
+    if (pattern.size() / piece_count >= kMinPieceLength) {
+        if (fold_case) {
+            for (std::string& piece : pieces) piece = foldAscii(piece);
+        }
+        std::sort(pieces.begin(), pieces.end());
+        pieces.erase(std::unique(pieces.begin(), pieces.end()), pieces.end());
+        prefilter = compileLiterals(pieces, fold_case);
+    }
+    return std::make_unique<ApproximateMatcher>(pattern, max_errors, fold_case,
+                                                std::move(prefilter));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pattern_matcher.hpp"
+
+// The pattern's column bits must fit in one machine word
+constexpr size_t kApproximateMaxLength = 64;
+
+// --max-errors: finds where the text matches the pattern with at most
+// max_errors insertions, deletions or substitutions, using Myers' bit-vector
+// edit distance (one 64-bit word per text byte). Matches do not cross lines.
+//
+// Every text position that ends a close enough match is one end; a run of
+// consecutive ends is reported once, at its best (fewest errors, then first)
+// end. Match::position is that end's last byte and Match::errors its edit
+// distance.
+//
+// With k errors, one of k + 1 pieces of the pattern occurs unchanged in
+// every match, so when the pieces are long enough the literal engine finds
+// candidate lines first and Myers only runs on those.
+//
+// With fold_case (-i) a pattern byte that is an ASCII letter also matches
+// its other case; other bytes, including UTF-8 sequences, match exactly.
+class ApproximateMatcher : public PatternMatcher {
+public:
+    ApproximateMatcher(const std::string& pattern, uint32_t max_errors, bool fold_case,
+                       std::unique_ptr<PatternMatcher> prefilter);
+
+    const char* name() const override { return engine_name.c_str(); }
+
+    void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                 std::vector<Match>& matches) const override;
+
+    size_t memoryUsage() const override;
+
+private:
+    // Report the matches in the line [begin, end)
+    void scanLine(const unsigned char* text, size_t begin, size_t end,
+                  std::vector<Match>& matches) const;
+
+    uint64_t peq[256] = {};  // Bit i set when the byte equals pattern[i]
+    uint64_t last_bit;       // Bit of the pattern's last column
+    uint32_t pattern_length;
+    uint32_t max_errors;
+    std::unique_ptr<PatternMatcher> prefilter;  // May be null
+    std::string engine_name;
+};
+
+// Build the matcher for --max-errors. Takes exactly one non-empty pattern of
+// at most kApproximateMaxLength bytes, longer than max_errors; otherwise
+// returns nullptr and fills `error`.
+std::unique_ptr<PatternMatcher> compileApproximate(const std::vector<std::string>& patterns,
+                                                   uint32_t max_errors, bool fold_case,
+                                                   std::string& error);
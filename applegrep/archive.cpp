@@ -0,0 +1,463 @@
+#include "archive.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "decompress.hpp"
+
+namespace {
+
+constexpr size_t kTarBlock = 512;
+
+// GNU long names and pax headers above this are taken for corruption
+constexpr size_t kMaxExtendedHeader = 1 << 20;
+
+// zip compression methods
+constexpr uint16_t kStored = 0;
+constexpr uint16_t kDeflated = 8;
+constexpr uint16_t kZstd = 93;
+
+uint32_t readLittle16(const char* bytes) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+    return b[0] | b[1] << 8;
+}
+
+uint32_t readLittle32(const char* bytes) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+    return b[0] | b[1] << 8 | b[2] << 16 | static_cast<uint32_t>(b[3]) << 24;
+}
+
+uint64_t readLittle64(const char* bytes) {
+    return readLittle32(bytes) | static_cast<uint64_t>(readLittle32(bytes + 4)) << 32;
+}
+
+size_t tarPadding(size_t size) {
+    return (kTarBlock - size % kTarBlock) % kTarBlock;
+}
+
+// A numeric header field: octal digits, space or NUL terminated, or GNU's
+// big-endian base-256 for values octal cannot hold
+bool parseTarNumber(const char* field, size_t width, uint64_t& value) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(field);
+    value = 0;
+    if (bytes[0] & 0x80) {
+        if (bytes[0] != 0x80) return false;  // Negative, or beyond 64 bits
+        for (size_t i = 1; i < width; ++i) {
+            if (value >> 56) return false;
+            value = value << 8 | bytes[i];
+        }
+        return true;
+    }
+    size_t i = 0;
+    while (i < width && bytes[i] == ' ') ++i;
+    const size_t digits = i;
+    for (; i < width && bytes[i] >= '0' && bytes[i] <= '7'; ++i) {
+        if (value >> 60) return false;
+        value = value << 3 | (bytes[i] - '0');
+    }
+    return i > digits && (i == width || bytes[i] == ' ' || bytes[i] == '\0');
+}
+
+// The checksum is the sum of the header's bytes with its own field taken as
+// spaces; some old writers summed signed bytes
+bool tarChecksumValid(const char* block) {
+    uint64_t expected;
+    if (!parseTarNumber(block + 148, 8, expected)) return false;
+    uint64_t unsigned_sum = 8 * ' ';
+    int64_t signed_sum = 8 * ' ';
+    for (size_t i = 0; i < kTarBlock; ++i) {
+        if (i >= 148 && i < 156) continue;
+        unsigned_sum += static_cast<unsigned char>(block[i]);
+        signed_sum += static_cast<signed char>(block[i]);
+    }
+    return expected == unsigned_sum || static_cast<int64_t>(expected) == signed_sum;
+}
+
+std::string tarField(const char* field, size_t width) {
+    return std::string(field, strnlen(field, width));
+}
+
+// The path in a header block; ustar splits long ones into prefix and name
+std::string tarPath(const char* block) {
+    std::string path = tarField(block, 100);
+    if (memcmp(block + 257, "ustar", 5) == 0 && block[345] != '\0') {
+        path = tarField(block + 345, 155) + "/" + path;
+    }
+    return path;
+}
+
+// Apply the `path` and `size` records of a pax extended header, each
+// "LENGTH KEY=VALUE\n"
+bool parsePax(const std::string& text, std::string& path, bool& has_size, uint64_t& size) {
+    for (size_t at = 0; at < text.size();) {
+        size_t length = 0;
+        size_t i = at;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            length = length * 10 + (text[i] - '0');
+            if (length > text.size()) return false;
+        }
+        if (i == at || i >= text.size() || text[i] != ' ' || at + length > text.size() ||
+            text[at + length - 1] != '\n') {
+            return false;
+        }
+        const size_t key = i + 1;
+        const size_t equals = text.find('=', key);
+        if (equals == std::string::npos || equals >= at + length) return false;
+        const std::string name = text.substr(key, equals - key);
+        const std::string value = text.substr(equals + 1, at + length - 1 - (equals + 1));
+        if (name == "path") {
+            path = value;
+        } else if (name == "size") {
+            char* end = nullptr;
+            size = strtoull(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0') return false;
+            has_size = true;
+        }
+        at += length;
+    }
+    return true;
+}
+
+bool zeroBlock(const char* block) {
+    return std::all_of(block, block + kTarBlock, [](char byte) { return byte == '\0'; });
+}
+
+// Raw deflate, as zip stores it, decoded from memory
+class InflateSource : public StreamSource {
+public:
+    InflateSource(const char* data, size_t length) : data(data), length(length) {
+        inflateInit2(&stream, -15);
+    }
+
+    ~InflateSource() override { inflateEnd(&stream); }
+
+    ssize_t read(char* to, size_t room, std::string& error) override {
+        stream.next_out = reinterpret_cast<Bytef*>(to);
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(room, UINT_MAX));
+        const uInt wanted = stream.avail_out;
+        while (stream.avail_out > 0 && !finished) {
+            if (stream.avail_in == 0 && offset < length) {
+                const size_t count = std::min<size_t>(length - offset, UINT_MAX);
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data + offset));
+                stream.avail_in = static_cast<uInt>(count);
+                offset += count;
+            }
+            const int result = inflate(&stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                finished = true;
+            } else if (result == Z_BUF_ERROR && stream.avail_in == 0 && offset == length) {
+                error = "truncated deflate data";
+                return -1;
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                error = std::string("invalid deflate data: ") + (stream.msg ? stream.msg : "bad data");
+                return -1;
+            }
+        }
+        return static_cast<ssize_t>(wanted - stream.avail_out);
+    }
+
+    bool ready() override { return true; }
+
+private:
+    const char* const data;
+    const size_t length;
+    size_t offset = 0;
+    z_stream stream = {};
+    bool finished = false;
+};
+
+bool listTar(const char* data, size_t length, std::vector<ArchiveMember>& members,
+             std::string& error) {
+    std::unique_ptr<StreamSource> source = createMemorySource(data, length);
+    TarReader tar(*source);
+    ArchiveMember member;
+    while (tar.next(member, error)) {
+        if (member.size > length - member.offset) {
+            error = "truncated tar input";
+            return false;
+        }
+        members.push_back(member);
+    }
+    return error.empty();
+}
+
+// The end of central directory record sits at the end, before a comment of
+// up to 64 KiB. Large archives point on to a zip64 record with 64-bit fields.
+bool listZip(const char* data, size_t length, std::vector<ArchiveMember>& members,
+             std::string& error) {
+    constexpr size_t kEndRecord = 22;
+    size_t end = length;
+    for (size_t at = length >= kEndRecord ? length - kEndRecord + 1 : 0;
+         at-- > 0 && length - at <= kEndRecord + 0xffff;) {
+        if (readLittle32(data + at) == 0x06054b50 &&
+            at + kEndRecord + readLittle16(data + at + 20) <= length) {
+            end = at;
+            break;
+        }
+    }
+    if (end == length) {
+        error = "invalid zip archive: no central directory";
+        return false;
+    }
+    uint64_t entries = readLittle16(data + end + 10);
+    uint64_t directory_size = readLittle32(data + end + 12);
+    uint64_t directory = readLittle32(data + end + 16);
+    if ((entries == 0xffff || directory_size == 0xffffffff || directory == 0xffffffff) &&
+        end >= 20 && readLittle32(data + end - 20) == 0x07064b50) {
+        const uint64_t record = readLittle64(data + end - 12);
+        if (record > length || length - record < 56 || readLittle32(data + record) != 0x06064b50) {
+            error = "invalid zip archive: bad zip64 record";
+            return false;
+        }
+        entries = readLittle64(data + record + 32);
+        directory_size = readLittle64(data + record + 40);
+        directory = readLittle64(data + record + 48);
+    }
+    if (directory > length || directory_size > length - directory) {
+        error = "invalid zip archive: central directory out of range";
+        return false;
+    }
+
+    const char* const directory_end = data + directory + directory_size;
+    const char* entry = data + directory;
+    for (uint64_t i = 0; i < entries; ++i) {
+        if (directory_end - entry < 46 || readLittle32(entry) != 0x02014b50) {
+            error = "invalid zip archive: bad central directory entry";
+            return false;
+        }
+        const size_t name_length = readLittle16(entry + 28);
+        const size_t extra_length = readLittle16(entry + 30);
+        const size_t entry_length = 46 + name_length + extra_length + readLittle16(entry + 32);
+        if (static_cast<size_t>(directory_end - entry) < entry_length) {
+            error = "invalid zip archive: bad central directory entry";
+            return false;
+        }
+        ArchiveMember member;
+        member.path.assign(entry + 46, name_length);
+        member.method = static_cast<uint16_t>(readLittle16(entry + 10));
+        member.encrypted = readLittle16(entry + 8) & 1;
+        uint64_t size = readLittle32(entry + 24);
+        uint64_t stored_size = readLittle32(entry + 20);
+        uint64_t local = readLittle32(entry + 42);
+
+        // Fields that overflowed 32 bits are in the zip64 extra field, in
+        // this order
+        const char* extra = entry + 46 + name_length;
+        for (size_t at = 0; at + 4 <= extra_length;) {
+            const size_t field_length = readLittle16(extra + at + 2);
+            if (at + 4 + field_length > extra_length) break;
+            if (readLittle16(extra + at) == 0x0001) {
+                const char* field = extra + at + 4;
+                const char* field_end = field + field_length;
+                for (uint64_t* value : {&size, &stored_size, &local}) {
+                    if (*value != 0xffffffff) continue;
+                    if (field_end - field < 8) break;
+                    *value = readLittle64(field);
+                    field += 8;
+                }
+            }
+            at += 4 + field_length;
+        }
+
+        // Directories, and symbolic links written on Unix
+        const uint32_t mode = readLittle32(entry + 38) >> 16;
+        const bool unix_host = static_cast<unsigned char>(entry[5]) == 3;
+        entry += entry_length;
+        if (member.path.empty() || member.path.back() == '/' ||
+            (unix_host && (mode & 0170000) == 0120000)) {
+            continue;
+        }
+
+        if (local > length || length - local < 30 || readLittle32(data + local) != 0x04034b50) {
+            error = "invalid zip archive: bad local header for " + member.path;
+            return false;
+        }
+        const uint64_t offset =
+            local + 30 + readLittle16(data + local + 26) + readLittle16(data + local + 28);
+        if (offset > length || stored_size > length - offset) {
+            error = "invalid zip archive: " + member.path + " out of range";
+            return false;
+        }
+        member.offset = static_cast<size_t>(offset);
+        member.stored_size = static_cast<size_t>(stored_size);
+        member.size = static_cast<size_t>(size);
+        members.push_back(std::move(member));
+    }
+    return true;
+}
+
+} // namespace
+
+ArchiveFormat detectArchive(const char* data, size_t length) {
+    if (length >= 4 && (readLittle32(data) == 0x04034b50 || readLittle32(data) == 0x06054b50)) {
+        return ArchiveFormat::Zip;
+    }
+    if (length >= kTarBlock && !zeroBlock(data) && tarChecksumValid(data)) {
+        return ArchiveFormat::Tar;
+    }
+    return ArchiveFormat::None;
+}
+
+const char* archiveName(ArchiveFormat format) {
+    switch (format) {
+    case ArchiveFormat::None: return "none";
+    case ArchiveFormat::Tar: return "tar";
+    case ArchiveFormat::Zip: return "zip";
+    }
+    return "unknown";
+}
+
+bool TarReader::next(ArchiveMember& member, std::string& error) {
+    if (finished || !skip(left + padding, error)) return false;
+    left = padding = 0;
+
+    // Set by GNU long name and pax headers for the header after them
+    std::string long_path;
+    bool has_size = false;
+    uint64_t pax_size = 0;
+
+    char block[kTarBlock];
+    for (;;) {
+        bool at_end = false;
+        if (!readBlock(block, at_end, error)) return false;
+        if (at_end || zeroBlock(block)) {
+            finished = true;
+            return false;
+        }
+        uint64_t size;
+        if (!tarChecksumValid(block) || !parseTarNumber(block + 124, 12, size)) {
+            error = "invalid tar header";
+            return false;
+        }
+        const char type = block[156];
+        if (type == 'L' || type == 'K' || type == 'x') {
+            std::string text;
+            if (!readData(size, text, error)) return false;
+            if (type == 'K') {
+                // A long link target; links are passed over
+            } else if (type == 'L') {
+                long_path = text.substr(0, text.find('\0'));
+            } else if (!parsePax(text, long_path, has_size, pax_size)) {
+                error = "invalid pax header";
+                return false;
+            }
+            continue;
+        }
+        if (has_size) size = pax_size;
+        if (type == '1' || type == '2') size = 0;  // Links have no data
+        if (size > SIZE_MAX - kTarBlock) {
+            error = "invalid tar header";
+            return false;
+        }
+        if (type == '0' || type == '\0' || type == '7') {
+            member.path = long_path.empty() ? tarPath(block) : long_path;
+            member.offset = position;
+            member.stored_size = member.size = static_cast<size_t>(size);
+            member.method = kStored;
+            member.encrypted = false;
+            left = member.size;
+            padding = tarPadding(member.size);
+            return true;
+        }
+
+        // Directories, links, devices and global pax headers
+        if (!skip(size + tarPadding(size), error)) return false;
+        long_path.clear();
+        has_size = false;
+    }
+}
+
+bool TarReader::readBlock(char* block, bool& at_end, std::string& error) {
+    size_t have = 0;
+    while (have < kTarBlock) {
+        const ssize_t got = source.read(block + have, kTarBlock - have, error);
+        if (got < 0) return false;
+        if (got == 0) break;
+        have += static_cast<size_t>(got);
+    }
+    position += have;
+    if (have == 0) {
+        at_end = true;  // Without the zero blocks that should end it
+    } else if (have < kTarBlock) {
+        error = "truncated tar input";
+        return false;
+    }
+    return true;
+}
+
+bool TarReader::readData(size_t size, std::string& text, std::string& error) {
+    if (size > kMaxExtendedHeader) {
+        error = "invalid tar header";
+        return false;
+    }
+    text.resize(size);
+    size_t have = 0;
+    while (have < size) {
+        const ssize_t got = source.read(&text[have], size - have, error);
+        if (got < 0) return false;
+        if (got == 0) {
+            error = "truncated tar input";
+            return false;
+        }
+        have += static_cast<size_t>(got);
+    }
+    position += size;
+    return skip(tarPadding(size), error);
+}
+
+bool TarReader::skip(size_t count, std::string& error) {
+    const ssize_t skipped = source.skip(count, error);
+    if (skipped < 0) return false;
+    position += static_cast<size_t>(skipped);
+    if (static_cast<size_t>(skipped) < count) {
+        error = "truncated tar input";
+        return false;
+    }
+    return true;
+}
+
+ssize_t TarReader::MemberSource::read(char* to, size_t room, std::string& error) {
+    if (reader.left == 0) return 0;
+    const ssize_t got = reader.source.read(to, std::min(room, reader.left), error);
+    if (got < 0) return -1;
+    if (got == 0) {
+        error = "truncated tar input";
+        return -1;
+    }
+    reader.left -= static_cast<size_t>(got);
+    reader.position += static_cast<size_t>(got);
+    return got;
+}
+
+bool listArchive(ArchiveFormat format, const char* data, size_t length,
+                 std::vector<ArchiveMember>& members, std::string& error) {
+    switch (format) {
+    case ArchiveFormat::Tar: return listTar(data, length, members, error);
+    case ArchiveFormat::Zip: return listZip(data, length, members, error);
+    case ArchiveFormat::None: break;
+    }
+    return true;
+}
+
+std::unique_ptr<StreamSource> openArchiveMember(const char* archive, const ArchiveMember& member,
+                                                std::string& error) {
+    if (member.encrypted) {
+        error = "encrypted member";
+        return nullptr;
+    }
+    const char* stored = archive + member.offset;
+    switch (member.method) {
+    case kStored:
+        return createMemorySource(stored, member.stored_size);
+    case kDeflated:
+        return std::make_unique<InflateSource>(stored, member.stored_size);
+    case kZstd:
+        return createDecompressor(Compression::Zstd, createMemorySource(stored, member.stored_size),
+                                  error);
+    }
+    error = "unsupported compression method " + std::to_string(member.method);
+    return nullptr;
+}
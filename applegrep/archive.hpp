@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stream_source.hpp"
+
+// Archive formats whose members -z searches, from their first bytes: zip
+// from its local header signature, tar from a valid first header block
+// (ustar, GNU and old V7 headers all carry a checksum)
+enum class ArchiveFormat { None, Tar, Zip };
+
+// Bytes detectArchive() needs to tell the formats apart: a tar header block
+constexpr size_t kArchiveMagicBytes = 512;
+
+ArchiveFormat detectArchive(const char* data, size_t length);
+
+const char* archiveName(ArchiveFormat format);
+
+// A regular file inside an archive. Its data is `stored_size` bytes at
+// `offset` in the archive, compressed with zip method `method` (0 for
+// stored, which all tar members are), and `size` bytes once decoded.
+struct ArchiveMember {
+    std::string path;
+    size_t offset = 0;
+    size_t stored_size = 0;
+    size_t size = 0;
+    uint16_t method = 0;
+    bool encrypted = false;
+};
+
+// Reads a tar archive front to back, for tar arriving on a pipe or through a
+// decompressor. GNU long names and pax `path` and `size` records are
+// applied; directories, links and other special members are passed over.
+class TarReader {
+public:
+    explicit TarReader(StreamSource& source) : source(source), data(*this) {}
+
+    TarReader(const TarReader&) = delete;
+    TarReader& operator=(const TarReader&) = delete;
+
+    // Move to the next regular file, dropping what was left unread of the
+    // current one. Returns false at the end of the archive, and false with
+    // `error` filled when the archive is truncated or corrupt. member.offset
+    // is where the member's data starts in the source.
+    bool next(ArchiveMember& member, std::string& error);
+
+    // The current member's data; it ends where the member does
+    StreamSource& member() { return data; }
+
+private:
+    class MemberSource : public StreamSource {
+    public:
+        explicit MemberSource(TarReader& reader) : reader(reader) {}
+        ssize_t read(char* to, size_t room, std::string& error) override;
+        bool ready() override { return reader.left == 0 || reader.source.ready(); }
+
+    private:
+        TarReader& reader;
+    };
+
+    bool readBlock(char* block, bool& at_end, std::string& error);
+    bool readData(size_t size, std::string& text, std::string& error);
+    bool skip(size_t count, std::string& error);
+
+    StreamSource& source;
+    MemberSource data;
+    size_t position = 0;  // Bytes taken from the source
+    size_t left = 0;      // Data of the current member not read yet
+    size_t padding = 0;   // Bytes after it up to the next header block
+    bool finished = false;
+};
+
+// The regular files of the archive in [data, data + length), in the order
+// they are stored. A zip archive is listed from its central directory, so
+// the list costs nothing per member byte. Returns false with `error` filled
+// when the archive is truncated or corrupt.
+bool listArchive(ArchiveFormat format, const char* data, size_t length,
+                 std::vector<ArchiveMember>& members, std::string& error);
+
+// A source decoding `member` of the archive at `archive`, which must outlive
+// it. Returns null with `error` filled for an encrypted member or a
+// compression method that is not supported (zip's deflate and, with
+// APPLEGREP_WITH_ZSTD, zstd are).
+std::unique_ptr<StreamSource> openArchiveMember(const char* archive, const ArchiveMember& member,
+                                                std::string& error);
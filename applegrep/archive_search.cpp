@@ -0,0 +1,193 @@
+#include "archive_search.hpp"
+
+#include <algorithm>
+
+#include "archive.hpp"
+#include "match_output.hpp"
+#include "stream_search.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace {
+
+// Members up to this size are decoded whole and searched in place; larger
+// ones are searched as a stream, in blocks
+constexpr size_t kWholeMemberBytes = 32 << 20;
+
+// Tar members read ahead of the scan before the reader waits for it
+constexpr size_t kReadAheadBytes = 64 << 20;
+
+// Fill to[0, size) from `source`; a member that ends early is corrupt
+bool readWhole(StreamSource& source, char* to, size_t size, std::string& error) {
+    size_t have = 0;
+    while (have < size) {
+        const ssize_t got = source.read(to + have, size - have, error);
+        if (got < 0) return false;
+        if (got == 0) {
+            error = "member is shorter than its header says";
+            return false;
+        }
+        have += static_cast<size_t>(got);
+    }
+    return true;
+}
+
+} // namespace
+
+ArchiveSearch::ArchiveSearch(SearchBackend& backend, const std::vector<std::string>& patterns,
+                             const SearchOptions& options, std::mutex& backend_mutex,
+                             OutputFn on_output)
+    : backend(backend), patterns(patterns), options(options), backend_mutex(backend_mutex),
+      on_output(std::move(on_output)) {}
+
+bool ArchiveSearch::search(const std::string& path, const char* data, size_t length,
+                           std::string& error) {
+    const ArchiveFormat format = detectArchive(data, length);
+    if (format == ArchiveFormat::None) return false;
+
+    std::vector<ArchiveMember> members;
+    std::string list_error;
+    if (!listArchive(format, data, length, members, list_error)) fail(path, list_error);
+    member_count += members.size();
+    sharedPool().parallelFor(members.size(), [&](size_t i) {
+        const ArchiveMember& member = members[i];
+        const std::string name = path + ":" + member.path;
+        if (member.method == 0 && !member.encrypted) {
+            finish(i, searchText(name, data + member.offset, member.stored_size));
+            return;
+        }
+        std::string member_error;
+        std::string text;
+        std::unique_ptr<StreamSource> source = openArchiveMember(data, member, member_error);
+        if (source) text = searchSource(name, *source, member.size, member_error);
+        if (!member_error.empty()) fail(name, member_error);
+        finish(i, std::move(text));
+    });
+    error = errors;
+    return true;
+}
+
+bool ArchiveSearch::search(const std::string& path, std::unique_ptr<StreamSource>& source,
+                           std::string& error) {
+    std::string magic;
+    if (!peekSource(source, kArchiveMagicBytes, magic, error)) {
+        error = path + ": " + error;
+        return true;
+    }
+    const ArchiveFormat format = detectArchive(magic.data(), magic.size());
+    if (format == ArchiveFormat::None) return false;
+    if (format == ArchiveFormat::Tar) {
+        searchTar(path, *source);
+        error = errors;
+        return true;
+    }
+
+    std::string archive;
+    for (;;) {
+        const size_t have = archive.size();
+        archive.resize(std::max<size_t>(2 * have, kArchiveMagicBytes));
+        const ssize_t got = source->read(&archive[have], archive.size() - have, error);
+        if (got <= 0) {
+            archive.resize(have);
+            if (got == 0) break;
+            error = path + ": " + error;
+            return true;
+        }
+        archive.resize(have + static_cast<size_t>(got));
+    }
+    return search(path, archive.data(), archive.size(), error);
+}
+
+void ArchiveSearch::searchTar(const std::string& path, StreamSource& source) {
+    WorkStealingPool& pool = sharedPool();
+    TaskGroup group;
+    TarReader tar(source);
+    ArchiveMember member;
+    std::string error;
+    size_t index = 0;
+    size_t read_ahead = 0;
+    while (tar.next(member, error)) {
+        const size_t i = index++;
+        ++member_count;
+        std::string name = path + ":" + member.path;
+        if (member.size > kWholeMemberBytes) {
+            finish(i, searchSource(name, tar.member(), member.size, error));
+            if (!error.empty()) break;
+            continue;
+        }
+        if (read_ahead + member.size > kReadAheadBytes) {
+            pool.wait(group);
+            read_ahead = 0;
+        }
+        std::shared_ptr<char[]> text(new char[std::max<size_t>(member.size, 1)]);
+        if (!readWhole(tar.member(), text.get(), member.size, error)) {
+            finish(i, std::string());
+            break;
+        }
+        read_ahead += member.size;
+        pool.submit(group, [this, i, name = std::move(name), text, size = member.size] {
+            finish(i, searchText(name, text.get(), size));
+        });
+    }
+    pool.wait(group);
+    if (!error.empty()) fail(path, error);
+}
+
+std::string ArchiveSearch::searchText(const std::string& name, const char* text, size_t length) {
+    std::vector<Match> matches;
+    if (length > 0) {
+        std::unique_lock<std::mutex> lock(backend_mutex, std::defer_lock);
+        if (!backend.concurrentSearch()) lock.lock();
+        matches = backend.search(text, length);
+    }
+    total_bytes += length;
+    total_matches += matches.size();
+    std::string out;
+    if (matches.empty()) return out;
+    printSummary(out, matches.size(), patterns, options, name);
+    printMatches(out, name, text, length, matches, 0, options);
+    return out;
+}
+
+std::string ArchiveSearch::searchSource(const std::string& name, StreamSource& source,
+                                        size_t size, std::string& error) {
+    if (size <= kWholeMemberBytes) {
+        std::unique_ptr<char[]> text(new char[std::max<size_t>(size, 1)]);
+        if (!readWhole(source, text.get(), size, error)) return std::string();
+        return searchText(name, text.get(), size);
+    }
+
+    std::unique_lock<std::mutex> lock(backend_mutex, std::defer_lock);
+    if (!backend.concurrentSearch()) lock.lock();
+    std::string lines;
+    StreamTotals streamed;
+    searchStream(
+        source, backend, streamOverlap(patterns, options),
+        [&](const char* block, size_t length, const std::vector<Match>& matches,
+            size_t lines_before) {
+            printMatches(lines, name, block, length, matches, lines_before, options);
+        },
+        streamed, error);
+    total_bytes += streamed.bytes;
+    total_matches += streamed.matches;
+    std::string out;
+    if (streamed.matches == 0) return out;
+    printSummary(out, streamed.matches, patterns, options, name);
+    out += lines;
+    return out;
+}
+
+void ArchiveSearch::finish(size_t index, std::string text) {
+    std::lock_guard<std::mutex> lock(output_mutex);
+    waiting.emplace(index, std::move(text));
+    for (auto next = waiting.begin(); next != waiting.end() && next->first == written;
+         next = waiting.erase(next)) {
+        if (!next->second.empty()) on_output(next->second);
+        ++written;
+    }
+}
+
+void ArchiveSearch::fail(const std::string& name, const std::string& error) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!errors.empty()) errors += "\n";
+    errors += name + ": " + error;
+}
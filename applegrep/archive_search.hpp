@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "search_backend.hpp"
+#include "stream_source.hpp"
+
+// Searches the members of a tar or zip archive (see archive.hpp) as files of
+// their own, named "archive:member", for -z. Each member with matches gets
+// its summary line and matching lines, as a file in a many-file search does.
+//
+// An archive in memory is listed first and its members are searched in
+// parallel on the shared pool, in place when they are stored. A tar archive
+// read from a stream is taken member by member on the calling thread and
+// each member is scanned on the pool while the next is read; a zip archive
+// in a stream is read whole first, as its directory is at the end. Members
+// larger than a fixed size are searched block by block instead of being
+// decoded whole.
+class ArchiveSearch {
+public:
+    // Receives the output of each member that has matches, in member order.
+    // Called from any thread, but never concurrently.
+    using OutputFn = std::function<void(const std::string& text)>;
+
+    // `backend_mutex` serialises backends without concurrentSearch()
+    ArchiveSearch(SearchBackend& backend, const std::vector<std::string>& patterns,
+                  const SearchOptions& options, std::mutex& backend_mutex, OutputFn on_output);
+
+    ArchiveSearch(const ArchiveSearch&) = delete;
+    ArchiveSearch& operator=(const ArchiveSearch&) = delete;
+
+    // Search [data, data + length) if it holds an archive; returns false if
+    // it does not. Members that cannot be read are reported in `error`, one
+    // line each, and the rest are still searched.
+    bool search(const std::string& path, const char* data, size_t length, std::string& error);
+
+    // The same for `source`. When it is not an archive, `source` is replaced
+    // by one that starts from the same place.
+    bool search(const std::string& path, std::unique_ptr<StreamSource>& source,
+                std::string& error);
+
+    size_t members() const { return member_count; }
+    size_t bytes() const { return total_bytes; }
+    size_t matches() const { return total_matches; }
+
+private:
+    void searchTar(const std::string& path, StreamSource& source);
+
+    // The output for a member, searched in place or read from `source`
+    std::string searchText(const std::string& name, const char* text, size_t length);
+    std::string searchSource(const std::string& name, StreamSource& source, size_t size,
+                             std::string& error);
+
+    void finish(size_t index, std::string text);
+    void fail(const std::string& name, const std::string& error);
+
+    SearchBackend& backend;
+    const std::vector<std::string>& patterns;
+    const SearchOptions& options;
+    std::mutex& backend_mutex;
+    const OutputFn on_output;
+
+    std::atomic<size_t> member_count{0};
+    std::atomic<size_t> total_bytes{0};
+    std::atomic<size_t> total_matches{0};
+
+    std::mutex output_mutex;
+    std::map<size_t, std::string> waiting;  // Finished members not yet handed on
+    size_t written = 0;
+
+    std::mutex error_mutex;
+    std::string errors;
+};
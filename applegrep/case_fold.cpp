@@ -0,0 +1,565 @@
+#include "case_fold.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Every code point in [lo, hi] folds to code point + delta, or with
+// kAlternate, even offsets from lo fold up by one and odd ones down
+constexpr int32_t kAlternate = INT32_MIN;
+
+struct FoldRange {
+    uint32_t lo;
+    uint32_t hi;
+    int32_t delta;
+};
+
+// Simple case folding orbits, from the Unicode 14.0 case data: one-character
+// foldings, plus one-to-one lower-case mappings where the full folding is
+// longer (U+1E9E folds with U+00DF). Generated; sorted by lo.
+const FoldRange kFoldRanges[] = {
+    {0x0041, 0x005A, 32},
+    {0x0061, 0x006A, -32},
+    {0x006B, 0x006B, 8383},
+    {0x006C, 0x0072, -32},
+    {0x0073, 0x0073, 268},
+    {0x0074, 0x007A, -32},
+    {0x00B5, 0x00B5, 743},
+    {0x00C0, 0x00D6, 32},
+    {0x00D8, 0x00DE, 32},
+    {0x00DF, 0x00DF, 7615},
+    {0x00E0, 0x00E4, -32},
+    {0x00E5, 0x00E5, 8262},
+    {0x00E6, 0x00F6, -32},
+    {0x00F8, 0x00FE, -32},
+    {0x00FF, 0x00FF, 121},
+    {0x0100, 0x012F, kAlternate},
+    {0x0132, 0x0137, kAlternate},
+    {0x0139, 0x0139, 1},
+    {0x013A, 0x013A, -1},
+    {0x013B, 0x013B, 1},
+    {0x013C, 0x013C, -1},
+    {0x013D, 0x013D, 1},
+    {0x013E, 0x013E, -1},
+    {0x013F, 0x013F, 1},
+    {0x0140, 0x0140, -1},
+    {0x0141, 0x0141, 1},
+    {0x0142, 0x0142, -1},
+    {0x0143, 0x0143, 1},
+    {0x0144, 0x0144, -1},
+    {0x0145, 0x0145, 1},
+    {0x0146, 0x0146, -1},
+    {0x0147, 0x0147, 1},
+    {0x0148, 0x0148, -1},
+    {0x014A, 0x0177, kAlternate},
+    {0x0178, 0x0178, -121},
+    {0x0179, 0x0179, 1},
+    {0x017A, 0x017A, -1},
+    {0x017B, 0x017B, 1},
+    {0x017C, 0x017C, -1},
+    {0x017D, 0x017D, 1},
+    {0x017E, 0x017E, -1},
+    {0x017F, 0x017F, -300},
+    {0x0180, 0x0180, 195},
+    {0x0181, 0x0181, 210},
+    {0x0182, 0x0185, kAlternate},
+    {0x0186, 0x0186, 206},
+    {0x0187, 0x0187, 1},
+    {0x0188, 0x0188, -1},
+    {0x0189, 0x018A, 205},
+    {0x018B, 0x018B, 1},
+    {0x018C, 0x018C, -1},
+    {0x018E, 0x018E, 79},
+    {0x018F, 0x018F, 202},
+    {0x0190, 0x0190, 203},
+    {0x0191, 0x0191, 1},
+    {0x0192, 0x0192, -1},
+    {0x0193, 0x0193, 205},
+    {0x0194, 0x0194, 207},
+    {0x0195, 0x0195, 97},
+    {0x0196, 0x0196, 211},
+    {0x0197, 0x0197, 209},
+    {0x0198, 0x0199, kAlternate},
+    {0x019A, 0x019A, 163},
+    {0x019C, 0x019C, 211},
+    {0x019D, 0x019D, 213},
+    {0x019E, 0x019E, 130},
+    {0x019F, 0x019F, 214},
+    {0x01A0, 0x01A5, kAlternate},
+    {0x01A6, 0x01A6, 218},
+    {0x01A7, 0x01A7, 1},
+    {0x01A8, 0x01A8, -1},
+    {0x01A9, 0x01A9, 218},
+    {0x01AC, 0x01AD, kAlternate},
+    {0x01AE, 0x01AE, 218},
+    {0x01AF, 0x01AF, 1},
+    {0x01B0, 0x01B0, -1},
+    {0x01B1, 0x01B2, 217},
+    {0x01B3, 0x01B3, 1},
+    {0x01B4, 0x01B4, -1},
+    {0x01B5, 0x01B5, 1},
+    {0x01B6, 0x01B6, -1},
+    {0x01B7, 0x01B7, 219},
+    {0x01B8, 0x01B9, kAlternate},
+    {0x01BC, 0x01BD, kAlternate},
+    {0x01BF, 0x01BF, 56},
+    {0x01C4, 0x01C5, 1},
+    {0x01C6, 0x01C6, -2},
+    {0x01C7, 0x01C8, 1},
+    {0x01C9, 0x01C9, -2},
+    {0x01CA, 0x01CB, 1},
+    {0x01CC, 0x01CC, -2},
+    {0x01CD, 0x01CD, 1},
+    {0x01CE, 0x01CE, -1},
+    {0x01CF, 0x01CF, 1},
+    {0x01D0, 0x01D0, -1},
+    {0x01D1, 0x01D1, 1},
+    {0x01D2, 0x01D2, -1},
+    {0x01D3, 0x01D3, 1},
+    {0x01D4, 0x01D4, -1},
+    {0x01D5, 0x01D5, 1},
+    {0x01D6, 0x01D6, -1},
+    {0x01D7, 0x01D7, 1},
+    {0x01D8, 0x01D8, -1},
+    {0x01D9, 0x01D9, 1},
+    {0x01DA, 0x01DA, -1},
+    {0x01DB, 0x01DB, 1},
+    {0x01DC, 0x01DC, -1},
+    {0x01DD, 0x01DD, -79},
+    {0x01DE, 0x01EF, kAlternate},
+    {0x01F1, 0x01F2, 1},
+    {0x01F3, 0x01F3, -2},
+    {0x01F4, 0x01F5, kAlternate},
+    {0x01F6, 0x01F6, -97},
+    {0x01F7, 0x01F7, -56},
+    {0x01F8, 0x021F, kAlternate},
+    {0x0220, 0x0220, -130},
+    {0x0222, 0x0233, kAlternate},
+    {0x023A, 0x023A, 10795},
+    {0x023B, 0x023B, 1},
+    {0x023C, 0x023C, -1},
+    {0x023D, 0x023D, -163},
+    {0x023E, 0x023E, 10792},
+    {0x023F, 0x0240, 10815},
+    {0x0241, 0x0241, 1},
+    {0x0242, 0x0242, -1},
+    {0x0243, 0x0243, -195},
+    {0x0244, 0x0244, 69},
+    {0x0245, 0x0245, 71},
+    {0x0246, 0x024F, kAlternate},
+    {0x0250, 0x0250, 10783},
+    {0x0251, 0x0251, 10780},
+    {0x0252, 0x0252, 10782},
+    {0x0253, 0x0253, -210},
+    {0x0254, 0x0254, -206},
+    {0x0256, 0x0257, -205},
+    {0x0259, 0x0259, -202},
+    {0x025B, 0x025B, -203},
+    {0x025C, 0x025C, 42319},
+    {0x0260, 0x0260, -205},
+    {0x0261, 0x0261, 42315},
+    {0x0263, 0x0263, -207},
+    {0x0265, 0x0265, 42280},
+    {0x0266, 0x0266, 42308},
+    {0x0268, 0x0268, -209},
+    {0x0269, 0x0269, -211},
+    {0x026A, 0x026A, 42308},
+    {0x026B, 0x026B, 10743},
+    {0x026C, 0x026C, 42305},
+    {0x026F, 0x026F, -211},
+    {0x0271, 0x0271, 10749},
+    {0x0272, 0x0272, -213},
+    {0x0275, 0x0275, -214},
+    {0x027D, 0x027D, 10727},
+    {0x0280, 0x0280, -218},
+    {0x0282, 0x0282, 42307},
+    {0x0283, 0x0283, -218},
+    {0x0287, 0x0287, 42282},
+    {0x0288, 0x0288, -218},
+    {0x0289, 0x0289, -69},
+    {0x028A, 0x028B, -217},
+    {0x028C, 0x028C, -71},
+    {0x0292, 0x0292, -219},
+    {0x029D, 0x029D, 42261},
+    {0x029E, 0x029E, 42258},
+    {0x0345, 0x0345, 84},
+    {0x0370, 0x0373, kAlternate},
+    {0x0376, 0x0377, kAlternate},
+    {0x037B, 0x037D, 130},
+    {0x037F, 0x037F, 116},
+    {0x0386, 0x0386, 38},
+    {0x0388, 0x038A, 37},
+    {0x038C, 0x038C, 64},
+    {0x038E, 0x038F, 63},
+    {0x0391, 0x03A1, 32},
+    {0x03A3, 0x03A3, 31},
+    {0x03A4, 0x03AB, 32},
+    {0x03AC, 0x03AC, -38},
+    {0x03AD, 0x03AF, -37},
+    {0x03B1, 0x03B1, -32},
+    {0x03B2, 0x03B2, 30},
+    {0x03B3, 0x03B4, -32},
+    {0x03B5, 0x03B5, 64},
+    {0x03B6, 0x03B7, -32},
+    {0x03B8, 0x03B8, 25},
+    {0x03B9, 0x03B9, 7173},
+    {0x03BA, 0x03BA, 54},
+    {0x03BB, 0x03BB, -32},
+    {0x03BC, 0x03BC, -775},
+    {0x03BD, 0x03BF, -32},
+    {0x03C0, 0x03C0, 22},
+    {0x03C1, 0x03C1, 48},
+    {0x03C2, 0x03C2, 1},
+    {0x03C3, 0x03C5, -32},
+    {0x03C6, 0x03C6, 15},
+    {0x03C7, 0x03C8, -32},
+    {0x03C9, 0x03C9, 7517},
+    {0x03CA, 0x03CB, -32},
+    {0x03CC, 0x03CC, -64},
+    {0x03CD, 0x03CE, -63},
+    {0x03CF, 0x03CF, 8},
+    {0x03D0, 0x03D0, -62},
+    {0x03D1, 0x03D1, 35},
+    {0x03D5, 0x03D5, -47},
+    {0x03D6, 0x03D6, -54},
+    {0x03D7, 0x03D7, -8},
+    {0x03D8, 0x03EF, kAlternate},
+    {0x03F0, 0x03F0, -86},
+    {0x03F1, 0x03F1, -80},
+    {0x03F2, 0x03F2, 7},
+    {0x03F3, 0x03F3, -116},
+    {0x03F4, 0x03F4, -92},
+    {0x03F5, 0x03F5, -96},
+    {0x03F7, 0x03F7, 1},
+    {0x03F8, 0x03F8, -1},
+    {0x03F9, 0x03F9, -7},
+    {0x03FA, 0x03FB, kAlternate},
+    {0x03FD, 0x03FF, -130},
+    {0x0400, 0x040F, 80},
+    {0x0410, 0x042F, 32},
+    {0x0430, 0x0431, -32},
+    {0x0432, 0x0432, 6222},
+    {0x0433, 0x0433, -32},
+    {0x0434, 0x0434, 6221},
+    {0x0435, 0x043D, -32},
+    {0x043E, 0x043E, 6212},
+    {0x043F, 0x0440, -32},
+    {0x0441, 0x0442, 6210},
+    {0x0443, 0x0449, -32},
+    {0x044A, 0x044A, 6204},
+    {0x044B, 0x044F, -32},
+    {0x0450, 0x045F, -80},
+    {0x0460, 0x0461, kAlternate},
+    {0x0462, 0x0462, 1},
+    {0x0463, 0x0463, 6180},
+    {0x0464, 0x0481, kAlternate},
+    {0x048A, 0x04BF, kAlternate},
+    {0x04C0, 0x04C0, 15},
+    {0x04C1, 0x04C1, 1},
+    {0x04C2, 0x04C2, -1},
+    {0x04C3, 0x04C3, 1},
+    {0x04C4, 0x04C4, -1},
+    {0x04C5, 0x04C5, 1},
+    {0x04C6, 0x04C6, -1},
+    {0x04C7, 0x04C7, 1},
+    {0x04C8, 0x04C8, -1},
+    {0x04C9, 0x04C9, 1},
+    {0x04CA, 0x04CA, -1},
+    {0x04CB, 0x04CB, 1},
+    {0x04CC, 0x04CC, -1},
+    {0x04CD, 0x04CD, 1},
+    {0x04CE, 0x04CE, -1},
+    {0x04CF, 0x04CF, -15},
+    {0x04D0, 0x052F, kAlternate},
+    {0x0531, 0x0556, 48},
+    {0x0561, 0x0586, -48},
+    {0x10A0, 0x10C5, 7264},
+    {0x10C7, 0x10C7, 7264},
+    {0x10CD, 0x10CD, 7264},
+    {0x10D0, 0x10FA, 3008},
+    {0x10FD, 0x10FF, 3008},
+    {0x13A0, 0x13EF, 38864},
+    {0x13F0, 0x13F5, 8},
+    {0x13F8, 0x13FD, -8},
+    {0x1C80, 0x1C80, -6254},
+    {0x1C81, 0x1C81, -6253},
+    {0x1C82, 0x1C82, -6244},
+    {0x1C83, 0x1C83, -6242},
+    {0x1C84, 0x1C84, 1},
+    {0x1C85, 0x1C85, -6243},
+    {0x1C86, 0x1C86, -6236},
+    {0x1C87, 0x1C87, -6181},
+    {0x1C88, 0x1C88, 35266},
+    {0x1C90, 0x1CBA, -3008},
+    {0x1CBD, 0x1CBF, -3008},
+    {0x1D79, 0x1D79, 35332},
+    {0x1D7D, 0x1D7D, 3814},
+    {0x1D8E, 0x1D8E, 35384},
+    {0x1E00, 0x1E5F, kAlternate},
+    {0x1E60, 0x1E60, 1},
+    {0x1E61, 0x1E61, 58},
+    {0x1E62, 0x1E95, kAlternate},
+    {0x1E9B, 0x1E9B, -59},
+    {0x1E9E, 0x1E9E, -7615},
+    {0x1EA0, 0x1EFF, kAlternate},
+    {0x1F00, 0x1F07, 8},
+    {0x1F08, 0x1F0F, -8},
+    {0x1F10, 0x1F15, 8},
+    {0x1F18, 0x1F1D, -8},
+    {0x1F20, 0x1F27, 8},
+    {0x1F28, 0x1F2F, -8},
+    {0x1F30, 0x1F37, 8},
+    {0x1F38, 0x1F3F, -8},
+    {0x1F40, 0x1F45, 8},
+    {0x1F48, 0x1F4D, -8},
+    {0x1F51, 0x1F51, 8},
+    {0x1F53, 0x1F53, 8},
+    {0x1F55, 0x1F55, 8},
+    {0x1F57, 0x1F57, 8},
+    {0x1F59, 0x1F59, -8},
+    {0x1F5B, 0x1F5B, -8},
+    {0x1F5D, 0x1F5D, -8},
+    {0x1F5F, 0x1F5F, -8},
+    {0x1F60, 0x1F67, 8},
+    {0x1F68, 0x1F6F, -8},
+    {0x1F70, 0x1F71, 74},
+    {0x1F72, 0x1F75, 86},
+    {0x1F76, 0x1F77, 100},
+    {0x1F78, 0x1F79, 128},
+    {0x1F7A, 0x1F7B, 112},
+    {0x1F7C, 0x1F7D, 126},
+    {0x1F80, 0x1F87, 8},
+    {0x1F88, 0x1F8F, -8},
+    {0x1F90, 0x1F97, 8},
+    {0x1F98, 0x1F9F, -8},
+    {0x1FA0, 0x1FA7, 8},
+    {0x1FA8, 0x1FAF, -8},
+    {0x1FB0, 0x1FB1, 8},
+    {0x1FB3, 0x1FB3, 9},
+    {0x1FB8, 0x1FB9, -8},
+    {0x1FBA, 0x1FBB, -74},
+    {0x1FBC, 0x1FBC, -9},
+    {0x1FBE, 0x1FBE, -7289},
+    {0x1FC3, 0x1FC3, 9},
+    {0x1FC8, 0x1FCB, -86},
+    {0x1FCC, 0x1FCC, -9},
+    {0x1FD0, 0x1FD1, 8},
+    {0x1FD8, 0x1FD9, -8},
+    {0x1FDA, 0x1FDB, -100},
+    {0x1FE0, 0x1FE1, 8},
+    {0x1FE5, 0x1FE5, 7},
+    {0x1FE8, 0x1FE9, -8},
+    {0x1FEA, 0x1FEB, -112},
+    {0x1FEC, 0x1FEC, -7},
+    {0x1FF3, 0x1FF3, 9},
+    {0x1FF8, 0x1FF9, -128},
+    {0x1FFA, 0x1FFB, -126},
+    {0x1FFC, 0x1FFC, -9},
+    {0x2126, 0x2126, -7549},
+    {0x212A, 0x212A, -8415},
+    {0x212B, 0x212B, -8294},
+    {0x2132, 0x2132, 28},
+    {0x214E, 0x214E, -28},
+    {0x2160, 0x216F, 16},
+    {0x2170, 0x217F, -16},
+    {0x2183, 0x2183, 1},
+    {0x2184, 0x2184, -1},
+    {0x24B6, 0x24CF, 26},
+    {0x24D0, 0x24E9, -26},
+    {0x2C00, 0x2C2F, 48},
+    {0x2C30, 0x2C5F, -48},
+    {0x2C60, 0x2C61, kAlternate},
+    {0x2C62, 0x2C62, -10743},
+    {0x2C63, 0x2C63, -3814},
+    {0x2C64, 0x2C64, -10727},
+    {0x2C65, 0x2C65, -10795},
+    {0x2C66, 0x2C66, -10792},
+    {0x2C67, 0x2C67, 1},
+    {0x2C68, 0x2C68, -1},
+    {0x2C69, 0x2C69, 1},
+    {0x2C6A, 0x2C6A, -1},
+    {0x2C6B, 0x2C6B, 1},
+    {0x2C6C, 0x2C6C, -1},
+    {0x2C6D, 0x2C6D, -10780},
+    {0x2C6E, 0x2C6E, -10749},
+    {0x2C6F, 0x2C6F, -10783},
+    {0x2C70, 0x2C70, -10782},
+    {0x2C72, 0x2C73, kAlternate},
+    {0x2C75, 0x2C75, 1},
+    {0x2C76, 0x2C76, -1},
+    {0x2C7E, 0x2C7F, -10815},
+    {0x2C80, 0x2CE3, kAlternate},
+    {0x2CEB, 0x2CEB, 1},
+    {0x2CEC, 0x2CEC, -1},
+    {0x2CED, 0x2CED, 1},
+    {0x2CEE, 0x2CEE, -1},
+    {0x2CF2, 0x2CF3, kAlternate},
+    {0x2D00, 0x2D25, -7264},
+    {0x2D27, 0x2D27, -7264},
+    {0x2D2D, 0x2D2D, -7264},
+    {0xA640, 0xA649, kAlternate},
+    {0xA64A, 0xA64A, 1},
+    {0xA64B, 0xA64B, -35267},
+    {0xA64C, 0xA66D, kAlternate},
+    {0xA680, 0xA69B, kAlternate},
+    {0xA722, 0xA72F, kAlternate},
+    {0xA732, 0xA76F, kAlternate},
+    {0xA779, 0xA779, 1},
+    {0xA77A, 0xA77A, -1},
+    {0xA77B, 0xA77B, 1},
+    {0xA77C, 0xA77C, -1},
+    {0xA77D, 0xA77D, -35332},
+    {0xA77E, 0xA787, kAlternate},
+    {0xA78B, 0xA78B, 1},
+    {0xA78C, 0xA78C, -1},
+    {0xA78D, 0xA78D, -42280},
+    {0xA790, 0xA793, kAlternate},
+    {0xA794, 0xA794, 48},
+    {0xA796, 0xA7A9, kAlternate},
+    {0xA7AA, 0xA7AA, -42308},
+    {0xA7AB, 0xA7AB, -42319},
+    {0xA7AC, 0xA7AC, -42315},
+    {0xA7AD, 0xA7AD, -42305},
+    {0xA7AE, 0xA7AE, -42308},
+    {0xA7B0, 0xA7B0, -42258},
+    {0xA7B1, 0xA7B1, -42282},
+    {0xA7B2, 0xA7B2, -42261},
+    {0xA7B3, 0xA7B3, 928},
+    {0xA7B4, 0xA7C3, kAlternate},
+    {0xA7C4, 0xA7C4, -48},
+    {0xA7C5, 0xA7C5, -42307},
+    {0xA7C6, 0xA7C6, -35384},
+    {0xA7C7, 0xA7C7, 1},
+    {0xA7C8, 0xA7C8, -1},
+    {0xA7C9, 0xA7C9, 1},
+    {0xA7CA, 0xA7CA, -1},
+    {0xA7D0, 0xA7D1, kAlternate},
+    {0xA7D6, 0xA7D9, kAlternate},
+    {0xA7F5, 0xA7F5, 1},
+    {0xA7F6, 0xA7F6, -1},
+    {0xAB53, 0xAB53, -928},
+    {0xAB70, 0xABBF, -38864},
+    {0xFF21, 0xFF3A, 32},
+    {0xFF41, 0xFF5A, -32},
+    {0x10400, 0x10427, 40},
+    {0x10428, 0x1044F, -40},
+    {0x104B0, 0x104D3, 40},
+    {0x104D8, 0x104FB, -40},
+    {0x10570, 0x1057A, 39},
+    {0x1057C, 0x1058A, 39},
+    {0x1058C, 0x10592, 39},
+    {0x10594, 0x10595, 39},
+    {0x10597, 0x105A1, -39},
+    {0x105A3, 0x105B1, -39},
+    {0x105B3, 0x105B9, -39},
+    {0x105BB, 0x105BC, -39},
+    {0x10C80, 0x10CB2, 64},
+    {0x10CC0, 0x10CF2, -64},
+    {0x118A0, 0x118BF, 32},
+    {0x118C0, 0x118DF, -32},
+    {0x16E40, 0x16E5F, 32},
+    {0x16E60, 0x16E7F, -32},
+    {0x1E900, 0x1E921, 34},
+    {0x1E922, 0x1E943, -34},
+};
+
+} // namespace
+
+std::string foldAscii(const std::string& text) {
+    std::string folded(text);
+    for (char& c : folded) c = static_cast<char>(foldAscii(static_cast<unsigned char>(c)));
+    return folded;
+}
+
+bool equalsFoldedAscii(const char* text, const char* folded, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        if (foldAscii(static_cast<unsigned char>(text[i])) != static_cast<unsigned char>(folded[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool hasNonAscii(const std::string& text) {
+    return std::any_of(text.begin(), text.end(), [](char c) { return c & 0x80; });
+}
+
+uint32_t simpleFold(uint32_t code_point) {
+    const FoldRange* end = std::end(kFoldRanges);
+    const FoldRange* range = std::upper_bound(
+        std::begin(kFoldRanges), end, code_point,
+        [](uint32_t value, const FoldRange& r) { return value < r.lo; });
+    if (range == std::begin(kFoldRanges)) return code_point;
+    --range;
+    if (code_point > range->hi) return code_point;
+    if (range->delta == kAlternate) return (code_point - range->lo) % 2 ? code_point - 1 : code_point + 1;
+    return static_cast<uint32_t>(static_cast<int32_t>(code_point) + range->delta);
+}
+
+uint32_t foldCanonical(uint32_t code_point) {
+    uint32_t smallest = code_point;
+    for (uint32_t c = simpleFold(code_point); c != code_point; c = simpleFold(c)) {
+        smallest = std::min(smallest, c);
+    }
+    return smallest;
+}
+
+size_t decodeUtf8(const unsigned char* bytes, size_t length, uint32_t& code_point) {
+    const unsigned char lead = bytes[0];
+    if (lead < 0x80) {
+        code_point = lead;
+        return 1;
+    }
+
+    size_t size;
+    uint32_t value, minimum;
+    if ((lead & 0xe0) == 0xc0) {
+        size = 2, value = lead & 0x1f, minimum = 0x80;
+    } else if ((lead & 0xf0) == 0xe0) {
+        size = 3, value = lead & 0x0f, minimum = 0x800;
+    } else if ((lead & 0xf8) == 0xf0) {
+        size = 4, value = lead & 0x07, minimum = 0x10000;
+    } else {
+        code_point = kInvalidUtf8 + lead;
+        return 1;
+    }
+    if (size > length) {
+        code_point = kInvalidUtf8 + lead;
+        return 1;
+    }
+    for (size_t i = 1; i < size; ++i) {
+        if ((bytes[i] & 0xc0) != 0x80) {
+            code_point = kInvalidUtf8 + lead;
+            return 1;
+        }
+        value = (value << 6) | (bytes[i] & 0x3f);
+    }
+    // Overlong forms, surrogates and values past U+10FFFF are not characters
+    if (value < minimum || value > 0x10ffff || (value >= 0xd800 && value < 0xe000)) {
+        code_point = kInvalidUtf8 + lead;
+        return 1;
+    }
+    code_point = value;
+    return size;
+}
+
+void appendUtf8(uint32_t code_point, std::string& out) {
+    if (code_point >= kInvalidUtf8) {
+        out += static_cast<char>(code_point - kInvalidUtf8);
+    } else if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xc0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xe0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+}
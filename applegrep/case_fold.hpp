@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// -i folds ASCII letters to lower case. Non-ASCII characters in a pattern
+// match every character of their Unicode simple case folding orbit ("K", "k"
+// and KELVIN SIGN are one orbit), while an ASCII pattern letter only matches
+// its two ASCII cases.
+
+inline bool isAsciiLetter(unsigned char c) {
+    return static_cast<unsigned>((c | 0x20) - 'a') < 26u;
+}
+
+inline unsigned char foldAscii(unsigned char c) {
+    return static_cast<unsigned>(c - 'A') < 26u ? c | 0x20 : c;
+}
+
+std::string foldAscii(const std::string& text);
+
+// Whether text[0, length) equals `folded` (already lower case) up to ASCII case
+bool equalsFoldedAscii(const char* text, const char* folded, size_t length);
+
+bool hasNonAscii(const std::string& text);
+
+// The next code point in `code_point`'s simple folding orbit, in increasing
+// order and wrapping around; `code_point` itself when it has no other case
+uint32_t simpleFold(uint32_t code_point);
+
+// Smallest code point of the orbit, for comparing two characters
+uint32_t foldCanonical(uint32_t code_point);
+
+// Decode the UTF-8 sequence at bytes[0, length) (length >= 1). Returns the
+// bytes consumed. An invalid or truncated sequence consumes one byte and
+// yields kInvalidUtf8 + that byte, which only ever equals itself.
+constexpr uint32_t kInvalidUtf8 = 0x110000;
+size_t decodeUtf8(const unsigned char* bytes, size_t length, uint32_t& code_point);
+
+// Append the encoding of `code_point` (a kInvalidUtf8 byte is appended as is)
+void appendUtf8(uint32_t code_point, std::string& out);
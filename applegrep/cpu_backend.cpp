@@ -0,0 +1,174 @@
+#include "search_backend.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#include "approximate_matcher.hpp"
+#include "line_ranges.hpp"
+#include "multi_literal_matcher.hpp"
+#include "regex_matcher.hpp"
+#include "scan_kernels.hpp"
+#include "unicode_fold_matcher.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace {
+
+// Unit of parallel work. Small enough that idle cores find chunks to steal,
+// large enough that scheduling one costs nothing.
+constexpr size_t kChunkBytes = 8 << 20;
+
+// Chunks are scanned and line-numbered this much at a time, so that the
+// newline count reads the text from cache
+constexpr size_t kSliceBytes = 256 << 10;
+
+// One line-aligned slice of the text and what scanning it found
+struct Chunk {
+    size_t begin;
+    size_t end;
+    std::vector<Match> matches;  // Line numbers relative to the chunk start
+    size_t counted_to;           // Newlines are counted in [begin, counted_to)
+    size_t newlines = 0;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+class CpuBackend : public SearchBackend {
+public:
+    const char* name() const override { return "cpu"; }
+
+    bool compile(const std::vector<std::string>& patterns, const SearchOptions& options,
+                 std::string& error) override {
+        this->patterns = patterns;
+        ignore_case = options.ignore_case;
+        matcher.reset();
+        last_stats = SearchStats();
+        if (!options.extended_regex && options.max_errors == 0) return true;
+        if (options.extended_regex && options.max_errors > 0) {
+            error = "--max-errors searches literal patterns and cannot be combined with -E";
+            return false;
+        }
+
+        const auto compile_start = std::chrono::steady_clock::now();
+        matcher = options.extended_regex
+                      ? compileRegexes(patterns, ignore_case, error)
+                      : compileApproximate(patterns, options.max_errors, ignore_case, error);
+        if (!matcher) return false;
+        compiled(compile_start);
+        return true;
+    }
+
+    std::vector<Match> search(const char* text, size_t text_length) override {
+        std::vector<Match> matches;
+        if (text_length == 0) return matches;
+
+        // Literals are compiled on first use: the first block of the input
+        // tells the compiler which bytes are rare
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!matcher) {
+                const auto compile_start = std::chrono::steady_clock::now();
+                matcher = ignore_case ? compileFoldedLiterals(patterns, text, text_length)
+                                      : compileLiterals(patterns, false, text, text_length);
+                compiled(compile_start);
+            }
+        }
+        const auto scan_start = std::chrono::steady_clock::now();
+
+        // 1. Cut the start positions into chunks that begin on a line start.
+        // A chunk may read past its end, which is how chunks overlap by
+        // pattern_length - 1 without reporting a match twice.
+        std::vector<Chunk> chunks;
+        for (size_t begin = 0; begin < text_length;) {
+            const size_t end = firstLineStart(text, text_length,
+                                              std::min(text_length, begin + kChunkBytes));
+            chunks.push_back({begin, end, {}, begin});
+            begin = end;
+        }
+
+        // 2. Scan the chunks on every core. The pool is shared with whatever
+        // else is searching, so idle workers steal chunks from busy ones.
+        WorkStealingPool& pool = sharedPool();
+        pool.parallelFor(chunks.size(), [&](size_t c) { scanChunk(text, text_length, chunks[c]); });
+
+        // 3. Line numbers need the newline count of every chunk before the
+        // last match; count what the scan did not (nothing when no match)
+        size_t numbered = chunks.size();
+        while (numbered > 0 && chunks[numbered - 1].matches.empty()) --numbered;
+        pool.parallelFor(numbered, [&](size_t c) { finishNewlines(text, chunks[c]); });
+
+        // 4. Chunks are disjoint and ordered, so concatenation keeps order;
+        // each chunk's line numbers are offset by the newlines before it
+        size_t total = 0;
+        for (const Chunk& chunk : chunks) total += chunk.matches.size();
+        matches.reserve(total);
+        size_t lines_before = 0;
+        for (const Chunk& chunk : chunks) {
+            for (Match match : chunk.matches) {
+                match.line += lines_before;
+                matches.push_back(match);
+            }
+            lines_before += chunk.newlines;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        last_stats.scan_seconds = secondsSince(scan_start);
+        last_stats.cache_flushes = matcher->cacheFlushes();
+        return matches;
+    }
+
+    // Compiled matchers are immutable, and scans keep their state per thread
+    bool concurrentSearch() const override { return true; }
+
+private:
+    // Find the chunk's matches and number their lines. Each slice is
+    // numbered right after it is scanned, while it is still in cache.
+    void scanChunk(const char* text, size_t text_length, Chunk& chunk) const {
+        const CountNewlinesFn count_newlines = scanKernels().count_newlines;
+        size_t newlines = 0;
+        size_t counted_to = chunk.begin;
+        for (size_t slice = chunk.begin; slice < chunk.end; slice += kSliceBytes) {
+            const size_t first = chunk.matches.size();
+            matcher->findAll(text, text_length, slice, std::min(chunk.end, slice + kSliceBytes),
+                             chunk.matches);
+            for (size_t i = first; i < chunk.matches.size(); ++i) {
+                Match& match = chunk.matches[i];
+                newlines += count_newlines(text + counted_to, match.position - counted_to);
+                counted_to = match.position;
+                match.line = newlines + 1;
+            }
+        }
+        chunk.counted_to = counted_to;
+        chunk.newlines = newlines;
+    }
+
+    // Extend the chunk's newline count to exactly [begin, end)
+    static void finishNewlines(const char* text, Chunk& chunk) {
+        const CountNewlinesFn count_newlines = scanKernels().count_newlines;
+        // Approximate matches end where they end, possibly past the chunk
+        if (chunk.counted_to <= chunk.end) {
+            chunk.newlines += count_newlines(text + chunk.counted_to, chunk.end - chunk.counted_to);
+        } else {
+            chunk.newlines -= count_newlines(text + chunk.end, chunk.counted_to - chunk.end);
+        }
+        chunk.counted_to = chunk.end;
+    }
+
+    void compiled(std::chrono::steady_clock::time_point start) {
+        last_stats.engine = matcher->name();
+        last_stats.compile_seconds = secondsSince(start);
+        last_stats.engine_bytes = matcher->memoryUsage();
+    }
+
+    std::vector<std::string> patterns;
+    bool ignore_case = false;
+    std::unique_ptr<PatternMatcher> matcher;
+    std::mutex mutex;  // Guards the lazy compile and last_stats
+};
+
+} // namespace
+
+std::unique_ptr<SearchBackend> createCpuBackend() {
+    return std::make_unique<CpuBackend>();
+}
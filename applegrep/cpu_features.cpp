@@ -0,0 +1,89 @@
+#include "cpu_features.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <cstdint>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace {
+
+uint64_t readXcr0() {
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+}
+
+} // namespace
+
+CpuTier detectCpuTier() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return CpuTier::Scalar;
+
+    const bool sse42 = (ecx & bit_SSE4_2) && (ecx & bit_POPCNT);
+    const bool osxsave = ecx & bit_OSXSAVE;
+    if (!sse42) return CpuTier::Scalar;
+    if (!osxsave) return CpuTier::Sse42;
+
+    // The OS must save the YMM (and for AVX-512 the opmask/ZMM) state
+    const uint64_t xcr0 = readXcr0();
+    const bool ymm_state = (xcr0 & 0x6) == 0x6;
+    const bool zmm_state = (xcr0 & 0xe6) == 0xe6;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return CpuTier::Sse42;
+    const bool avx2 = ymm_state && (ebx & bit_AVX2);
+    const bool avx512 = zmm_state && (ebx & bit_AVX512F) && (ebx & bit_AVX512BW);
+
+    if (avx2 && avx512) return CpuTier::Avx512;
+    if (avx2) return CpuTier::Avx2;
+    return CpuTier::Sse42;
+}
+
+#else
+
+CpuTier detectCpuTier() {
+#if defined(__aarch64__) || defined(__ARM_NEON)
+    return CpuTier::Neon;
+#else
+    return CpuTier::Scalar;
+#endif
+}
+
+#endif
+
+bool cpuTierSupported(CpuTier tier, CpuTier detected) {
+    if (tier == CpuTier::Scalar) return true;
+    if (tier == CpuTier::Neon || detected == CpuTier::Neon) return tier == detected;
+    return static_cast<int>(tier) <= static_cast<int>(detected);
+}
+
+bool parseCpuTier(const std::string& value, CpuTier& tier) {
+    if (value == "native") {
+        tier = detectCpuTier();
+    } else if (value == "scalar") {
+        tier = CpuTier::Scalar;
+    } else if (value == "sse4.2" || value == "sse42") {
+        tier = CpuTier::Sse42;
+    } else if (value == "avx2") {
+        tier = CpuTier::Avx2;
+    } else if (value == "avx512") {
+        tier = CpuTier::Avx512;
+    } else if (value == "neon") {
+        tier = CpuTier::Neon;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* cpuTierName(CpuTier tier) {
+    switch (tier) {
+        case CpuTier::Scalar: return "scalar";
+        case CpuTier::Sse42: return "sse4.2";
+        case CpuTier::Avx2: return "avx2";
+        case CpuTier::Avx512: return "avx512";
+        case CpuTier::Neon: return "neon";
+    }
+    return "unknown";
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+// Instruction set tiers the scan kernels are built for, ordered from the
+// least to the most capable within each architecture.
+enum class CpuTier {
+    Scalar,
+    Sse42,
+    Avx2,
+    Avx512,
+    Neon,
+};
+
+// Highest tier the running CPU (and OS, for the wide register state) supports
+CpuTier detectCpuTier();
+
+// True when `tier` can run on a machine whose best tier is `detected`
+bool cpuTierSupported(CpuTier tier, CpuTier detected);
+
+// Parse a --cpu-features value: scalar, sse4.2, avx2, avx512, neon or native
+bool parseCpuTier(const std::string& value, CpuTier& tier);
+
+const char* cpuTierName(CpuTier tier);
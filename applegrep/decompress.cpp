@@ -0,0 +1,503 @@
+#include "decompress.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+#ifdef APPLEGREP_WITH_ZSTD
+#include <zstd.h>
+#endif
+#ifdef APPLEGREP_WITH_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace {
+
+// Compressed bytes read from the input at a time
+constexpr size_t kInputBytes = 256 << 10;
+
+// Frames are decoded in groups of about this much output. Frames that claim
+// more than kMaxFrameBytes are left to the streaming decoder.
+constexpr size_t kGroupBytes = 4 << 20;
+constexpr size_t kMaxFrameBytes = 256 << 20;
+constexpr unsigned kMaxDecoders = 8;
+
+uint32_t readLittle16(const char* bytes) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+    return b[0] | b[1] << 8;
+}
+
+uint32_t readLittle32(const char* bytes) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+    return b[0] | b[1] << 8 | b[2] << 16 | static_cast<uint32_t>(b[3]) << 24;
+}
+
+// Each decoder reads compressed bytes from `input` only when it has used up
+// the last ones and has no output left over from a full `to`; a read returns
+// early rather than wait on a slow input once it has produced something.
+
+class GzipDecompressor : public StreamSource {
+public:
+    explicit GzipDecompressor(std::unique_ptr<StreamSource> input)
+        : input(std::move(input)), buffer(kInputBytes) {
+        inflateInit2(&stream, 15 + 16);
+    }
+
+    ~GzipDecompressor() override { inflateEnd(&stream); }
+
+    ssize_t read(char* to, size_t room, std::string& error) override {
+        stream.next_out = reinterpret_cast<Bytef*>(to);
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(room, UINT_MAX));
+        const uInt wanted = stream.avail_out;
+        while (stream.avail_out > 0 && !finished) {
+            if (stream.avail_in == 0 && !flushing) {
+                if (stream.avail_out < wanted && !input->ready()) break;
+                const ssize_t got = input->read(buffer.data(), buffer.size(), error);
+                if (got < 0) return -1;
+                if (got == 0) {
+                    if (in_member) {
+                        error = "truncated gzip input";
+                        return -1;
+                    }
+                    finished = true;
+                    break;
+                }
+                stream.next_in = reinterpret_cast<Bytef*>(buffer.data());
+                stream.avail_in = static_cast<uInt>(got);
+            }
+            if (!in_member && stream.avail_in > 0) {
+                // Another member, or trailing bytes that gzip ignores as well
+                if (stream.next_in[0] != 0x1f) {
+                    finished = true;
+                    break;
+                }
+                inflateReset(&stream);
+                in_member = true;
+            }
+            const int result = inflate(&stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                in_member = false;
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                error = std::string("invalid gzip input: ") + (stream.msg ? stream.msg : "bad data");
+                return -1;
+            }
+            flushing = stream.avail_out == 0;
+        }
+        return static_cast<ssize_t>(wanted - stream.avail_out);
+    }
+
+    bool ready() override { return finished || flushing || stream.avail_in > 0 || input->ready(); }
+
+private:
+    const std::unique_ptr<StreamSource> input;
+    std::vector<char> buffer;
+    z_stream stream = {};
+    bool in_member = false;  // Between a member's header and its end
+    bool flushing = false;   // The last read filled `to`; zlib may hold more
+    bool finished = false;
+};
+
+#ifdef APPLEGREP_WITH_ZSTD
+class ZstdDecompressor : public StreamSource {
+public:
+    explicit ZstdDecompressor(std::unique_ptr<StreamSource> input)
+        : input(std::move(input)), buffer(ZSTD_DStreamInSize()), context(ZSTD_createDCtx()) {}
+
+    ~ZstdDecompressor() override { ZSTD_freeDCtx(context); }
+
+    ssize_t read(char* to, size_t room, std::string& error) override {
+        ZSTD_outBuffer out = {to, room, 0};
+        while (out.pos < out.size) {
+            if (in.pos == in.size && !flushing) {
+                if (out.pos > 0 && !input->ready()) break;
+                const ssize_t got = input->read(buffer.data(), buffer.size(), error);
+                if (got < 0) return -1;
+                if (got == 0) {
+                    if (!frame_done) {
+                        error = "truncated zstd input";
+                        return -1;
+                    }
+                    break;
+                }
+                in = {buffer.data(), static_cast<size_t>(got), 0};
+            }
+            const size_t result = ZSTD_decompressStream(context, &out, &in);
+            if (ZSTD_isError(result)) {
+                error = std::string("invalid zstd input: ") + ZSTD_getErrorName(result);
+                return -1;
+            }
+            frame_done = result == 0;
+            flushing = out.pos == out.size;
+        }
+        return static_cast<ssize_t>(out.pos);
+    }
+
+    bool ready() override { return flushing || in.pos < in.size || input->ready(); }
+
+private:
+    const std::unique_ptr<StreamSource> input;
+    std::vector<char> buffer;
+    ZSTD_DCtx* const context;
+    ZSTD_inBuffer in = {nullptr, 0, 0};
+    bool frame_done = false;
+    bool flushing = false;
+};
+#endif
+
+#ifdef APPLEGREP_WITH_LZ4
+class Lz4Decompressor : public StreamSource {
+public:
+    explicit Lz4Decompressor(std::unique_ptr<StreamSource> input)
+        : input(std::move(input)), buffer(kInputBytes) {
+        LZ4F_createDecompressionContext(&context, LZ4F_VERSION);
+    }
+
+    ~Lz4Decompressor() override { LZ4F_freeDecompressionContext(context); }
+
+    ssize_t read(char* to, size_t room, std::string& error) override {
+        size_t produced = 0;
+        while (produced < room) {
+            if (in_pos == in_size && !flushing) {
+                if (produced > 0 && !input->ready()) break;
+                const ssize_t got = input->read(buffer.data(), buffer.size(), error);
+                if (got < 0) return -1;
+                if (got == 0) {
+                    if (!frame_done) {
+                        error = "truncated lz4 input";
+                        return -1;
+                    }
+                    break;
+                }
+                in_pos = 0;
+                in_size = static_cast<size_t>(got);
+            }
+            size_t out_bytes = room - produced;
+            size_t in_bytes = in_size - in_pos;
+            const size_t hint = LZ4F_decompress(context, to + produced, &out_bytes,
+                                                buffer.data() + in_pos, &in_bytes, nullptr);
+            if (LZ4F_isError(hint)) {
+                error = std::string("invalid lz4 input: ") + LZ4F_getErrorName(hint);
+                return -1;
+            }
+            in_pos += in_bytes;
+            produced += out_bytes;
+            frame_done = hint == 0;
+            flushing = produced == room;
+        }
+        return static_cast<ssize_t>(produced);
+    }
+
+    bool ready() override { return flushing || in_pos < in_size || input->ready(); }
+
+private:
+    const std::unique_ptr<StreamSource> input;
+    std::vector<char> buffer;
+    LZ4F_dctx* context = nullptr;
+    size_t in_pos = 0;
+    size_t in_size = 0;
+    bool frame_done = false;
+    bool flushing = false;
+};
+#endif
+
+// A frame that decodes on its own, and the bytes it decodes to
+struct Frame {
+    size_t offset;
+    size_t length;
+    size_t output;
+};
+
+// Decode `count` frames of `data` one after the other into `to`
+using DecodeFramesFn = bool (*)(const char* data, const Frame* frames, size_t count, char* to,
+                                std::string& error);
+
+// BGZF is gzip whose members carry their own length in a "BC" extra field,
+// and their decoded length (at most 64 KiB) in the trailer
+constexpr size_t kBgzfMaxOutput = 64 << 10;
+
+bool findBgzfFrames(const char* data, size_t length, std::vector<Frame>& frames) {
+    for (size_t offset = 0; offset < length;) {
+        const char* member = data + offset;
+        const size_t left = length - offset;
+        if (left < 18 || readLittle32(member) != 0x04088b1f) return false;
+        const size_t extra_end = 12 + readLittle16(member + 10);
+        size_t member_length = 0;
+        for (size_t field = 12; field + 4 <= extra_end && extra_end <= left;) {
+            const size_t field_length = readLittle16(member + field + 2);
+            // A subfield running past the extra field leaves the member unframed
+            if (field + 4 + field_length > extra_end) break;
+            if (member[field] == 'B' && member[field + 1] == 'C' && field_length == 2) {
+                member_length = readLittle16(member + field + 4) + 1;
+            }
+            field += 4 + field_length;
+        }
+        if (member_length < extra_end + 8 || member_length > left) return false;
+        const size_t output = readLittle32(member + member_length - 4);
+        if (output > kBgzfMaxOutput) return false;
+        frames.push_back({offset, member_length, output});
+        offset += member_length;
+    }
+    return frames.size() > 1;
+}
+
+bool decodeBgzfFrames(const char* data, const Frame* frames, size_t count, char* to,
+                      std::string& error) {
+    z_stream stream = {};
+    inflateInit2(&stream, -15);
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; ++i) {
+        const char* member = data + frames[i].offset;
+        const size_t deflate_start = 12 + readLittle16(member + 10);
+        inflateReset(&stream);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(member + deflate_start));
+        stream.avail_in = static_cast<uInt>(frames[i].length - deflate_start - 8);
+        stream.next_out = reinterpret_cast<Bytef*>(to);
+        stream.avail_out = static_cast<uInt>(frames[i].output);
+        const uint32_t crc = readLittle32(member + frames[i].length - 8);
+        ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0 &&
+             crc32(0, reinterpret_cast<const Bytef*>(to), static_cast<uInt>(frames[i].output)) == crc;
+        to += frames[i].output;
+    }
+    inflateEnd(&stream);
+    if (!ok) error = "invalid gzip input";
+    return ok;
+}
+
+#ifdef APPLEGREP_WITH_ZSTD
+// Every frame (skippable ones included) is walked by its block headers; one
+// without a content size in its header leaves the input to the stream
+// decoder
+bool findZstdFrames(const char* data, size_t length, std::vector<Frame>& frames) {
+    for (size_t offset = 0; offset < length;) {
+        const size_t frame_length = ZSTD_findFrameCompressedSize(data + offset, length - offset);
+        const unsigned long long output = ZSTD_getFrameContentSize(data + offset, length - offset);
+        if (ZSTD_isError(frame_length) || output == ZSTD_CONTENTSIZE_UNKNOWN ||
+            output == ZSTD_CONTENTSIZE_ERROR || output > kMaxFrameBytes) {
+            return false;
+        }
+        frames.push_back({offset, frame_length, static_cast<size_t>(output)});
+        offset += frame_length;
+    }
+    return frames.size() > 1;
+}
+
+bool decodeZstdFrames(const char* data, const Frame* frames, size_t count, char* to,
+                      std::string& error) {
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    for (size_t i = 0; i < count; ++i) {
+        const size_t got = ZSTD_decompressDCtx(context, to, frames[i].output,
+                                               data + frames[i].offset, frames[i].length);
+        if (ZSTD_isError(got) || got != frames[i].output) {
+            error = std::string("invalid zstd input: ") +
+                    (ZSTD_isError(got) ? ZSTD_getErrorName(got) : "wrong frame size");
+            ZSTD_freeDCtx(context);
+            return false;
+        }
+        to += got;
+    }
+    ZSTD_freeDCtx(context);
+    return true;
+}
+#endif
+
+// Decodes groups of frames on its own threads, a bounded number of groups
+// ahead of the reader, and hands the output back in order
+class FrameGroupSource : public StreamSource {
+public:
+    FrameGroupSource(const char* data, std::vector<Frame> frames, DecodeFramesFn decode)
+        : data(data), frames(std::move(frames)), decode(decode) {
+        for (size_t begin = 0; begin < this->frames.size();) {
+            Group group{begin, begin, 0};
+            while (group.end < this->frames.size() &&
+                   (group.end == begin || group.output < kGroupBytes)) {
+                group.output += this->frames[group.end++].output;
+            }
+            groups.push_back(group);
+            begin = group.end;
+        }
+        results.resize(groups.size());
+
+        const unsigned decoders = static_cast<unsigned>(std::min<size_t>(
+            std::clamp(std::thread::hardware_concurrency(), 1u, kMaxDecoders), groups.size()));
+        window = 2 * decoders;
+        for (unsigned i = 0; i < decoders; ++i) threads.emplace_back([this] { decoder(); });
+    }
+
+    ~FrameGroupSource() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    ssize_t read(char* to, size_t room, std::string& error) override {
+        size_t copied = 0;
+        while (copied < room) {
+            if (offset == current_length) {
+                if (next_read == groups.size()) break;
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this] { return results[next_read].done; });
+                Result& result = results[next_read];
+                if (!result.error.empty()) {
+                    error = result.error;
+                    return -1;
+                }
+                current = std::move(result.text);
+                current_length = groups[next_read].output;
+                offset = 0;
+                ++next_read;
+                lock.unlock();
+                changed.notify_all();
+            }
+            const size_t count = std::min(room - copied, current_length - offset);
+            memcpy(to + copied, current.get() + offset, count);
+            copied += count;
+            offset += count;
+        }
+        return static_cast<ssize_t>(copied);
+    }
+
+    bool ready() override { return true; }
+
+private:
+    struct Group {
+        size_t begin;  // Frames [begin, end)
+        size_t end;
+        size_t output;
+    };
+
+    struct Result {
+        bool done = false;
+        std::unique_ptr<char[]> text;
+        std::string error;
+    };
+
+    void decoder() {
+        for (;;) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this] {
+                    return stopping || next_decode == groups.size() ||
+                           next_decode < next_read + window;
+                });
+                if (stopping || next_decode == groups.size()) return;
+                index = next_decode++;
+            }
+            const Group& group = groups[index];
+            std::unique_ptr<char[]> text(new char[std::max<size_t>(group.output, 1)]);
+            std::string error;
+            decode(data, &frames[group.begin], group.end - group.begin, text.get(), error);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results[index] = {true, std::move(text), std::move(error)};
+            }
+            changed.notify_all();
+        }
+    }
+
+    const char* const data;
+    const std::vector<Frame> frames;
+    const DecodeFramesFn decode;
+    std::vector<Group> groups;
+    size_t window = 0;  // Groups decoded or being decoded ahead of the reader
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Result> results;
+    size_t next_decode = 0;
+    size_t next_read = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+    // The group being read; only the reader touches these
+    std::unique_ptr<char[]> current;
+    size_t current_length = 0;
+    size_t offset = 0;
+};
+
+} // namespace
+
+Compression detectCompression(const char* data, size_t length) {
+    if (length >= 2 && readLittle16(data) == 0x8b1f) return Compression::Gzip;
+    if (length >= 4 && readLittle32(data) == 0xfd2fb528) return Compression::Zstd;
+    if (length >= 4 && readLittle32(data) == 0x184d2204) return Compression::Lz4;
+    return Compression::None;
+}
+
+const char* compressionName(Compression compression) {
+    switch (compression) {
+    case Compression::None: return "none";
+    case Compression::Gzip: return "gzip";
+    case Compression::Zstd: return "zstd";
+    case Compression::Lz4: return "lz4";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<StreamSource> createDecompressor(Compression compression,
+                                                 std::unique_ptr<StreamSource> input,
+                                                 std::string& error) {
+    switch (compression) {
+    case Compression::None:
+        return input;
+    case Compression::Gzip:
+        return std::make_unique<GzipDecompressor>(std::move(input));
+    case Compression::Zstd:
+#ifdef APPLEGREP_WITH_ZSTD
+        return std::make_unique<ZstdDecompressor>(std::move(input));
+#else
+        break;
+#endif
+    case Compression::Lz4:
+#ifdef APPLEGREP_WITH_LZ4
+        return std::make_unique<Lz4Decompressor>(std::move(input));
+#else
+        break;
+#endif
+    }
+    error = std::string("cannot decompress ") + compressionName(compression) +
+            " input: built without " + compressionName(compression) + " support";
+    return nullptr;
+}
+
+std::unique_ptr<StreamSource> openDecompressed(const char* data, size_t length,
+                                               Compression& compression, std::string& error) {
+    compression = detectCompression(data, length);
+    if (compression == Compression::None) return nullptr;
+
+    // On one core, decoding frames apart only adds a copy
+    std::vector<Frame> frames;
+    const bool parallel = std::thread::hardware_concurrency() > 1;
+    if (parallel && compression == Compression::Gzip && findBgzfFrames(data, length, frames)) {
+        return std::make_unique<FrameGroupSource>(data, std::move(frames), decodeBgzfFrames);
+    }
+#ifdef APPLEGREP_WITH_ZSTD
+    frames.clear();
+    if (parallel && compression == Compression::Zstd && findZstdFrames(data, length, frames)) {
+        return std::make_unique<FrameGroupSource>(data, std::move(frames), decodeZstdFrames);
+    }
+#endif
+    return createDecompressor(compression, createMemorySource(data, length), error);
+}
+
+std::unique_ptr<StreamSource> openDecompressed(const InputFile& input, Compression& compression,
+                                               std::string& error) {
+    if (input.mapped()) return openDecompressed(input.data(), input.size(), compression, error);
+
+    // Read just enough to recognise the format; the source then returns those
+    // bytes again before the rest
+    std::unique_ptr<StreamSource> source = createFdSource(input.descriptor());
+    std::string magic;
+    if (!peekSource(source, kCompressionMagicBytes, magic, error)) return nullptr;
+    compression = detectCompression(magic.data(), magic.size());
+    return createDecompressor(compression, std::move(source), error);
+}
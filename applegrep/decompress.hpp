@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "input_file.hpp"
+#include "stream_source.hpp"
+
+// Compressed formats recognised by -z, from their first bytes. gzip goes
+// through zlib and is always built; zstd and lz4 need libzstd and liblz4 and
+// are built with APPLEGREP_WITH_ZSTD and APPLEGREP_WITH_LZ4 defined.
+enum class Compression { None, Gzip, Zstd, Lz4 };
+
+// Bytes detectCompression() needs to tell the formats apart
+constexpr size_t kCompressionMagicBytes = 4;
+
+Compression detectCompression(const char* data, size_t length);
+
+const char* compressionName(Compression compression);
+
+// A source that decompresses `input` as it is read, on whatever thread reads
+// it. Concatenated gzip members and zstd or lz4 frames are all decoded.
+// Returns null and fills `error` when built without the format's decoder.
+std::unique_ptr<StreamSource> createDecompressor(Compression compression,
+                                                 std::unique_ptr<StreamSource> input,
+                                                 std::string& error);
+
+// A source that decompresses [data, data + length), which must outlive it.
+// Returns null when the bytes are not compressed, and null with `error`
+// filled when their decoder is not built in.
+//
+// zstd data of several frames (such as the seekable format) and BGZF, whose
+// frame boundaries can be found without decoding, are decompressed a group
+// of frames at a time on several threads and read back in order, when there
+// is more than one core.
+std::unique_ptr<StreamSource> openDecompressed(const char* data, size_t length,
+                                               Compression& compression, std::string& error);
+
+// A source for `input` under -z. A mapped input is handled as above, so null
+// without an error means it is not compressed and can be searched in place.
+// An unmapped input is always read through the returned source, which
+// decompresses when the first bytes name a format.
+std::unique_ptr<StreamSource> openDecompressed(const InputFile& input, Compression& compression,
+                                               std::string& error);
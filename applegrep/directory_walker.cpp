@@ -0,0 +1,259 @@
+#include "directory_walker.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "work_stealing_pool.hpp"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+// Directories being listed at once. Listing is mostly waiting on the
+// filesystem, so even one core gains from a few; many more only take pool
+// workers from scanning.
+constexpr size_t kMaxListing = 8;
+
+// Files found but not yet queued for search. Past this no more directories
+// are listed until the search catches up.
+constexpr size_t kMaxBacklog = 4096;
+
+enum class EntryKind { Directory, File, Skipped };
+
+EntryKind kindOf(unsigned char type, int dir_fd, const char* name) {
+    switch (type) {
+    case DT_DIR: return EntryKind::Directory;
+    case DT_REG: return EntryKind::File;
+    case DT_UNKNOWN: break;
+    default: return EntryKind::Skipped;
+    }
+    // Some filesystems do not fill in d_type
+    struct stat info;
+    if (fstatat(dir_fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0) return EntryKind::Skipped;
+    if (S_ISDIR(info.st_mode)) return EntryKind::Directory;
+    return S_ISREG(info.st_mode) ? EntryKind::File : EntryKind::Skipped;
+}
+
+bool isDotOrDotDot(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+// Length of `directory` plus the '/' that joinPath() puts after it
+size_t childBase(const std::string& directory) {
+    return directory.size() + (!directory.empty() && directory.back() == '/' ? 0 : 1);
+}
+
+std::string joinPath(const std::string& directory, const char* name) {
+    std::string path = directory;
+    if (path.empty() || path.back() != '/') path += '/';
+    return path += name;
+}
+
+bool isGitDirectory(const std::string& path) {
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, "/.git") == 0;
+}
+
+// Call on_entry(name, kind) for each entry of the open directory `fd`.
+// Returns false when reading the directory fails.
+template <typename Fn>
+bool listDirectory(int fd, Fn&& on_entry) {
+#ifdef __linux__
+    // getdents64 fills a buffer with many entries per syscall, and needs no
+    // DIR allocation
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+    alignas(8) char buffer[32 << 10];
+    for (;;) {
+        const long got = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (got == 0) return true;
+        if (got < 0) return false;
+        for (long offset = 0; offset < got;) {
+            const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+            if (!isDotOrDotDot(entry->d_name)) {
+                on_entry(entry->d_name, kindOf(entry->d_type, fd, entry->d_name));
+            }
+        }
+    }
+#else
+    DIR* dir = fdopendir(dup(fd));
+    if (!dir) return false;
+    while (const dirent* entry = readdir(dir)) {
+        if (!isDotOrDotDot(entry->d_name)) {
+            on_entry(entry->d_name, kindOf(entry->d_type, fd, entry->d_name));
+        }
+    }
+    closedir(dir);
+    return true;
+#endif
+}
+
+struct PendingDirectory {
+    std::string path;
+    size_t root_base;  // Where the part relative to the walk root starts
+    std::shared_ptr<const IgnoreLayer> layer;
+};
+
+class Walk {
+public:
+    Walk(const PathFilter& filter, BoundedQueue<std::string>& paths, WalkStats& stats)
+        : filter(filter), paths(paths), stats(stats) {}
+
+    void addRoot(const std::string& directory) {
+        pending.push_back({directory, childBase(directory), nullptr});
+    }
+
+    // List directories as tasks on the shared pool, so walking and scanning
+    // share its workers. This thread hands the files found to `paths`, which
+    // may block, and a task never does.
+    void run() {
+        WorkStealingPool& pool = sharedPool();
+        TaskGroup group;
+        std::vector<std::string> files;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            while (listing < kMaxListing && backlog.size() < kMaxBacklog && !pending.empty()) {
+                ++listing;
+                pool.submit(group, [this, directory = std::move(pending.back())] {
+                    list(directory);
+                });
+                pending.pop_back();
+            }
+            if (!backlog.empty()) {
+                files.swap(backlog);
+                lock.unlock();
+                for (std::string& file : files) paths.push(std::move(file));
+                files.clear();
+                lock.lock();
+                continue;
+            }
+            if (listing == 0 && pending.empty()) break;
+            changed.wait(lock);
+        }
+        lock.unlock();
+        pool.wait(group);
+    }
+
+private:
+    using Entry = std::pair<std::string, EntryKind>;
+
+    // One directory task: its files join the backlog and its subdirectories
+    // the stack of directories to list, taken LIFO
+    void list(const PendingDirectory& directory) {
+        std::vector<PendingDirectory> found;
+        std::vector<std::string> files;
+        std::vector<Entry> entries;
+        const bool ok = visit(directory, found, files, entries);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (PendingDirectory& subdirectory : found) pending.push_back(std::move(subdirectory));
+            for (std::string& file : files) backlog.push_back(std::move(file));
+            ++stats.directories;
+            if (!ok) ++stats.unreadable;
+            --listing;
+        }
+        changed.notify_one();
+    }
+
+    // List one directory: files go to `files`, subdirectories to `found`.
+    // The whole listing is read before anything is handed on, since its
+    // ignore files apply to every entry.
+    bool visit(const PendingDirectory& directory, std::vector<PendingDirectory>& found,
+               std::vector<std::string>& files, std::vector<Entry>& entries) {
+        const int fd = open(directory.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            report(directory.path);
+            return false;
+        }
+        entries.clear();
+        bool has_gitignore = false;
+        bool has_ignore = false;
+        const bool ok = listDirectory(fd, [&](const char* name, EntryKind kind) {
+            if (kind == EntryKind::Skipped) return;
+            if (kind == EntryKind::File) {
+                has_gitignore |= strcmp(name, ".gitignore") == 0;
+                has_ignore |= strcmp(name, ".ignore") == 0;
+            }
+            entries.emplace_back(joinPath(directory.path, name), kind);
+        });
+        if (!ok) report(directory.path);
+        const std::shared_ptr<const IgnoreLayer> layer =
+            filter.enter(fd, childBase(directory.path), has_gitignore, has_ignore, directory.layer);
+        close(fd);
+
+        size_t ignored = 0;
+        const bool filtering = filter.active();
+        for (Entry& entry : entries) {
+            const bool is_directory = entry.second == EntryKind::Directory;
+            if (filtering &&
+                ((is_directory && filter.ignoreFiles() && isGitDirectory(entry.first)) ||
+                 filter.skip(entry.first, directory.root_base, is_directory, layer.get()))) {
+                ++ignored;
+            } else if (is_directory) {
+                found.push_back({std::move(entry.first), directory.root_base, layer});
+            } else {
+                files.push_back(std::move(entry.first));
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.files += files.size();
+        stats.ignored += ignored;
+        return ok;
+    }
+
+    void report(const std::string& directory) {
+        const int error = errno;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cerr << "cannot read directory " << directory << ": " << strerror(error) << std::endl;
+    }
+
+    const PathFilter& filter;
+    BoundedQueue<std::string>& paths;
+    WalkStats& stats;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<PendingDirectory> pending;  // Directories to list, taken LIFO
+    std::vector<std::string> backlog;       // Files to hand to `paths`
+    size_t listing = 0;                     // Directory tasks not finished
+};
+
+} // namespace
+
+void walkDirectories(const std::vector<std::string>& roots, const PathFilter& filter,
+                     BoundedQueue<std::string>& paths, WalkStats& stats) {
+    const auto start = std::chrono::steady_clock::now();
+    Walk walk(filter, paths, stats);
+    for (const std::string& root : roots) {
+        struct stat info;
+        if (stat(root.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            walk.addRoot(root);
+        } else {
+            // Named files are searched whatever they are; errors show up there
+            paths.push(root);
+            ++stats.files;
+        }
+    }
+    walk.run();
+    paths.close();
+    stats.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "path_filter.hpp"
+
+// What a walk visited, for --stats
+struct WalkStats {
+    size_t directories = 0;
+    size_t files = 0;
+    size_t unreadable = 0;
+    size_t ignored = 0;  // Entries skipped by the PathFilter
+    double seconds = 0;  // From the start until the last directory was listed
+};
+
+// Push every file under `roots` onto `paths`, then close it. Roots that are
+// not directories are pushed as they are. Directories are listed as tasks on
+// the shared pool (see work_stealing_pool.hpp), a few at a time from one
+// stack of directories to visit, with getdents64 on Linux (readdir
+// elsewhere). Entries are classified by d_type, so a file costs no stat()
+// unless the filesystem leaves its type unknown. As in
+// grep -r, symbolic links and special files met during the walk are skipped,
+// and so are entries `filter` rejects (with ignore files on, .git too).
+// Files are pushed from the calling thread as each directory is listed, so
+// scanning starts with the first directory; a full queue holds the walk
+// back without blocking a pool worker.
+void walkDirectories(const std::vector<std::string>& roots, const PathFilter& filter,
+                     BoundedQueue<std::string>& paths, WalkStats& stats);
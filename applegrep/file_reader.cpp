@@ -0,0 +1,87 @@
+#include "file_reader.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+class ThreadFileReader : public FileReader {
+public:
+    const char* name() const override { return "threads"; }
+
+    void run(BoundedQueue<std::string>& paths, const FileFn& on_file) override {
+        std::string path;
+        size_t slot;
+        while (next(paths, path, slot)) {
+            ReadFile file;
+            file.index = next_index++;
+            file.path = std::move(path);
+            load(file, slot);
+            if (!file.loaded) release(slot);
+            on_file(std::move(file));
+        }
+    }
+
+private:
+    void load(ReadFile& file, size_t slot) {
+        const int fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            file.error = errno;
+            return;
+        }
+        // Anything but a small regular file is left to InputFile. So are
+        // files that claim to be empty but are not, such as /proc entries.
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+            static_cast<size_t>(info.st_size) <= kSlotBytes) {
+            char* data = slotData(slot);
+            const size_t wanted = info.st_size > 0 ? static_cast<size_t>(info.st_size) : kSlotBytes;
+            size_t length = 0;
+            while (length < wanted) {
+                const ssize_t got = read(fd, data + length, wanted - length);
+                if (got < 0 && errno == EINTR) continue;
+                if (got <= 0) break;
+                length += static_cast<size_t>(got);
+            }
+            if (info.st_size > 0 || length == 0) {
+                file.loaded = true;
+                file.data = data;
+                file.length = length;
+                file.slot = slot;
+            }
+        }
+        close(fd);
+    }
+};
+
+} // namespace
+
+FileReader::FileReader() : slots(new char[kSlots * kSlotBytes]), free_slots(kSlots) {
+    for (size_t slot = 0; slot < kSlots; ++slot) free_slots.push(slot);
+}
+
+bool FileReader::next(BoundedQueue<std::string>& paths, std::string& path, size_t& slot) {
+    if (!free_slots.pop(slot)) return false;
+    if (paths.pop(path)) return true;
+    release(slot);
+    return false;
+}
+
+bool FileReader::tryNext(BoundedQueue<std::string>& paths, std::string& path, size_t& slot) {
+    if (!free_slots.tryPop(slot)) return false;
+    if (paths.tryPop(path)) return true;
+    release(slot);
+    return false;
+}
+
+std::unique_ptr<FileReader> createThreadFileReader() {
+    return std::make_unique<ThreadFileReader>();
+}
+
+std::unique_ptr<FileReader> createFileReader() {
+    std::unique_ptr<FileReader> reader = createUringFileReader();
+    return reader ? std::move(reader) : createThreadFileReader();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+// One input handed out by a FileReader. Small regular files arrive read
+// whole: `data` holds them in one of the reader's slots until release(slot).
+// Larger and special files arrive unread, for the consumer to open by path
+// (see InputFile), and so do files that could not be opened, with `error`
+// set to the errno.
+struct ReadFile {
+    size_t index = 0;  // Position of the path in the order it was queued
+    std::string path;
+    bool loaded = false;
+    const char* data = nullptr;
+    size_t length = 0;
+    size_t slot = 0;
+    int error = 0;
+};
+
+// Reads many files into a fixed set of buffers, for searches where the
+// open/read/close syscalls of small files outweigh scanning them. run() is
+// the producer side of a pipeline: it blocks while every slot holds a file
+// that has not been released, so reading stays at most a slot count ahead of
+// scanning.
+class FileReader {
+public:
+    using FileFn = std::function<void(ReadFile&& file)>;
+
+    FileReader();
+    virtual ~FileReader() = default;
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    virtual const char* name() const = 0;
+
+    // Read the paths popped from `paths` until it is closed, calling
+    // `on_file` once for each, in completion order, from this thread
+    virtual void run(BoundedQueue<std::string>& paths, const FileFn& on_file) = 0;
+
+    // Hand a loaded file's slot back once it has been scanned; any thread
+    void release(size_t slot) { free_slots.push(slot); }
+
+    // Files up to this size are read into a slot
+    static constexpr size_t kSlotBytes = 256 << 10;
+    static constexpr size_t kSlots = 64;
+
+protected:
+    char* slotData(size_t slot) { return slots.get() + slot * kSlotBytes; }
+
+    // Take a free slot and the next path together, waiting for either.
+    // False once `paths` is closed and drained.
+    bool next(BoundedQueue<std::string>& paths, std::string& path, size_t& slot);
+
+    // next() that fails instead of waiting, for filling up a batch
+    bool tryNext(BoundedQueue<std::string>& paths, std::string& path, size_t& slot);
+
+    std::unique_ptr<char[]> slots;
+    BoundedQueue<size_t> free_slots;
+    size_t next_index = 0;
+};
+
+// Linux io_uring reader, or nullptr when the kernel lacks io_uring or the
+// operations it needs (or a sandbox forbids them)
+std::unique_ptr<FileReader> createUringFileReader();
+
+// Plain open/fstat/read/close from the calling thread
+std::unique_ptr<FileReader> createThreadFileReader();
+
+// The io_uring reader where it works, else the thread-based one
+std::unique_ptr<FileReader> createFileReader();
@@ -0,0 +1,345 @@
+#include "glob_set.hpp"
+
+#include <algorithm>
+#include <bitset>
+
+namespace {
+
+uint32_t later(uint32_t a, uint32_t b) {
+    if (a == GlobSet::kNoMatch) return b;
+    if (b == GlobSet::kNoMatch) return a;
+    return std::max(a, b);
+}
+
+bool hasWildcard(std::string_view glob) {
+    return glob.find_first_of("*?[\\") != std::string_view::npos;
+}
+
+std::bitset<256> anyByte() {
+    return std::bitset<256>().set();
+}
+
+std::bitset<256> notSlash() {
+    return anyByte().reset('/');
+}
+
+RegexNode bytesNode(const std::bitset<256>& bytes) {
+    RegexNode node;
+    node.kind = RegexNode::Kind::Bytes;
+    node.bytes = bytes;
+    return node;
+}
+
+RegexNode byteNode(unsigned char byte) {
+    return bytesNode(std::bitset<256>().set(byte));
+}
+
+RegexNode repeatNode(RegexNode body, int min, int max) {
+    RegexNode node;
+    node.kind = RegexNode::Kind::Repeat;
+    node.children.push_back(std::move(body));
+    node.min = min;
+    node.max = max;
+    return node;
+}
+
+// Any number of whole directories, as `**/` matches: ([^/]*/)*
+RegexNode directoriesNode() {
+    RegexNode one;
+    one.kind = RegexNode::Kind::Concat;
+    one.children.push_back(repeatNode(bytesNode(notSlash()), 0, -1));
+    one.children.push_back(byteNode('/'));
+    return repeatNode(std::move(one), 0, -1);
+}
+
+// Parse the bracket expression opening at glob[i]. On success fill `bytes`
+// (never with '/') and move i past the closing ']'; an unclosed '[' is left
+// to match itself.
+bool parseClass(const std::string& glob, size_t& i, std::bitset<256>& bytes) {
+    size_t j = i + 1;
+    bool negate = false;
+    if (j < glob.size() && (glob[j] == '!' || glob[j] == '^')) {
+        negate = true;
+        ++j;
+    }
+    std::bitset<256> set;
+    for (bool first = true; j < glob.size() && (glob[j] != ']' || first); first = false) {
+        unsigned char low = static_cast<unsigned char>(glob[j]);
+        if (low == '\\' && j + 1 < glob.size()) low = static_cast<unsigned char>(glob[++j]);
+        ++j;
+        unsigned char high = low;
+        if (j + 1 < glob.size() && glob[j] == '-' && glob[j + 1] != ']') {
+            j += glob[j + 1] == '\\' && j + 2 < glob.size() ? 2 : 1;
+            high = static_cast<unsigned char>(glob[j++]);
+        }
+        for (unsigned byte = low; byte <= high; ++byte) set.set(byte);
+    }
+    if (j >= glob.size()) return false;
+    if (negate) set.flip();
+    bytes = set.reset('/');
+    i = j + 1;
+    return true;
+}
+
+// The regex for glob[from, end), anchored at both ends of the input
+RegexNode translate(const std::string& glob, size_t from) {
+    RegexNode root;
+    root.kind = RegexNode::Kind::Concat;
+    for (size_t i = from; i < glob.size();) {
+        const char c = glob[i];
+        if (c == '*') {
+            size_t end = i;
+            while (end < glob.size() && glob[end] == '*') ++end;
+            const bool whole_component = end - i == 2 && (i == from || glob[i - 1] == '/');
+            if (whole_component && end == glob.size()) {
+                // `dir/**`: everything inside dir, but not dir itself
+                root.children.push_back(repeatNode(bytesNode(anyByte()), 1, -1));
+            } else if (whole_component && glob[end] == '/') {
+                root.children.push_back(directoriesNode());
+                ++end;
+            } else {
+                root.children.push_back(repeatNode(bytesNode(notSlash()), 0, -1));
+            }
+            i = end;
+        } else if (c == '?') {
+            root.children.push_back(bytesNode(notSlash()));
+            ++i;
+        } else if (std::bitset<256> bytes; c == '[' && parseClass(glob, i, bytes)) {
+            root.children.push_back(bytesNode(bytes));
+        } else {
+            if (c == '\\' && i + 1 < glob.size()) ++i;
+            root.children.push_back(byteNode(static_cast<unsigned char>(glob[i++])));
+        }
+    }
+    return root;
+}
+
+struct SetHash {
+    size_t operator()(const std::vector<uint32_t>& set) const {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (uint32_t state : set) hash = (hash ^ state) * 0x100000001b3ull;
+        return static_cast<size_t>(hash);
+    }
+};
+
+// Follow the splits from `seeds` (which ends up empty), leaving the sorted
+// set of states that consume a byte or match
+void closure(const Nfa& nfa, std::vector<uint32_t>& seeds, std::vector<uint32_t>& set,
+             std::vector<uint32_t>& seen, uint32_t& epoch) {
+    ++epoch;
+    set.clear();
+    while (!seeds.empty()) {
+        const uint32_t q = seeds.back();
+        seeds.pop_back();
+        if (seen[q] == epoch) continue;
+        seen[q] = epoch;
+        const NfaState& state = nfa.states[q];
+        if (state.kind == NfaState::Kind::Split) {
+            seeds.push_back(state.out1);
+            seeds.push_back(state.out);
+        } else {
+            set.push_back(q);
+        }
+    }
+    std::sort(set.begin(), set.end());
+}
+
+// Seed the states that `set` reaches over `byte`
+void step(const Nfa& nfa, const std::vector<uint32_t>& set, unsigned char byte,
+          std::vector<uint32_t>& seeds) {
+    for (uint32_t q : set) {
+        const NfaState& state = nfa.states[q];
+        if (state.kind == NfaState::Kind::Bytes && nfa.byte_sets[state.index].test(byte)) {
+            seeds.push_back(state.out);
+        }
+    }
+}
+
+} // namespace
+
+void GlobSet::record(Ids& ids, uint32_t id, bool directory_only) {
+    ids.any = later(ids.any, id);
+    if (!directory_only) ids.file = later(ids.file, id);
+}
+
+uint32_t GlobSet::pick(const Ids& ids, bool is_directory) {
+    return is_directory ? ids.any : ids.file;
+}
+
+void GlobSet::addLiteral(std::unordered_map<std::string_view, Ids>& table, std::string key,
+                         uint32_t id, bool directory_only) {
+    auto found = table.find(key);
+    if (found == table.end()) {
+        keys.push_back(std::move(key));
+        found = table.emplace(keys.back(), Ids()).first;
+    }
+    record(found->second, id, directory_only);
+}
+
+void GlobSet::add(const std::string& glob, bool directory_only) {
+    const uint32_t id = static_cast<uint32_t>(glob_count++);
+    directory_only_ids.push_back(directory_only);
+
+    size_t from = !glob.empty() && glob[0] == '/' ? 1 : 0;
+    bool whole_path = glob.find('/') != std::string::npos;
+    // `**/name` matches name at any depth, as a glob with no '/' does
+    if (glob.compare(from, 3, "**/") == 0 && glob.find('/', from + 3) == std::string::npos) {
+        from += 3;
+        whole_path = false;
+    }
+    const std::string_view body = std::string_view(glob).substr(from);
+    if (body.empty()) return;
+
+    if (!hasWildcard(body)) {
+        addLiteral(whole_path ? paths : names, std::string(body), id, directory_only);
+    } else if (!whole_path && body.size() > 1 && body[0] == '*' && !hasWildcard(body.substr(1))) {
+        const std::string_view suffix = body.substr(1);
+        if (suffix[0] == '.' && suffix.find('.', 1) == std::string_view::npos) {
+            addLiteral(extensions, std::string(suffix), id, directory_only);
+        } else {
+            suffixes.push_back({std::string(suffix), id, directory_only});
+        }
+    } else {
+        wild_globs.push_back({glob, from, whole_path, id});
+    }
+}
+
+GlobSet::Ids GlobSet::accepted(const Nfa& nfa, const std::vector<uint32_t>& set) const {
+    Ids ids;
+    for (uint32_t q : set) {
+        const NfaState& state = nfa.states[q];
+        if (state.kind == NfaState::Kind::Match) {
+            record(ids, state.index, directory_only_ids[state.index]);
+        }
+    }
+    return ids;
+}
+
+void GlobSet::finish() {
+    // Globs with no '/' only ever see the last component, so they go in
+    // DFAs of their own and never need a loop over leading directories
+    const size_t names_end = static_cast<size_t>(
+        std::stable_partition(wild_globs.begin(), wild_globs.end(),
+                              [](const WildGlob& wild) { return !wild.whole_path; }) -
+        wild_globs.begin());
+    if (names_end > 0) buildDfas(0, names_end);
+    if (names_end < wild_globs.size()) buildDfas(names_end, wild_globs.size());
+}
+
+void GlobSet::buildDfas(size_t begin, size_t end) {
+    Dfa dfa;
+    dfa.whole_path = wild_globs[begin].whole_path;
+    for (size_t i = begin; i < end; ++i) {
+        const WildGlob& wild = wild_globs[i];
+        dfa.nfa.add(translate(wild.glob, wild.from), wild.id);
+    }
+    dfa.nfa.finish();
+    if (!buildDfa(dfa) && end - begin > 1) {
+        // Globs like `**/a/**/b` multiply each other's states; apart they
+        // stay small
+        const size_t middle = begin + (end - begin) / 2;
+        buildDfas(begin, middle);
+        buildDfas(middle, end);
+        return;
+    }
+    dfas.push_back(std::move(dfa));
+}
+
+bool GlobSet::buildDfa(Dfa& dfa) const {
+    // Subset construction over the byte classes, breadth first
+    const Nfa& nfa = dfa.nfa;
+    const size_t class_count = nfa.class_count;
+    std::unordered_map<std::vector<uint32_t>, uint32_t, SetHash> ids;
+    std::vector<const std::vector<uint32_t>*> sets;
+    auto intern = [&](const std::vector<uint32_t>& set) {
+        auto inserted = ids.emplace(set, static_cast<uint32_t>(sets.size()));
+        if (inserted.second) {
+            sets.push_back(&inserted.first->first);
+            dfa.accept.push_back(accepted(nfa, set));
+            dfa.next.resize(dfa.next.size() + class_count, 0);
+        }
+        return inserted.first->second;
+    };
+
+    std::vector<uint32_t> seen(nfa.states.size(), 0);
+    uint32_t epoch = 0;
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> set;
+    intern(set);
+    seeds = nfa.starts;
+    closure(nfa, seeds, set, seen, epoch);
+    dfa.start = intern(set);
+
+    for (size_t state = 1; state < sets.size(); ++state) {
+        if (sets.size() > kMaxDfaStates) {
+            dfa.next = {};
+            dfa.accept = {};
+            return false;
+        }
+        for (size_t byte_class = 0; byte_class < class_count; ++byte_class) {
+            step(nfa, *sets[state], nfa.class_bytes[byte_class], seeds);
+            closure(nfa, seeds, set, seen, epoch);
+            dfa.next[state * class_count + byte_class] = intern(set);
+        }
+    }
+    dfa.built = true;
+    return true;
+}
+
+uint32_t GlobSet::matchNfa(const Nfa& nfa, std::string_view path, bool is_directory) const {
+    std::vector<uint32_t> seen(nfa.states.size(), 0);
+    uint32_t epoch = 0;
+    std::vector<uint32_t> seeds = nfa.starts;
+    std::vector<uint32_t> set;
+    closure(nfa, seeds, set, seen, epoch);
+    for (unsigned char byte : path) {
+        step(nfa, set, byte, seeds);
+        closure(nfa, seeds, set, seen, epoch);
+        if (set.empty()) return kNoMatch;
+    }
+    return pick(accepted(nfa, set), is_directory);
+}
+
+uint32_t GlobSet::match(std::string_view path, bool is_directory) const {
+    const size_t slash = path.rfind('/');
+    const std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    uint32_t best = kNoMatch;
+
+    if (!names.empty()) {
+        const auto found = names.find(name);
+        if (found != names.end()) best = later(best, pick(found->second, is_directory));
+    }
+    if (!paths.empty()) {
+        const auto found = paths.find(path);
+        if (found != paths.end()) best = later(best, pick(found->second, is_directory));
+    }
+    const size_t dot = name.rfind('.');
+    if (!extensions.empty() && dot != std::string_view::npos) {
+        const auto found = extensions.find(name.substr(dot));
+        if (found != extensions.end()) best = later(best, pick(found->second, is_directory));
+    }
+    for (const Suffix& suffix : suffixes) {
+        if ((is_directory || !suffix.directory_only) && name.size() >= suffix.text.size() &&
+            name.compare(name.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0) {
+            best = later(best, suffix.id);
+        }
+    }
+
+    for (const Dfa& dfa : dfas) {
+        const std::string_view input = dfa.whole_path ? path : name;
+        if (!dfa.built) {
+            best = later(best, matchNfa(dfa.nfa, input, is_directory));
+            continue;
+        }
+        const uint32_t* next = dfa.next.data();
+        const uint8_t* classes = dfa.nfa.byte_classes;
+        const size_t class_count = dfa.nfa.class_count;
+        uint32_t state = dfa.start;
+        for (unsigned char byte : input) {
+            state = next[state * class_count + classes[byte]];
+            if (state == 0) break;
+        }
+        best = later(best, pick(dfa.accept[state], is_directory));
+    }
+    return best;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "nfa.hpp"
+
+// A list of gitignore-style globs compiled into one matcher, so a path is
+// checked against every glob at once instead of calling fnmatch per glob.
+//
+// Globs follow .gitignore: `*` and `?` do not match '/', `[...]` is a byte
+// class, `\` escapes, `**/` matches any number of directories and a trailing
+// `/**` everything inside a directory. A glob with no '/' matches the last
+// path component at any depth; any other glob matches the whole path, and a
+// leading '/' only anchors it.
+//
+// Most globs in ignore files are a plain name (`node_modules`), a plain path
+// (`/build`) or `*` and a suffix (`*.o`). Those go to hash tables keyed by
+// the last component, the path and the extension, or to a short list of
+// suffixes. The rest are compiled into DFAs, built up front so the set can be
+// shared between walker threads: all of them into one DFA when it stays
+// small, else split in halves until each part's DFA does.
+class GlobSet {
+public:
+    static constexpr uint32_t kNoMatch = UINT32_MAX;
+
+    GlobSet() = default;
+    GlobSet(const GlobSet&) = delete;
+    GlobSet& operator=(const GlobSet&) = delete;
+    GlobSet(GlobSet&&) = default;
+    GlobSet& operator=(GlobSet&&) = default;
+
+    // Add `glob` with the next id (0, 1, ...). A directory_only glob (written
+    // with a trailing '/', which the caller strips) never matches a file.
+    void add(const std::string& glob, bool directory_only);
+
+    // Build the DFAs; call after the last add()
+    void finish();
+
+    // The highest id whose glob matches `path` (relative to the directory
+    // the globs are for, with no leading "./"), or kNoMatch
+    uint32_t match(std::string_view path, bool is_directory) const;
+
+    size_t size() const { return glob_count; }
+    bool empty() const { return glob_count == 0; }
+
+private:
+    // The highest matching id, with and without the directory-only globs
+    struct Ids {
+        uint32_t any = kNoMatch;
+        uint32_t file = kNoMatch;
+    };
+
+    // A group of globs with wildcards in the middle, as one DFA over the
+    // byte classes of their NFA. State 0 is dead. Without a DFA (a single
+    // glob whose DFA grew too large) the NFA is run instead.
+    struct Dfa {
+        Nfa nfa;
+        bool whole_path = false;
+        bool built = false;
+        uint32_t start = 0;
+        std::vector<uint32_t> next;  // class_count entries per state
+        std::vector<Ids> accept;
+    };
+
+    struct WildGlob {
+        std::string glob;
+        size_t from;  // Past a leading '/'
+        bool whole_path;  // Else matched against the last component
+        uint32_t id;
+    };
+
+    // Past this many states a group's DFA is dropped and the group split
+    static constexpr size_t kMaxDfaStates = 1024;
+
+    static void record(Ids& ids, uint32_t id, bool directory_only);
+    static uint32_t pick(const Ids& ids, bool is_directory);
+
+    void addLiteral(std::unordered_map<std::string_view, Ids>& table, std::string key,
+                    uint32_t id, bool directory_only);
+    void buildDfas(size_t begin, size_t end);
+    bool buildDfa(Dfa& dfa) const;
+    Ids accepted(const Nfa& nfa, const std::vector<uint32_t>& set) const;
+    uint32_t matchNfa(const Nfa& nfa, std::string_view path, bool is_directory) const;
+
+    size_t glob_count = 0;
+
+    std::deque<std::string> keys;  // Storage for the table keys; never moves
+    std::unordered_map<std::string_view, Ids> names;
+    std::unordered_map<std::string_view, Ids> paths;
+    std::unordered_map<std::string_view, Ids> extensions;  // ".o" for `*.o`
+    struct Suffix {
+        std::string text;
+        uint32_t id;
+        bool directory_only;
+    };
+    std::vector<Suffix> suffixes;
+
+    // Globs with wildcards in the middle
+    std::vector<WildGlob> wild_globs;
+    std::vector<bool> directory_only_ids;  // Indexed by glob id
+    std::vector<Dfa> dfas;
+};
@@ -0,0 +1,41 @@
+#include "horspool.hpp"
+
+#include <cstring>
+
+HorspoolMatcher::HorspoolMatcher(const std::string& pattern, bool fold_case)
+    : LiteralMatcher(pattern, fold_case) {
+    const size_t pattern_length = pattern.size();
+
+    // Initialize all shifts to pattern length (default shift)
+    for (size_t& entry : shift) entry = pattern_length;
+
+    // Set shift for characters in pattern (except last)
+    for (size_t i = 0; i + 1 < pattern_length; ++i) {
+        const unsigned char c = static_cast<unsigned char>(this->pattern[i]);
+        shift[c] = pattern_length - 1 - i;
+        // Both cases of a folded letter shift alike
+        if (fold_case && isAsciiLetter(c)) shift[c ^ 0x20] = pattern_length - 1 - i;
+    }
+}
+
+size_t HorspoolMatcher::find(const char* text, size_t from, size_t limit) const {
+    const size_t pattern_length = pattern.size();
+    const unsigned char* window_last = reinterpret_cast<const unsigned char*>(text) + pattern_length - 1;
+    const unsigned char last = static_cast<unsigned char>(pattern.back());
+
+    size_t pos = from;
+    while (pos < limit) {
+        const unsigned char c = window_last[pos];
+        // Last byte first: it is the one the shift table already looked at
+        if (fold_case) {
+            if (foldAscii(c) == last &&
+                equalsFoldedAscii(text + pos, pattern.data(), pattern_length - 1)) {
+                return pos;
+            }
+        } else if (c == last && memcmp(text + pos, pattern.data(), pattern_length - 1) == 0) {
+            return pos;
+        }
+        pos += shift[c];
+    }
+    return kNoMatch;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "literal_matcher.hpp"
+
+// Boyer-Moore-Horspool. The bad-character table is built once per pattern
+// and the window advances by shift[last byte of window], so long patterns
+// are scanned in sublinear time.
+class HorspoolMatcher : public LiteralMatcher {
+public:
+    HorspoolMatcher(const std::string& pattern, bool fold_case);
+
+    const char* name() const override { return "horspool"; }
+
+    size_t find(const char* text, size_t from, size_t limit) const override;
+
+    size_t memoryUsage() const override { return sizeof(*this) + pattern.capacity(); }
+
+private:
+    size_t shift[256];
+};
@@ -0,0 +1,65 @@
+#include "input_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+InputFile::~InputFile() {
+    close();
+}
+
+bool InputFile::open(const std::string& path, std::string& error) {
+    close();
+    if (path == "-") {
+        fd = STDIN_FILENO;
+    } else {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "cannot open " + path + ": " + strerror(errno);
+            return false;
+        }
+        owns_fd = true;
+    }
+
+    // Only regular files have a size that stays put; /proc files report 0
+    // and pipes have none, so those are streamed
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error = "cannot read " + path + ": " + strerror(errno);
+        close();
+        return false;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        error = "cannot read " + path + ": " + strerror(EISDIR);
+        close();
+        return false;
+    }
+    if (S_ISREG(info.st_mode) && info.st_size > 0) map(static_cast<size_t>(info.st_size));
+    return true;
+}
+
+bool InputFile::map(size_t file_length) {
+    void* region = mmap(nullptr, file_length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (region == MAP_FAILED) return false;
+
+    // Read-ahead hints only; a kernel that ignores them still works
+    madvise(region, file_length, MADV_SEQUENTIAL);
+    madvise(region, file_length, MADV_WILLNEED);
+
+    mapping = region;
+    length = file_length;
+    return true;
+}
+
+void InputFile::close() {
+    if (mapping) munmap(mapping, length);
+    if (owns_fd) ::close(fd);
+    mapping = nullptr;
+    length = 0;
+    fd = -1;
+    owns_fd = false;
+}
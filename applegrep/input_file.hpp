@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// One input to search. Regular files are mapped read-only and searched in
+// place, with the kernel told the whole file will be read front to back.
+// Pipes, terminals and other special files cannot be mapped; they are left
+// open for searchStream() (see stream_search.hpp) to read as they produce.
+class InputFile {
+public:
+    InputFile() = default;
+    ~InputFile();
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    // Open `path`, or standard input when `path` is "-". Returns false and
+    // fills `error` when the file cannot be opened.
+    bool open(const std::string& path, std::string& error);
+
+    // Whether data() and size() hold the whole file. Otherwise the input
+    // must be read from descriptor().
+    bool mapped() const { return mapping != nullptr; }
+
+    const char* data() const { return static_cast<const char*>(mapping); }
+    size_t size() const { return length; }
+    int descriptor() const { return fd; }
+
+private:
+    bool map(size_t file_length);
+    void close();
+
+    int fd = -1;
+    bool owns_fd = false;     // Standard input is left open
+    void* mapping = nullptr;  // munmap()ed on close
+    size_t length = 0;
+};
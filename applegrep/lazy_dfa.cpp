@@ -0,0 +1,171 @@
+#include "lazy_dfa.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Rough cost of one hash-map node on top of the key's own elements
+constexpr size_t kStateOverhead = 64;
+
+} // namespace
+
+size_t LazyDfa::SetHash::operator()(const std::vector<uint32_t>& set) const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t state : set) hash = (hash ^ state) * 0x100000001b3ull;
+    return static_cast<size_t>(hash);
+}
+
+LazyDfa::LazyDfa(const Nfa& nfa, size_t cache_bytes)
+    : nfa(nfa), cache_bytes(cache_bytes), class_count(nfa.class_count) {
+    seen.assign(nfa.states.size(), 0);
+
+    std::vector<uint32_t> seeds = nfa.starts;
+    closure(seeds, true, false, line_start_set);
+
+    // An empty line is at its start and its end at once, which no single
+    // DFA state captures (think "^$^")
+    std::vector<uint32_t> empty_line;
+    seeds = nfa.starts;
+    closure(seeds, true, true, empty_line);
+    empty_line_id = firstMatch(empty_line);
+
+    flush();
+    flush_count = 0;
+}
+
+void LazyDfa::closure(std::vector<uint32_t>& seeds, bool line_start, bool line_end,
+                      std::vector<uint32_t>& set) {
+    if (++epoch == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        epoch = 1;
+    }
+
+    set.clear();
+    stack.swap(seeds);
+    while (!stack.empty()) {
+        const uint32_t q = stack.back();
+        stack.pop_back();
+        if (seen[q] == epoch) continue;
+        seen[q] = epoch;
+
+        const NfaState& state = nfa.states[q];
+        switch (state.kind) {
+            case NfaState::Kind::Bytes:
+            case NfaState::Kind::Match:
+                set.push_back(q);
+                break;
+            case NfaState::Kind::Split:
+                stack.push_back(state.out1);
+                stack.push_back(state.out);
+                break;
+            case NfaState::Kind::LineStart:
+                // Anywhere but the start of a line this thread dies
+                if (line_start) stack.push_back(state.out);
+                break;
+            case NfaState::Kind::LineEnd:
+                if (line_end) {
+                    stack.push_back(state.out);
+                } else {
+                    set.push_back(q);
+                }
+                break;
+        }
+    }
+    std::sort(set.begin(), set.end());
+}
+
+void LazyDfa::flush() {
+    ids.clear();
+    sets.clear();
+    match_id.clear();
+    line_end_id.clear();
+    transitions.clear();
+    used_bytes = 0;
+    ++flush_count;
+    start = intern(line_start_set);
+}
+
+uint32_t LazyDfa::intern(const std::vector<uint32_t>& set) {
+    auto found = ids.find(set);
+    if (found != ids.end()) return found->second;
+
+    const size_t cost = class_count * sizeof(uint32_t) + 2 * sizeof(uint32_t) +
+                        set.size() * sizeof(uint32_t) + kStateOverhead;
+    if (used_bytes + cost > cache_bytes && !sets.empty()) flush();
+    used_bytes += cost;
+
+    const uint32_t id = static_cast<uint32_t>(sets.size());
+    auto inserted = ids.emplace(set, id).first;
+    sets.push_back(&inserted->first);
+    transitions.resize(transitions.size() + class_count, kUnknown);
+
+    match_id.push_back(firstMatch(set));
+    line_end_id.push_back(kUnknown);
+    return id;
+}
+
+uint32_t LazyDfa::transition(uint32_t state, uint8_t byte_class) {
+    // 1. Step every byte-consuming NFA state over the class's bytes, and let
+    // a new match begin here
+    const unsigned char byte = nfa.class_bytes[byte_class];
+    std::vector<uint32_t> seeds = nfa.starts;
+    for (uint32_t q : *sets[state]) {
+        const NfaState& nfa_state = nfa.states[q];
+        if (nfa_state.kind == NfaState::Kind::Bytes && nfa.byte_sets[nfa_state.index].test(byte)) {
+            seeds.push_back(nfa_state.out);
+        }
+    }
+    std::vector<uint32_t> next;
+    closure(seeds, false, false, next);
+
+    // 2. Cache the edge, unless adding the target flushed the source
+    const size_t flushes_before = flush_count;
+    const uint32_t target = intern(next);
+    const uint32_t entry = static_cast<uint32_t>(target * class_count) |
+                           (match_id[target] != kNoMatch ? kMatchFlag : 0);
+    if (flush_count == flushes_before) transitions[state * class_count + byte_class] = entry;
+    return entry;
+}
+
+uint32_t LazyDfa::firstMatch(const std::vector<uint32_t>& set) const {
+    uint32_t first = kNoMatch;
+    for (uint32_t q : set) {
+        if (nfa.states[q].kind == NfaState::Kind::Match) first = std::min(first, nfa.states[q].index);
+    }
+    return first;
+}
+
+uint32_t LazyDfa::lineEndMatch(uint32_t state) {
+    if (line_end_id[state] == kUnknown) {
+        std::vector<uint32_t> seeds = *sets[state];
+        std::vector<uint32_t> set;
+        closure(seeds, false, true, set);
+        line_end_id[state] = firstMatch(set);
+    }
+    return line_end_id[state];
+}
+
+uint32_t LazyDfa::matchLine(const unsigned char* line, size_t length) {
+    if (length == 0) return empty_line_id;
+
+    if (match_id[start] != kNoMatch) return match_id[start];
+
+    // `row` is the current state's offset in the table
+    const uint8_t* classes = nfa.byte_classes;
+    const uint32_t* table = transitions.data();
+    uint32_t row = static_cast<uint32_t>(start * class_count);
+    for (size_t i = 0; i < length; ++i) {
+        const uint8_t byte_class = classes[line[i]];
+        uint32_t next = table[row + byte_class];
+        // kUnknown has the flag bit too, so one test covers both slow cases
+        if (next & kMatchFlag) {
+            if (next == kUnknown) {
+                next = transition(row / class_count, byte_class);
+                table = transitions.data();
+            }
+            if (next & kMatchFlag) return match_id[(next & ~kMatchFlag) / class_count];
+        }
+        row = next;
+    }
+    return lineEndMatch(row / class_count);
+}
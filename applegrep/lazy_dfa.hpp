@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "nfa.hpp"
+
+// DFA built from an Nfa one transition at a time, as the text needs it. Each
+// DFA state is a set of NFA states; transitions are computed on first use and
+// cached. When the cache grows past its budget it is dropped and rebuilt
+// from the current state, so memory stays bounded whatever the regex.
+//
+// The search is unanchored: at every byte the NFA start states are added
+// again, so a state means "some match may be in progress here".
+//
+// Not thread safe; each scanning thread needs its own LazyDfa.
+class LazyDfa {
+public:
+    static constexpr uint32_t kNoMatch = UINT32_MAX;
+
+    LazyDfa(const Nfa& nfa, size_t cache_bytes);
+
+    // If some pattern matches within the line [line, line + length) (no
+    // newline inside), return the id of the first to do so, else kNoMatch
+    uint32_t matchLine(const unsigned char* line, size_t length);
+
+    // How often the cache was dropped for lack of room
+    size_t flushes() const { return flush_count; }
+
+private:
+    // Transition table entries: the target state's row offset (id times
+    // class_count), possibly flagged as matching, or kUnknown when not
+    // computed yet
+    static constexpr uint32_t kMatchFlag = 1u << 31;
+    static constexpr uint32_t kUnknown = UINT32_MAX;
+
+    struct SetHash {
+        size_t operator()(const std::vector<uint32_t>& set) const;
+    };
+
+    uint32_t transition(uint32_t state, uint8_t byte_class);
+    uint32_t lineEndMatch(uint32_t state);
+    uint32_t firstMatch(const std::vector<uint32_t>& set) const;
+
+    // Follow epsilon edges from `seeds`, leaving the sorted set of states
+    // that consume a byte, wait for the line end or match
+    void closure(std::vector<uint32_t>& seeds, bool line_start, bool line_end,
+                 std::vector<uint32_t>& set);
+
+    // Id of the DFA state for `set`, adding it (and flushing) when needed.
+    // A flush invalidates every id handed out before.
+    uint32_t intern(const std::vector<uint32_t>& set);
+    void flush();
+
+    const Nfa& nfa;
+    const size_t cache_bytes;
+    const size_t class_count;
+
+    std::unordered_map<std::vector<uint32_t>, uint32_t, SetHash> ids;
+    std::vector<const std::vector<uint32_t>*> sets;  // Keys of `ids`, by state
+    std::vector<uint32_t> match_id;                   // First pattern matched in a state
+    std::vector<uint32_t> line_end_id;                // Pattern matched if the line ends here
+    std::vector<uint32_t> transitions;                // class_count entries per state
+    size_t used_bytes = 0;
+    size_t flush_count = 0;
+
+    std::vector<uint32_t> line_start_set;  // Start states at the beginning of a line
+    uint32_t start = 0;
+    uint32_t empty_line_id = kNoMatch;
+
+    // Scratch space for closure()
+    std::vector<uint32_t> stack;
+    std::vector<uint32_t> seen;
+    uint32_t epoch = 0;
+};
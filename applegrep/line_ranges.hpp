@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+// Helpers for the line-oriented matchers, which own the lines that start in
+// their [from, to) range
+
+// End of the line holding `position` (its newline, or text_length)
+inline size_t lineEnd(const char* text, size_t text_length, size_t position) {
+    const void* newline = memchr(text + position, '\n', text_length - position);
+    return newline ? static_cast<const char*>(newline) - text : text_length;
+}
+
+// Start of the first line that starts at or after `from`, or text_length
+inline size_t firstLineStart(const char* text, size_t text_length, size_t from) {
+    if (from == 0 || from >= text_length || text[from - 1] == '\n') return from;
+    const size_t newline = lineEnd(text, text_length, from);
+    return newline < text_length ? newline + 1 : text_length;
+}
+
+// Start of the line holding `position`, looking back no further than `floor`
+// (a known line start)
+inline size_t lineStart(const char* text, size_t floor, size_t position) {
+    while (position > floor && text[position - 1] != '\n') --position;
+    return position;
+}
@@ -0,0 +1,98 @@
+#include "literal_matcher.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "horspool.hpp"
+#include "scan_kernels.hpp"
+#include "two_way.hpp"
+
+namespace {
+
+// Without vector kernels, Horspool shifts beat testing every position from
+// this length on. Vector tiers test 16-64 positions per compare and stay
+// ahead of Horspool on log-like text at every length we measured, since the
+// shifts are capped by how often the window's last byte recurs in the pattern.
+constexpr size_t kHorspoolMinLength = 8;
+
+// Above this many verified bytes per text byte, candidate verification can go
+// quadratic on adversarial input and the linear-time Two-Way engine wins
+constexpr size_t kMaxVerifyAmplification = 32;
+
+// Worst-case bytes compared per text byte by engines that verify candidates
+// with memcmp. A prefix of length L with period q lets text repeating that
+// period produce a candidate every q bytes, each matching L bytes before it
+// fails: L / q comparisons per byte. Suffixes matter for the right-to-left
+// Horspool compare, so take the worse of both directions.
+size_t verifyAmplification(const std::string& pattern) {
+    auto worstPrefix = [](const std::string& x) {
+        // KMP failure function: border[L] is the longest proper border of x[0, L)
+        const size_t m = x.size();
+        std::vector<size_t> border(m + 1, 0);
+        size_t worst = 1;
+        for (size_t i = 1, k = 0; i < m; ++i) {
+            while (k > 0 && x[i] != x[k]) k = border[k];
+            if (x[i] == x[k]) ++k;
+            border[i + 1] = k;
+            worst = std::max(worst, (i + 1) / (i + 1 - k));
+        }
+        return worst;
+    };
+    const std::string reversed(pattern.rbegin(), pattern.rend());
+    return std::max(worstPrefix(pattern), worstPrefix(reversed));
+}
+
+// The active tier's kernel, specialised for the pattern length when it is short
+FindLiteralFn literalKernel(size_t length, bool fold_case) {
+    const ScanKernels& kernels = scanKernels();
+    if (length <= kMaxFixedLiteral) {
+        return fold_case ? kernels.find_literal_fixed->fold[length]
+                         : kernels.find_literal_fixed->exact[length];
+    }
+    return fold_case ? kernels.find_literal_fold : kernels.find_literal;
+}
+
+// Vector two-byte filter from the active ScanKernels tier, anchored on the
+// rarest bytes of the pattern
+class SimdLiteralMatcher : public LiteralMatcher {
+public:
+    SimdLiteralMatcher(const std::string& pattern, bool fold_case, RareBytes anchors)
+        : LiteralMatcher(pattern, fold_case),
+          find_literal(literalKernel(pattern.size(), fold_case)),
+          anchors(anchors) {}
+
+    const char* name() const override { return "simd"; }
+
+    size_t find(const char* text, size_t from, size_t limit) const override {
+        return find_literal(text, from, limit, pattern.data(), pattern.size(), anchors);
+    }
+
+private:
+    FindLiteralFn find_literal;
+    RareBytes anchors;
+};
+
+} // namespace
+
+void LiteralMatcher::findAll(const char* text, size_t from, size_t limit,
+                             uint32_t pattern_id, std::vector<Match>& matches) const {
+    size_t pos = from;
+    while ((pos = find(text, pos, limit)) != kNoMatch) {
+        matches.push_back({pos, pattern_id});
+        ++pos;
+    }
+}
+
+std::unique_ptr<LiteralMatcher> compileLiteral(const std::string& pattern, bool fold_case,
+                                               const char* sample, size_t sample_length) {
+    // Folded patterns are analysed as the lower-case string they match
+    const std::string& key = fold_case ? foldAscii(pattern) : pattern;
+    if (verifyAmplification(key) > kMaxVerifyAmplification) {
+        return std::make_unique<TwoWayMatcher>(pattern, fold_case);
+    }
+    if (scanKernels().tier == CpuTier::Scalar && pattern.size() >= kHorspoolMinLength) {
+        return std::make_unique<HorspoolMatcher>(pattern, fold_case);
+    }
+    return std::make_unique<SimdLiteralMatcher>(
+        pattern, fold_case, selectRareBytes(key, sample, sample_length, fold_case));
+}
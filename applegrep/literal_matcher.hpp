@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "case_fold.hpp"
+#include "literal_scan.hpp"
+#include "match.hpp"
+
+// A single literal pattern compiled once into whatever engine suits it.
+// find() follows the FindLiteralFn contract: first start position in
+// [from, limit) or kNoMatch, reading at most limit + length - 1 bytes. With
+// fold_case the pattern is kept lower case and ASCII letters match either
+// case.
+class LiteralMatcher {
+public:
+    virtual ~LiteralMatcher() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual size_t find(const char* text, size_t from, size_t limit) const = 0;
+
+    // Append every start position in [from, limit), tagged with pattern_id.
+    // Engines that can carry state from one match to the next override this.
+    virtual void findAll(const char* text, size_t from, size_t limit,
+                         uint32_t pattern_id, std::vector<Match>& matches) const;
+
+    size_t length() const { return pattern.size(); }
+
+    // Bytes held by the engine, tables included
+    virtual size_t memoryUsage() const { return sizeof(*this) + pattern.capacity(); }
+
+protected:
+    LiteralMatcher(const std::string& pattern, bool fold_case)
+        : pattern(fold_case ? foldAscii(pattern) : pattern), fold_case(fold_case) {}
+
+    const std::string pattern;
+    const bool fold_case;
+};
+
+// Pick and build the engine for `pattern` (which must not be empty). An
+// optional sample of the input refines the choice of prefilter bytes.
+std::unique_ptr<LiteralMatcher> compileLiteral(const std::string& pattern, bool fold_case,
+                                               const char* sample = nullptr,
+                                               size_t sample_length = 0);
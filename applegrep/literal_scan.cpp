@@ -0,0 +1,539 @@
+#include "literal_scan.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "case_fold.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+inline bool verify(const char* candidate, const char* needle, size_t needle_length) {
+    return memcmp(candidate, needle, needle_length) == 0;
+}
+
+// OR-ing this into a text byte folds it onto the needle byte's case
+inline char caseBit(char needle_byte) {
+    return isAsciiLetter(static_cast<unsigned char>(needle_byte)) ? 0x20 : 0;
+}
+
+} // namespace
+
+size_t findLiteralScalar(const char* text, size_t from, size_t limit,
+                         const char* needle, size_t needle_length, RareBytes anchors) {
+    const char rare = needle[anchors.offset1];
+    const char* shifted = text + anchors.offset1;
+    size_t pos = from;
+    while (pos < limit) {
+        const void* hit = memchr(shifted + pos, rare, limit - pos);
+        if (!hit) return kNoMatch;
+        pos = static_cast<const char*>(hit) - shifted;
+        if (text[pos + anchors.offset2] == needle[anchors.offset2] &&
+            verify(text + pos, needle, needle_length)) {
+            return pos;
+        }
+        ++pos;
+    }
+    return kNoMatch;
+}
+
+size_t findLiteralFoldScalar(const char* text, size_t from, size_t limit,
+                             const char* needle, size_t needle_length, RareBytes anchors) {
+    const char byte1 = needle[anchors.offset1], case1 = caseBit(byte1);
+    const char byte2 = needle[anchors.offset2], case2 = caseBit(byte2);
+    for (size_t pos = from; pos < limit; ++pos) {
+        if ((text[pos + anchors.offset1] | case1) == byte1 &&
+            (text[pos + anchors.offset2] | case2) == byte2 &&
+            equalsFoldedAscii(text + pos, needle, needle_length)) {
+            return pos;
+        }
+    }
+    return kNoMatch;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+size_t findLiteralSse2(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t needle_length, RareBytes anchors) {
+    const __m128i byte1 = _mm_set1_epi8(needle[anchors.offset1]);
+    const __m128i byte2 = _mm_set1_epi8(needle[anchors.offset2]);
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        const __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at1 + pos));
+        const __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at2 + pos));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block1, byte1),
+                                                        _mm_cmpeq_epi8(block2, byte2)));
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctz(mask);
+            if (verify(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralScalar(text, pos, limit, needle, needle_length, anchors);
+}
+
+__attribute__((target("avx2")))
+size_t findLiteralAvx2(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t needle_length, RareBytes anchors) {
+    const __m256i byte1 = _mm256_set1_epi8(needle[anchors.offset1]);
+    const __m256i byte2 = _mm256_set1_epi8(needle[anchors.offset2]);
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 32 <= limit; pos += 32) {
+        const __m256i block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at1 + pos));
+        const __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at2 + pos));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block1, byte1),
+                                                              _mm256_cmpeq_epi8(block2, byte2)));
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctz(mask);
+            if (verify(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralSse2(text, pos, limit, needle, needle_length, anchors);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+size_t findLiteralAvx512(const char* text, size_t from, size_t limit,
+                         const char* needle, size_t needle_length, RareBytes anchors) {
+    const __m512i byte1 = _mm512_set1_epi8(needle[anchors.offset1]);
+    const __m512i byte2 = _mm512_set1_epi8(needle[anchors.offset2]);
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 64 <= limit; pos += 64) {
+        const __m512i block1 = _mm512_loadu_si512(at1 + pos);
+        const __m512i block2 = _mm512_loadu_si512(at2 + pos);
+        uint64_t mask = _mm512_cmpeq_epi8_mask(block1, byte1) &
+                        _mm512_cmpeq_epi8_mask(block2, byte2);
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctzll(mask);
+            if (verify(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralSse2(text, pos, limit, needle, needle_length, anchors);
+}
+
+size_t findLiteralFoldSse2(const char* text, size_t from, size_t limit,
+                           const char* needle, size_t needle_length, RareBytes anchors) {
+    const __m128i byte1 = _mm_set1_epi8(needle[anchors.offset1]);
+    const __m128i byte2 = _mm_set1_epi8(needle[anchors.offset2]);
+    const __m128i case1 = _mm_set1_epi8(caseBit(needle[anchors.offset1]));
+    const __m128i case2 = _mm_set1_epi8(caseBit(needle[anchors.offset2]));
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        const __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at1 + pos));
+        const __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at2 + pos));
+        uint32_t mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(block1, case1), byte1),
+                          _mm_cmpeq_epi8(_mm_or_si128(block2, case2), byte2)));
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctz(mask);
+            if (equalsFoldedAscii(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralFoldScalar(text, pos, limit, needle, needle_length, anchors);
+}
+
+__attribute__((target("avx2")))
+size_t findLiteralFoldAvx2(const char* text, size_t from, size_t limit,
+                           const char* needle, size_t needle_length, RareBytes anchors) {
+    const __m256i byte1 = _mm256_set1_epi8(needle[anchors.offset1]);
+    const __m256i byte2 = _mm256_set1_epi8(needle[anchors.offset2]);
+    const __m256i case1 = _mm256_set1_epi8(caseBit(needle[anchors.offset1]));
+    const __m256i case2 = _mm256_set1_epi8(caseBit(needle[anchors.offset2]));
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 32 <= limit; pos += 32) {
+        const __m256i block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at1 + pos));
+        const __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at2 + pos));
+        uint32_t mask = _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(block1, case1), byte1),
+                             _mm256_cmpeq_epi8(_mm256_or_si256(block2, case2), byte2)));
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctz(mask);
+            if (equalsFoldedAscii(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralFoldSse2(text, pos, limit, needle, needle_length, anchors);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+size_t findLiteralFoldAvx512(const char* text, size_t from, size_t limit,
+                             const char* needle, size_t needle_length, RareBytes anchors) {
+    const __m512i byte1 = _mm512_set1_epi8(needle[anchors.offset1]);
+    const __m512i byte2 = _mm512_set1_epi8(needle[anchors.offset2]);
+    const __m512i case1 = _mm512_set1_epi8(caseBit(needle[anchors.offset1]));
+    const __m512i case2 = _mm512_set1_epi8(caseBit(needle[anchors.offset2]));
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 64 <= limit; pos += 64) {
+        const __m512i block1 = _mm512_loadu_si512(at1 + pos);
+        const __m512i block2 = _mm512_loadu_si512(at2 + pos);
+        uint64_t mask = _mm512_cmpeq_epi8_mask(_mm512_or_si512(block1, case1), byte1) &
+                        _mm512_cmpeq_epi8_mask(_mm512_or_si512(block2, case2), byte2);
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctzll(mask);
+            if (equalsFoldedAscii(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralFoldSse2(text, pos, limit, needle, needle_length, anchors);
+}
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+size_t findLiteralNeon(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t needle_length, RareBytes anchors) {
+    const uint8x16_t byte1 = vdupq_n_u8(static_cast<uint8_t>(needle[anchors.offset1]));
+    const uint8x16_t byte2 = vdupq_n_u8(static_cast<uint8_t>(needle[anchors.offset2]));
+    const uint8_t* at1 = reinterpret_cast<const uint8_t*>(text) + anchors.offset1;
+    const uint8_t* at2 = reinterpret_cast<const uint8_t*>(text) + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        const uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(at1 + pos), byte1),
+                                       vceqq_u8(vld1q_u8(at2 + pos), byte2));
+        // NEON has no movemask: narrow each 16-bit lane by 4 so every byte
+        // of the comparison becomes one nibble of a 64-bit mask
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        mask &= 0x8888888888888888ull;
+        while (mask) {
+            const size_t candidate = pos + (__builtin_ctzll(mask) >> 2);
+            if (verify(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralScalar(text, pos, limit, needle, needle_length, anchors);
+}
+
+size_t findLiteralFoldNeon(const char* text, size_t from, size_t limit,
+                           const char* needle, size_t needle_length, RareBytes anchors) {
+    const uint8x16_t byte1 = vdupq_n_u8(static_cast<uint8_t>(needle[anchors.offset1]));
+    const uint8x16_t byte2 = vdupq_n_u8(static_cast<uint8_t>(needle[anchors.offset2]));
+    const uint8x16_t case1 = vdupq_n_u8(static_cast<uint8_t>(caseBit(needle[anchors.offset1])));
+    const uint8x16_t case2 = vdupq_n_u8(static_cast<uint8_t>(caseBit(needle[anchors.offset2])));
+    const uint8_t* at1 = reinterpret_cast<const uint8_t*>(text) + anchors.offset1;
+    const uint8_t* at2 = reinterpret_cast<const uint8_t*>(text) + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        const uint8x16_t eq = vandq_u8(vceqq_u8(vorrq_u8(vld1q_u8(at1 + pos), case1), byte1),
+                                       vceqq_u8(vorrq_u8(vld1q_u8(at2 + pos), case2), byte2));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        mask &= 0x8888888888888888ull;
+        while (mask) {
+            const size_t candidate = pos + (__builtin_ctzll(mask) >> 2);
+            if (equalsFoldedAscii(text + candidate, needle, needle_length)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralFoldScalar(text, pos, limit, needle, needle_length, anchors);
+}
+
+#endif
+
+// ---- kernels specialised per needle length ----
+
+namespace {
+
+// A needle of N bytes, padded to one vector. With kFold, case_bits holds
+// 0x20 for the letters: OR-ing it into the text folds it onto the needle.
+template <size_t N, bool kFold>
+class FixedNeedle {
+public:
+    explicit FixedNeedle(const char* needle) {
+        memcpy(bytes, needle, N);
+        for (size_t i = 0; i < N; ++i) {
+            case_bits[i] = kFold ? caseBit(needle[i]) : 0;
+            ignored[i] = 0;
+        }
+    }
+
+    // Reads exactly N bytes. N is a constant, so this unrolls.
+    bool matches(const char* candidate) const {
+        if constexpr (kFold) {
+            bool equal = true;
+            for (size_t i = 0; i < N; ++i) equal &= (candidate[i] | case_bits[i]) == bytes[i];
+            return equal;
+        } else {
+            return memcmp(candidate, bytes, N) == 0;
+        }
+    }
+
+    // One 16-byte load and compare, when the load stays below `end`
+    bool matchesVector(const char* candidate, const char* end) const {
+        if (candidate + 16 > end) return matches(candidate);
+#if defined(__x86_64__) || defined(__i386__)
+        constexpr uint32_t kLanes = (1u << N) - 1;
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(candidate));
+        if constexpr (kFold) {
+            block = _mm_or_si128(block, _mm_load_si128(reinterpret_cast<const __m128i*>(case_bits)));
+        }
+        const __m128i eq =
+            _mm_cmpeq_epi8(block, _mm_load_si128(reinterpret_cast<const __m128i*>(bytes)));
+        return (_mm_movemask_epi8(eq) & kLanes) == kLanes;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+        uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(candidate));
+        if constexpr (kFold) block = vorrq_u8(block, vld1q_u8(reinterpret_cast<const uint8_t*>(case_bits)));
+        const uint8x16_t eq = vorrq_u8(vceqq_u8(block, vld1q_u8(reinterpret_cast<const uint8_t*>(bytes))),
+                                       vld1q_u8(reinterpret_cast<const uint8_t*>(ignored)));
+        return vminvq_u8(eq) == 0xff;
+#else
+        return matches(candidate);
+#endif
+    }
+
+private:
+    alignas(16) char bytes[16] = {};
+    alignas(16) char case_bits[16] = {};
+    alignas(16) unsigned char ignored[16] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                             0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+};
+
+// Needles of one or two bytes are fully checked by the two anchors
+template <size_t N>
+constexpr bool kAnchorsSuffice = N <= 2;
+
+template <size_t N, bool kFold>
+size_t findFixedScalar(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t, RareBytes anchors) {
+    const FixedNeedle<N, kFold> fixed(needle);
+    const char byte1 = needle[anchors.offset1], case1 = kFold ? caseBit(byte1) : 0;
+    const char byte2 = needle[anchors.offset2], case2 = kFold ? caseBit(byte2) : 0;
+    if constexpr (!kFold) {
+        const char* shifted = text + anchors.offset1;
+        size_t pos = from;
+        while (pos < limit) {
+            const void* hit = memchr(shifted + pos, byte1, limit - pos);
+            if (!hit) return kNoMatch;
+            pos = static_cast<const char*>(hit) - shifted;
+            if (text[pos + anchors.offset2] == byte2 &&
+                (kAnchorsSuffice<N> || fixed.matches(text + pos))) {
+                return pos;
+            }
+            ++pos;
+        }
+        return kNoMatch;
+    }
+    for (size_t pos = from; pos < limit; ++pos) {
+        if ((text[pos + anchors.offset1] | case1) == byte1 &&
+            (text[pos + anchors.offset2] | case2) == byte2 &&
+            (kAnchorsSuffice<N> || fixed.matches(text + pos))) {
+            return pos;
+        }
+    }
+    return kNoMatch;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+template <size_t N, bool kFold>
+size_t findFixedSse2(const char* text, size_t from, size_t limit,
+                     const char* needle, size_t needle_length, RareBytes anchors) {
+    const FixedNeedle<N, kFold> fixed(needle);
+    const char* end = text + limit + N - 1;
+    const __m128i byte1 = _mm_set1_epi8(needle[anchors.offset1]);
+    const __m128i byte2 = _mm_set1_epi8(needle[anchors.offset2]);
+    const __m128i case1 = _mm_set1_epi8(kFold ? caseBit(needle[anchors.offset1]) : 0);
+    const __m128i case2 = _mm_set1_epi8(kFold ? caseBit(needle[anchors.offset2]) : 0);
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at1 + pos));
+        __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at2 + pos));
+        if constexpr (kFold) {
+            block1 = _mm_or_si128(block1, case1);
+            block2 = _mm_or_si128(block2, case2);
+        }
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block1, byte1),
+                                                        _mm_cmpeq_epi8(block2, byte2)));
+        if constexpr (kAnchorsSuffice<N>) {
+            if (mask) return pos + __builtin_ctz(mask);
+        }
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctz(mask);
+            if (fixed.matchesVector(text + candidate, end)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findFixedScalar<N, kFold>(text, pos, limit, needle, needle_length, anchors);
+}
+
+template <size_t N, bool kFold>
+__attribute__((target("avx2")))
+size_t findFixedAvx2(const char* text, size_t from, size_t limit,
+                     const char* needle, size_t needle_length, RareBytes anchors) {
+    const FixedNeedle<N, kFold> fixed(needle);
+    const char* end = text + limit + N - 1;
+    const __m256i byte1 = _mm256_set1_epi8(needle[anchors.offset1]);
+    const __m256i byte2 = _mm256_set1_epi8(needle[anchors.offset2]);
+    const __m256i case1 = _mm256_set1_epi8(kFold ? caseBit(needle[anchors.offset1]) : 0);
+    const __m256i case2 = _mm256_set1_epi8(kFold ? caseBit(needle[anchors.offset2]) : 0);
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 32 <= limit; pos += 32) {
+        __m256i block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at1 + pos));
+        __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at2 + pos));
+        if constexpr (kFold) {
+            block1 = _mm256_or_si256(block1, case1);
+            block2 = _mm256_or_si256(block2, case2);
+        }
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block1, byte1),
+                                                              _mm256_cmpeq_epi8(block2, byte2)));
+        if constexpr (kAnchorsSuffice<N>) {
+            if (mask) return pos + __builtin_ctz(mask);
+        }
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctz(mask);
+            if (fixed.matchesVector(text + candidate, end)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findFixedSse2<N, kFold>(text, pos, limit, needle, needle_length, anchors);
+}
+
+template <size_t N, bool kFold>
+__attribute__((target("avx512f,avx512bw")))
+size_t findFixedAvx512(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t needle_length, RareBytes anchors) {
+    const FixedNeedle<N, kFold> fixed(needle);
+    const char* end = text + limit + N - 1;
+    const __m512i byte1 = _mm512_set1_epi8(needle[anchors.offset1]);
+    const __m512i byte2 = _mm512_set1_epi8(needle[anchors.offset2]);
+    const __m512i case1 = _mm512_set1_epi8(kFold ? caseBit(needle[anchors.offset1]) : 0);
+    const __m512i case2 = _mm512_set1_epi8(kFold ? caseBit(needle[anchors.offset2]) : 0);
+    const char* at1 = text + anchors.offset1;
+    const char* at2 = text + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 64 <= limit; pos += 64) {
+        __m512i block1 = _mm512_loadu_si512(at1 + pos);
+        __m512i block2 = _mm512_loadu_si512(at2 + pos);
+        if constexpr (kFold) {
+            block1 = _mm512_or_si512(block1, case1);
+            block2 = _mm512_or_si512(block2, case2);
+        }
+        uint64_t mask = _mm512_cmpeq_epi8_mask(block1, byte1) &
+                        _mm512_cmpeq_epi8_mask(block2, byte2);
+        if constexpr (kAnchorsSuffice<N>) {
+            if (mask) return pos + __builtin_ctzll(mask);
+        }
+        while (mask) {
+            const size_t candidate = pos + __builtin_ctzll(mask);
+            if (fixed.matchesVector(text + candidate, end)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findFixedSse2<N, kFold>(text, pos, limit, needle, needle_length, anchors);
+}
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+template <size_t N, bool kFold>
+size_t findFixedNeon(const char* text, size_t from, size_t limit,
+                     const char* needle, size_t needle_length, RareBytes anchors) {
+    const FixedNeedle<N, kFold> fixed(needle);
+    const char* end = text + limit + N - 1;
+    const uint8x16_t byte1 = vdupq_n_u8(static_cast<uint8_t>(needle[anchors.offset1]));
+    const uint8x16_t byte2 = vdupq_n_u8(static_cast<uint8_t>(needle[anchors.offset2]));
+    const uint8x16_t case1 = vdupq_n_u8(kFold ? static_cast<uint8_t>(caseBit(needle[anchors.offset1])) : 0);
+    const uint8x16_t case2 = vdupq_n_u8(kFold ? static_cast<uint8_t>(caseBit(needle[anchors.offset2])) : 0);
+    const uint8_t* at1 = reinterpret_cast<const uint8_t*>(text) + anchors.offset1;
+    const uint8_t* at2 = reinterpret_cast<const uint8_t*>(text) + anchors.offset2;
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        uint8x16_t block1 = vld1q_u8(at1 + pos);
+        uint8x16_t block2 = vld1q_u8(at2 + pos);
+        if constexpr (kFold) {
+            block1 = vorrq_u8(block1, case1);
+            block2 = vorrq_u8(block2, case2);
+        }
+        const uint8x16_t eq = vandq_u8(vceqq_u8(block1, byte1), vceqq_u8(block2, byte2));
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        mask &= 0x8888888888888888ull;
+        if constexpr (kAnchorsSuffice<N>) {
+            if (mask) return pos + (__builtin_ctzll(mask) >> 2);
+        }
+        while (mask) {
+            const size_t candidate = pos + (__builtin_ctzll(mask) >> 2);
+            if (fixed.matchesVector(text + candidate, end)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return findFixedScalar<N, kFold>(text, pos, limit, needle, needle_length, anchors);
+}
+
+#endif
+
+// One table per tier: entry i runs the kernel instantiated for length i
+template <size_t... I>
+constexpr FixedLiteralKernels scalarKernels(std::index_sequence<I...>) {
+    return {{nullptr, findFixedScalar<I + 1, false>...}, {nullptr, findFixedScalar<I + 1, true>...}};
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template <size_t... I>
+constexpr FixedLiteralKernels sse2Kernels(std::index_sequence<I...>) {
+    return {{nullptr, findFixedSse2<I + 1, false>...}, {nullptr, findFixedSse2<I + 1, true>...}};
+}
+
+template <size_t... I>
+constexpr FixedLiteralKernels avx2Kernels(std::index_sequence<I...>) {
+    return {{nullptr, findFixedAvx2<I + 1, false>...}, {nullptr, findFixedAvx2<I + 1, true>...}};
+}
+
+template <size_t... I>
+constexpr FixedLiteralKernels avx512Kernels(std::index_sequence<I...>) {
+    return {{nullptr, findFixedAvx512<I + 1, false>...},
+            {nullptr, findFixedAvx512<I + 1, true>...}};
+}
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+template <size_t... I>
+constexpr FixedLiteralKernels neonKernels(std::index_sequence<I...>) {
+    return {{nullptr, findFixedNeon<I + 1, false>...}, {nullptr, findFixedNeon<I + 1, true>...}};
+}
+#endif
+
+constexpr auto kFixedLengths = std::make_index_sequence<kMaxFixedLiteral>();
+
+} // namespace
+
+const FixedLiteralKernels kFixedLiteralScalar = scalarKernels(kFixedLengths);
+#if defined(__x86_64__) || defined(__i386__)
+const FixedLiteralKernels kFixedLiteralSse2 = sse2Kernels(kFixedLengths);
+const FixedLiteralKernels kFixedLiteralAvx2 = avx2Kernels(kFixedLengths);
+const FixedLiteralKernels kFixedLiteralAvx512 = avx512Kernels(kFixedLengths);
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+const FixedLiteralKernels kFixedLiteralNeon = neonKernels(kFixedLengths);
+#endif
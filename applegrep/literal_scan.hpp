@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+
+#include "rare_bytes.hpp"
+
+constexpr size_t kNoMatch = static_cast<size_t>(-1);
+
+// Signature shared by every literal scan kernel. Returns the first start
+// position p in [from, limit) at which `needle` occurs in `text`, or kNoMatch.
+// The caller guarantees text[p + needle_length - 1] is readable for every
+// p < limit, i.e. limit <= text_length - needle_length + 1. Candidates are
+// found by testing the needle bytes at the two `anchors` offsets.
+using FindLiteralFn = size_t (*)(const char* text, size_t from, size_t limit,
+                                 const char* needle, size_t needle_length,
+                                 RareBytes anchors);
+
+// memchr on the first anchor byte, memcmp on the candidates
+size_t findLiteralScalar(const char* text, size_t from, size_t limit,
+                         const char* needle, size_t needle_length, RareBytes anchors);
+
+// Vector kernels compare both anchor bytes against 16/32/64 consecutive start
+// positions at once and only verify surviving candidates. Each one is
+// compiled for its own target; pick them through scanKernels().
+#if defined(__x86_64__) || defined(__i386__)
+size_t findLiteralSse2(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t needle_length, RareBytes anchors);
+size_t findLiteralAvx2(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t needle_length, RareBytes anchors);
+size_t findLiteralAvx512(const char* text, size_t from, size_t limit,
+                         const char* needle, size_t needle_length, RareBytes anchors);
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+size_t findLiteralNeon(const char* text, size_t from, size_t limit,
+                       const char* needle, size_t needle_length, RareBytes anchors);
+#endif
+
+// Case-insensitive (ASCII) variants of the kernels above. `needle` must be
+// lower case already. Anchor bytes that are letters are compared with bit
+// 0x20 forced on in the text, which maps both cases onto the needle byte;
+// other anchors compare exactly. No folded copy of the text is made.
+size_t findLiteralFoldScalar(const char* text, size_t from, size_t limit,
+                             const char* needle, size_t needle_length, RareBytes anchors);
+#if defined(__x86_64__) || defined(__i386__)
+size_t findLiteralFoldSse2(const char* text, size_t from, size_t limit,
+                           const char* needle, size_t needle_length, RareBytes anchors);
+size_t findLiteralFoldAvx2(const char* text, size_t from, size_t limit,
+                           const char* needle, size_t needle_length, RareBytes anchors);
+size_t findLiteralFoldAvx512(const char* text, size_t from, size_t limit,
+                             const char* needle, size_t needle_length, RareBytes anchors);
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+size_t findLiteralFoldNeon(const char* text, size_t from, size_t limit,
+                           const char* needle, size_t needle_length, RareBytes anchors);
+#endif
+
+// Needles of up to this many bytes also have kernels specialised for their
+// length, where the verify is one unrolled compare (a single 16-byte load
+// and mask on the vector tiers) instead of a memcmp call.
+constexpr size_t kMaxFixedLiteral = 16;
+
+// Per tier, the specialised kernels indexed by needle length (entry 0 is
+// null). They follow the FindLiteralFn contract; needle_length must equal
+// the index. `fold` holds the -i variants.
+struct FixedLiteralKernels {
+    FindLiteralFn exact[kMaxFixedLiteral + 1];
+    FindLiteralFn fold[kMaxFixedLiteral + 1];
+};
+
+extern const FixedLiteralKernels kFixedLiteralScalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern const FixedLiteralKernels kFixedLiteralSse2;
+extern const FixedLiteralKernels kFixedLiteralAvx2;
+extern const FixedLiteralKernels kFixedLiteralAvx512;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+extern const FixedLiteralKernels kFixedLiteralNeon;
+#endif
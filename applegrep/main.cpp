@@ -1,217 +1,314 @@
-#define NS_PRIVATE_IMPLEMENTATION
-#define CA_PRIVATE_IMPLEMENTATION
-#define MTL_PRIVATE_IMPLEMENTATION
-#include <Foundation/Foundation.hpp>
-#include <Metal/Metal.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <thread>
 #include <fstream>
 #include <sstream>
 
-// Metal Shader for re matching
-// ... I just let LLM to implement the Boyer-Moore-Horspool algorithm
-const char* grepShaderSource = R"(
-#include <metal_stdlib>
-using namespace metal;
-
-constant int ALPHABET_SIZE = 256; // Assuming ASCII characters
-
-kernel void grep_kernel(
-    device const char* text [[buffer(0)]],
-    device const char* pattern [[buffer(1)]],
-    device int* match_positions [[buffer(2)]],  // Buffer to store match positions
-    device atomic_int* match_count [[buffer(3)]], // Atomic counter
-    uint tid [[thread_position_in_grid]])
-{
-    // Calculate text length
-    uint text_length = 0;
-    while (text[text_length] != '\0') text_length++;
-    
-    // Calculate pattern length
-    uint pattern_length = 0;
-    while (pattern[pattern_length] != '\0') pattern_length++;
-    
-    // If pattern is empty or longer than remaining text, return
-    if (pattern_length == 0 || tid > text_length - pattern_length) return;
-    
-    // Preprocess bad-character shift table
-    int bad_char_shift[ALPHABET_SIZE];
-    
-    // Initialize all shifts to pattern length (default shift)
-    for (int i = 0; i < ALPHABET_SIZE; ++i) {
-        bad_char_shift[i] = pattern_length;
-    }
-    
-    // Set shift for characters in pattern (except last)
-    for (uint i = 0; i < pattern_length - 1; ++i) {
-        bad_char_shift[pattern[i]] = pattern_length - 1 - i;
-    }
-    
-    // BMH search - each thread handles one potential starting position
-    int j = pattern_length - 1;
-    
-    // Compare from right to left
-    while (j >= 0 && pattern[j] == text[tid + j]) {
-        j--;
+#include "approximate_matcher.hpp"
+#include "archive_search.hpp"
+#include "cpu_features.hpp"
+#include "decompress.hpp"
+#include "directory_walker.hpp"
+#include "input_file.hpp"
+#include "scan_kernels.hpp"
+#include "match_output.hpp"
+#include "multi_file_search.hpp"
+#include "output_writer.hpp"
+#include "path_filter.hpp"
+#include "search_backend.hpp"
+#include "stream_search.hpp"
+
+// Files found by -r that may wait to be read; a full queue holds the walk back
+constexpr size_t kWalkQueueLength = 4096;
+
+// Read one pattern per line. Blank lines are kept, so pattern ids match line
+// numbers (minus one); they never match.
+bool readPatternFile(const std::string& filename, std::vector<std::string>& patterns) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "cannot read pattern file " << filename << std::endl;
+        return false;
     }
-    
-    if (j < 0) {
-        // Pattern found - use atomic operation to ensure unique position
-        int count = atomic_fetch_add_explicit(match_count, 1, memory_order_relaxed);
-        if (count < 1000) {  // Prevent buffer overflow
-            match_positions[count] = tid;
-        }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        patterns.push_back(line);
     }
+    return true;
 }
-)";
 
-// Read file
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "cannot read file" << filename << std::endl;
-        return "";
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <pattern> [file...]" << std::endl;
+    std::cerr << "       " << program << " [options] -e <pattern> [-e <pattern>...] [file...]" << std::endl;
+    std::cerr << "  -E                      patterns are POSIX extended regexes" << std::endl;
+    std::cerr << "  -e PATTERN              search for PATTERN (repeatable)" << std::endl;
+    std::cerr << "  -f FILE                 search for every line of FILE" << std::endl;
+    std::cerr << "  -i                      ignore case (Unicode simple case folding)" << std::endl;
+    std::cerr << "  -r                      search the files under each directory operand" << std::endl;
+    std::cerr << "                          (default .)" << std::endl;
+    std::cerr << "  --glob=GLOB             with -r, search only files matching GLOB, or skip" << std::endl;
+    std::cerr << "                          entries matching !GLOB (repeatable)" << std::endl;
+    std::cerr << "  --no-ignore             with -r, do not read .gitignore and .ignore files" << std::endl;
+    std::cerr << "  -z                      decompress gzip, zstd and lz4 input and search the" << std::endl;
+    std::cerr << "                          members of tar and zip archives" << std::endl;
+    std::cerr << "  --max-errors=K          approximate search: up to K inserted, deleted or" << std::endl;
+    std::cerr << "                          substituted bytes (one pattern)" << std::endl;
+    std::cerr << "  --stats                 print engine, build time and memory to stderr" << std::endl;
+    std::cerr << "  --backend=cpu|metal|auto" << std::endl;
+    std::cerr << "  --cpu-features=TIER     native, avx512, avx2, sse4.2, neon or scalar" << std::endl;
+}
+
+// Scan time is passed in: a streamed search adds up the time of every block
+void printStats(const SearchBackend& backend, size_t pattern_count, size_t text_length,
+                double scan_seconds) {
+    const SearchStats& stats = backend.stats();
+    std::cerr << std::fixed << std::setprecision(3)
+              << "backend:   " << backend.name() << "\n"
+              << "engine:    " << stats.engine << "\n"
+              << "patterns:  " << pattern_count << "\n"
+              << "build:     " << stats.compile_seconds * 1e3 << " ms\n"
+              << "memory:    " << stats.engine_bytes / 1024.0 << " KiB\n"
+              << "scan:      " << scan_seconds * 1e3 << " ms";
+    if (scan_seconds > 0) {
+        std::cerr << " (" << text_length / scan_seconds / 1e9 << " GB/s)";
+    }
+    std::cerr << std::endl;
+    if (stats.engine.compare(0, 8, "lazy-dfa") == 0) {
+        std::cerr << "dfa cache: " << stats.cache_flushes << " flushes" << std::endl;
     }
-    
-    return std::string((std::istreambuf_iterator<char>(file)),
-                      std::istreambuf_iterator<char>());
 }
 
 int main(int argc, const char* argv[]) {
-    std::string text;
+    InputFile input;
     std::string filename;
+    std::string backend_name = "auto";
+    bool print_stats = false;
+    bool recursive = false;
+    bool decompress = false;
+    PathFilter filter;
+    SearchOptions options;
+    bool pattern_option = false;  // -e or -f given, even if the file was empty
+    std::vector<std::string> patterns;
+    std::vector<std::string> positional;
 
-    if (argc == 2) {
-        // Read from stdin
-        filename = "stdin";
-        text = std::string((std::istreambuf_iterator<char>(std::cin)),
-                          std::istreambuf_iterator<char>());
-    } else if (argc == 3){
-        // Read from file
-        filename = argv[2];
-        text = readFile(filename);
-    } else {
-        std::cerr << "Usage: " << argv[0] << " <pattern> [file]" << std::endl;
-        return 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-e") {
+            if (i + 1 >= argc) {
+                std::cerr << "Option -e requires a pattern" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            patterns.push_back(argv[++i]);
+            pattern_option = true;
+        } else if (arg == "-E") {
+            options.extended_regex = true;
+        } else if (arg == "-i") {
+            options.ignore_case = true;
+        } else if (arg == "-r") {
+            recursive = true;
+        } else if (arg == "-z") {
+            decompress = true;
+        } else if (arg.rfind("--glob=", 0) == 0) {
+            filter.addGlob(arg.substr(7));
+        } else if (arg == "--no-ignore") {
+            filter.setIgnoreFiles(false);
+        } else if (arg == "-f") {
+            if (i + 1 >= argc) {
+                std::cerr << "Option -f requires a file" << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            if (!readPatternFile(argv[++i], patterns)) return 1;
+            pattern_option = true;
+        } else if (arg.rfind("--max-errors=", 0) == 0) {
+            const std::string value = arg.substr(13);
+            char* end = nullptr;
+            const unsigned long max_errors = strtoul(value.c_str(), &end, 10);
+            if (value.empty() || value[0] == '-' || *end != '\0' ||
+                max_errors >= kApproximateMaxLength) {
+                std::cerr << "Invalid --max-errors value: " << value << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.max_errors = static_cast<uint32_t>(max_errors);
+        } else if (arg == "--stats") {
+            print_stats = true;
+        } else if (arg.rfind("--backend=", 0) == 0) {
+            backend_name = arg.substr(10);
+        } else if (arg.rfind("--cpu-features=", 0) == 0) {
+            // Force a (lower) kernel tier, e.g. to benchmark the fallbacks
+            CpuTier tier;
+            if (!parseCpuTier(arg.substr(15), tier)) {
+                std::cerr << "Unknown CPU feature tier: " << arg.substr(15) << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            const CpuTier detected = detectCpuTier();
+            if (!cpuTierSupported(tier, detected)) {
+                std::cerr << "Warning: this CPU does not support " << cpuTierName(tier)
+                          << ", using " << cpuTierName(detected) << std::endl;
+                tier = detected;
+            }
+            selectScanKernels(tier);
+        } else if (arg == "--") {
+            positional.insert(positional.end(), argv + i + 1, argv + argc);
+            break;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
     }
-    
-    const std::string pattern = argv[1];
-    const size_t max_matches = 10;  // Adjust based on expected matches
-    
-    if (text.empty() || pattern.empty()) {
-        std::cout << "Found 0 matches for '" << pattern
-                  << "' in file '" << filename << "'" << std::endl;
-        return 0;
+
+    // Without -e or -f, the first operand is the pattern
+    if (patterns.empty() && !pattern_option && !positional.empty()) {
+        patterns.push_back(positional.front());
+        positional.erase(positional.begin());
     }
 
-    // 1. Initialize Metal device
-    MTL::Device* device = MTL::CreateSystemDefaultDevice();
-    
-    // 2. Complile shader
-    NS::Error* error = nullptr;
-    MTL::Library* library = device->newLibrary(
-        NS::String::string(grepShaderSource, NS::UTF8StringEncoding), nullptr, &error);
-    
-    if (!library) {
-        std::cerr << "Failed to compile shader: " << error->localizedDescription()->utf8String() << std::endl;
-        return -1;
+    if (!pattern_option && patterns.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // 1. Pick the search engine. The Metal shader only matches exact literals.
+    if ((options.extended_regex || options.max_errors > 0 || options.ignore_case) &&
+        backend_name == "auto") {
+        backend_name = "cpu";
     }
-    
-    MTL::Function* grepFunction = library->newFunction(NS::String::string("grep_kernel", NS::UTF8StringEncoding));
-    MTL::ComputePipelineState* pipelineState = device->newComputePipelineState(grepFunction, &error);
-    
-    // 3. Prepare data
-    std::vector<char> textData(text.begin(), text.end());
-    textData.push_back('\0');
-    std::vector<char> patternData(pattern.begin(), pattern.end());
-    patternData.push_back('\0');
-    
-    // 4. Create buffers
-    int initialMatchCount = 0;
-    std::vector<int> matchPositions(max_matches, 0);
-    
-    MTL::Buffer* textBuffer = device->newBuffer(textData.data(), textData.size(), MTL::ResourceStorageModeShared);
-    MTL::Buffer* patternBuffer = device->newBuffer(patternData.data(), patternData.size(), MTL::ResourceStorageModeShared);
-    MTL::Buffer* matchCountBuffer = device->newBuffer(&initialMatchCount, sizeof(int), MTL::ResourceStorageModeShared);
-    MTL::Buffer* matchPositionsBuffer = device->newBuffer(matchPositions.data(), max_matches * sizeof(int), MTL::ResourceStorageModeShared);
-
-    // 5. Create command queue and buffer
-    MTL::CommandQueue* commandQueue = device->newCommandQueue();
-    MTL::CommandBuffer* commandBuffer = commandQueue->commandBuffer();
-    
-    // 6. Encode compute command
-    MTL::ComputeCommandEncoder* computeEncoder = commandBuffer->computeCommandEncoder();
-    computeEncoder->setComputePipelineState(pipelineState);
-    computeEncoder->setBuffer(textBuffer, 0, 0);       // buffer 0: text
-    computeEncoder->setBuffer(patternBuffer, 0, 1);    // buffer 1: pattern
-    computeEncoder->setBuffer(matchPositionsBuffer, 0, 2); // buffer 2: match positions
-    computeEncoder->setBuffer(matchCountBuffer, 0, 3); // buffer 3: match count
-    
-    // 7. Configure threads
-    MTL::Size gridSize = MTL::Size(text.size() - pattern.size() + 1, 1, 1);
-    NS::UInteger maxThreads = pipelineState->maxTotalThreadsPerThreadgroup();
-    MTL::Size threadgroupSize = MTL::Size(std::min(maxThreads, (NS::UInteger)gridSize.width), 1, 1);
-    
-    computeEncoder->dispatchThreads(gridSize, threadgroupSize);
-    computeEncoder->endEncoding();
-    
-    // 8. Commit and wait
-    commandBuffer->commit();
-    commandBuffer->waitUntilCompleted();
-    
-    // 9. Get results (copy data back from GPU)
-    int matchCount = *(static_cast<int*>(matchCountBuffer->contents()));
-    if (matchCount > max_matches) {
-        std::cerr << "Warning: Found " << matchCount << " matches but only "
-                  << max_matches << " can be stored" << std::endl;
-        matchCount = max_matches;
+    std::string error;
+    std::unique_ptr<SearchBackend> backend = createBackend(backend_name, error);
+    if (!backend) {
+        std::cerr << "Failed to create backend: " << error << std::endl;
+        return 1;
+    }
+    if (!backend->compile(patterns, options, error)) {
+        std::cerr << error << std::endl;
+        return 1;
     }
-    memcpy(matchPositions.data(), matchPositionsBuffer->contents(), matchCount * sizeof(int));
-    
-    std::cout << "Found " << matchCount << " matches for '" << pattern
-              << "' in file '" << filename << "'" << std::endl;
-    
-    // 10. Print matching lines
-    std::vector<size_t> line_starts;
-    line_starts.push_back(0);
-    for (size_t i = 0; i < text.size(); ++i) {
-        if (text[i] == '\n') {
-            line_starts.push_back(i + 1);
+
+    // 2. Several files are read in batches and searched concurrently, each
+    // printed as in a single-file search once the files before it are done.
+    // With -r, a walk thread lists directories on the pool meanwhile and
+    // queues the files it finds.
+    if (recursive || positional.size() > 1) {
+        if (recursive && positional.empty()) positional.push_back(".");
+        BoundedQueue<std::string> paths(recursive ? kWalkQueueLength : positional.size());
+        WalkStats walk;
+        std::thread walker;
+        if (recursive) {
+            filter.finish();
+            walker = std::thread([&] { walkDirectories(positional, filter, paths, walk); });
+        } else {
+            for (const std::string& path : positional) paths.push(path);
+            paths.close();
+        }
+        FileSearchTotals totals;
+        bool ok = searchFiles(paths, *backend, patterns, options, decompress, totals);
+        if (walker.joinable()) walker.join();
+        ok = ok && walk.unreadable == 0;
+        if (print_stats) {
+            printStats(*backend, patterns.size(), totals.bytes, totals.seconds);
+            std::cerr << "reader:    " << totals.reader << " (" << totals.files << " files)"
+                      << std::endl;
+            if (recursive) {
+                std::cerr << "walk:      " << walk.seconds * 1e3 << " ms (" << walk.directories
+                          << " directories, " << walk.files << " files, " << walk.ignored
+                          << " ignored)" << std::endl;
+            }
         }
+        return ok ? 0 : 1;
+    }
+
+    // Files are mapped and searched in place; stdin is mapped too when it is
+    // redirected from a regular file
+    filename = positional.empty() ? "stdin" : positional[0];
+    if (!input.open(positional.empty() ? "-" : positional[0], error)) {
+        std::cerr << error << std::endl;
+        return 1;
     }
-    
-    for (int i = 0; i < matchCount; ++i) {  // ONLY PROCESS ACTUAL MATCHES
-        int pos = matchPositions[i];
-        // Find which line contains this match
-        size_t line_idx = 0;
-        for (; line_idx < line_starts.size() - 1; ++line_idx) {
-            if (pos >= line_starts[line_idx] && pos < line_starts[line_idx + 1]) {
-                break;
+
+    OutputWriter& out = standardOutput();
+
+    // With -z, the members of a tar or zip archive are searched and printed
+    // like the files of a many-file search
+    std::unique_ptr<StreamSource> source;
+    if (decompress) {
+        const auto start = std::chrono::steady_clock::now();
+        std::mutex backend_mutex;
+        ArchiveSearch archive(*backend, patterns, options, backend_mutex,
+                              [&out](const std::string& text) {
+                                  out.write(text);
+                                  if (out.interactive()) out.flush();
+                              });
+        bool is_archive =
+            input.mapped() && archive.search(filename, input.data(), input.size(), error);
+        if (!is_archive) {
+            Compression compression;
+            source = openDecompressed(input, compression, error);
+            if (!error.empty()) {
+                std::cerr << filename << ": " << error << std::endl;
+                return 1;
             }
+            if (source) is_archive = archive.search(filename, source, error);
         }
-        
-        // Extract the line
-        size_t line_start = line_starts[line_idx];
-        size_t line_end = (line_idx < line_starts.size() - 1)
-                         ? line_starts[line_idx + 1] - 1
-                         : text.size();
-        std::string matching_line = text.substr(line_start, line_end - line_start);
-        
-        // Print grep-style output
-        std::cout << filename << ":" << (line_idx + 1) << ":\t" << matching_line << "\n";
+        if (is_archive) {
+            out.flush();
+            if (!error.empty()) std::cerr << error << std::endl;
+            if (print_stats) {
+                const double seconds =
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printStats(*backend, patterns.size(), archive.bytes(), seconds);
+                std::cerr << "members:   " << archive.members() << std::endl;
+            }
+            return error.empty() ? 0 : 1;
+        }
+    } else if (!input.mapped()) {
+        source = createFdSource(input.descriptor());
     }
-    
-    // 10. Free resources
-    computeEncoder->release();
-    commandBuffer->release();
-    commandQueue->release();
-    textBuffer->release();
-    patternBuffer->release();
-    pipelineState->release();
-    grepFunction->release();
-    library->release();
-    device->release();
-    
+    // Pipes, special files and (with -z) compressed input are searched block
+    // by block as they are read, and each block's lines are printed as soon
+    // as it is done, so the count comes last.
+    if (source) {
+        StreamTotals totals;
+        const bool ok = searchStream(
+            *source, *backend, streamOverlap(patterns, options),
+            [&](const char* text, size_t length, const std::vector<Match>& matches,
+                size_t lines_before) {
+                // The block's buffer is reused once this returns
+                printMatches(out, filename, text, length, matches, lines_before, options);
+                out.flush();
+            },
+            totals, error);
+        if (!ok) {
+            std::cerr << filename << ": " << error << std::endl;
+            return 1;
+        }
+        if (print_stats) printStats(*backend, patterns.size(), totals.bytes, totals.scan_seconds);
+        printSummary(out, totals.matches, patterns, options, filename);
+        out.flush();
+        return 0;
+    }
+
+    const std::vector<Match> matches = backend->search(input.data(), input.size());
+    if (print_stats) {
+        printStats(*backend, patterns.size(), input.size(), backend->stats().scan_seconds);
+    }
+    printSummary(out, matches.size(), patterns, options, filename);
+
+    // 3. Print matching lines. They are written straight from the mapping,
+    // so before it is unmapped.
+    printMatches(out, filename, input.data(), input.size(), matches, 0, options);
+    out.flush();
     return 0;
 }
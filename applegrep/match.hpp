@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// One occurrence of a search pattern: where it starts in the text and which
+// of the requested patterns (in command-line order) it is. Approximate
+// matches (--max-errors) report where they end instead, and their edit count.
+// Backends that scan in line-aligned chunks also number the line the match
+// is in; 0 leaves that to the caller.
+struct Match {
+    size_t position;
+    uint32_t pattern_id;
+    uint32_t errors = 0;
+    size_t line = 0;
+};
+
+inline bool operator<(const Match& a, const Match& b) {
+    return a.position != b.position ? a.position < b.position
+                                    : a.pattern_id < b.pattern_id;
+}
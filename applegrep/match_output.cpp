@@ -0,0 +1,129 @@
+#include "match_output.hpp"
+
+#include <charconv>
+#include <cstring>
+
+#include "scan_kernels.hpp"
+
+namespace {
+
+// A string being appended to, with the writer's interface
+struct StringOutput {
+    std::string& text;
+
+    void write(const char* bytes, size_t length) { text.append(bytes, length); }
+    void write(const std::string& bytes) { text += bytes; }
+    void writeInPlace(const char* bytes, size_t length) { text.append(bytes, length); }
+    void writeNumber(size_t value) {
+        char digits[20];
+        text.append(digits, std::to_chars(digits, digits + sizeof digits, value).ptr);
+    }
+};
+
+template <typename Output>
+void writeLiteral(Output& out, const char* literal) {
+    out.write(literal, strlen(literal));
+}
+
+template <typename Output>
+void formatSummary(Output& out, size_t match_count, const std::vector<std::string>& patterns,
+                   const SearchOptions& options, const std::string& filename) {
+    writeLiteral(out, "Found ");
+    out.writeNumber(match_count);
+    writeLiteral(out, " matches for ");
+    out.write(describePatterns(patterns));
+    if (options.max_errors > 0) {
+        writeLiteral(out, " with up to ");
+        out.writeNumber(options.max_errors);
+        writeLiteral(out, " errors");
+    }
+    writeLiteral(out, " in file '");
+    out.write(filename);
+    writeLiteral(out, "'\n");
+}
+
+template <typename Output>
+void formatMatches(Output& out, const std::string& filename, const char* text, size_t text_length,
+                   const std::vector<Match>& matches, size_t lines_before,
+                   const SearchOptions& options) {
+    const CountNewlinesFn count_newlines = scanKernels().count_newlines;
+    size_t line_number = lines_before + 1;
+    size_t counted_to = 0;
+
+    for (const Match& match : matches) {
+        const size_t pos = match.position;
+        if (match.line != 0) {
+            line_number = lines_before + match.line;
+        } else {
+            line_number += count_newlines(text + counted_to, pos - counted_to);
+            counted_to = pos;
+        }
+
+        // Extract the line
+        size_t line_start = pos;
+        while (line_start > 0 && text[line_start - 1] != '\n') --line_start;
+        const void* newline = memchr(text + pos, '\n', text_length - pos);
+        size_t line_end = newline ? static_cast<const char*>(newline) - text : text_length;
+
+        // Print grep-style output. Approximate matches also give the column
+        // their last byte is in and their edit count.
+        out.write(filename);
+        out.write(":", 1);
+        out.writeNumber(line_number);
+        out.write(":", 1);
+        if (options.max_errors > 0) {
+            out.writeNumber(pos - line_start + 1);
+            out.write(":", 1);
+            out.writeNumber(match.errors);
+            out.write(":", 1);
+        }
+        out.write("\t", 1);
+
+        // The line goes out with its own newline when it has one
+        if (newline) {
+            out.writeInPlace(text + line_start, line_end + 1 - line_start);
+        } else {
+            out.writeInPlace(text + line_start, line_end - line_start);
+            out.write("\n", 1);
+        }
+    }
+}
+
+} // namespace
+
+std::string describePatterns(const std::vector<std::string>& patterns) {
+    constexpr size_t kListed = 3;
+    std::string description;
+    for (size_t i = 0; i < patterns.size() && i < kListed; ++i) {
+        if (!description.empty()) description += ", ";
+        description += "'" + patterns[i] + "'";
+    }
+    if (patterns.size() > kListed) {
+        description += " and " + std::to_string(patterns.size() - kListed) + " more";
+    }
+    return description;
+}
+
+void printSummary(OutputWriter& out, size_t match_count, const std::vector<std::string>& patterns,
+                  const SearchOptions& options, const std::string& filename) {
+    formatSummary(out, match_count, patterns, options, filename);
+}
+
+void printSummary(std::string& out, size_t match_count, const std::vector<std::string>& patterns,
+                  const SearchOptions& options, const std::string& filename) {
+    StringOutput output{out};
+    formatSummary(output, match_count, patterns, options, filename);
+}
+
+void printMatches(OutputWriter& out, const std::string& filename, const char* text,
+                  size_t text_length, const std::vector<Match>& matches, size_t lines_before,
+                  const SearchOptions& options) {
+    formatMatches(out, filename, text, text_length, matches, lines_before, options);
+}
+
+void printMatches(std::string& out, const std::string& filename, const char* text,
+                  size_t text_length, const std::vector<Match>& matches, size_t lines_before,
+                  const SearchOptions& options) {
+    StringOutput output{out};
+    formatMatches(output, filename, text, text_length, matches, lines_before, options);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "match.hpp"
+#include "output_writer.hpp"
+#include "search_backend.hpp"
+
+// 'a' for one pattern, 'a', 'b' for several, 'a', 'b', 'c' and N more for
+// pattern files
+std::string describePatterns(const std::vector<std::string>& patterns);
+
+// The "Found N matches for ... in file '...'" line, written out or appended
+// to `out` for output that is held until its turn
+void printSummary(OutputWriter& out, size_t match_count, const std::vector<std::string>& patterns,
+                  const SearchOptions& options, const std::string& filename);
+void printSummary(std::string& out, size_t match_count, const std::vector<std::string>& patterns,
+                  const SearchOptions& options, const std::string& filename);
+
+// Print the line of each match in text[0, text_length), the first line of
+// which is line lines_before + 1 of the input. The CPU backend numbers lines
+// while it scans; otherwise positions are ascending, so line numbers are
+// found by counting newlines incrementally between consecutive matches.
+// An OutputWriter refers to long lines in `text` rather than copying them,
+// so `text` must stay valid until its next flush().
+void printMatches(OutputWriter& out, const std::string& filename, const char* text,
+                  size_t text_length, const std::vector<Match>& matches, size_t lines_before,
+                  const SearchOptions& options);
+void printMatches(std::string& out, const std::string& filename, const char* text,
+                  size_t text_length, const std::vector<Match>& matches, size_t lines_before,
+                  const SearchOptions& options);
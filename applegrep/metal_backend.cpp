@@ -0,0 +1,258 @@
+#include "search_backend.hpp"
+
+#ifdef __APPLE__
+
+#define NS_PRIVATE_IMPLEMENTATION
+#define CA_PRIVATE_IMPLEMENTATION
+#define MTL_PRIVATE_IMPLEMENTATION
+#include <Foundation/Foundation.hpp>
+#include <Metal/Metal.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+// Metal Shader for re matching
+// ... I just let LLM to implement the Boyer-Moore-Horspool algorithm
+static const char* grepShaderSource = R"(
+#include <metal_stdlib>
+using namespace metal;
+
+// Pattern length baked into the pipeline (1..16), so the compare loop below
+// has a constant trip count and unrolls; 0 selects the generic pipeline,
+// which reads the length from its argument
+constant uint fixed_length [[function_constant(0)]];
+
+kernel void grep_kernel(
+    device const char* text [[buffer(0)]],
+    constant char* pattern [[buffer(1)]],
+    device int* match_positions [[buffer(2)]],  // Buffer to store match positions
+    device atomic_int* match_count [[buffer(3)]], // Atomic counter
+    constant int& max_matches [[buffer(4)]],     // Capacity of match_positions
+    constant uint& text_length [[buffer(5)]],
+    constant uint& pattern_argument_length [[buffer(6)]],
+    uint tid [[thread_position_in_grid]])
+{
+    const uint pattern_length = fixed_length != 0 ? fixed_length : pattern_argument_length;
+
+    // The grid covers exactly the alignments that fit, but stay safe
+    if (tid > text_length - pattern_length) return;
+
+    // Each thread verifies exactly one alignment, so a bad-character shift
+    // table would never be consulted; skipping lives in the CPU engines
+    // (horspool.cpp) where one thread walks many alignments.
+    int j = pattern_length - 1;
+
+    // Compare from right to left
+    while (j >= 0 && pattern[j] == text[tid + j]) {
+        j--;
+    }
+
+    if (j < 0) {
+        // Pattern found - use atomic operation to ensure unique position
+        int count = atomic_fetch_add_explicit(match_count, 1, memory_order_relaxed);
+        if (count < max_matches) {  // Prevent buffer overflow
+            match_positions[count] = tid;
+        }
+    }
+}
+)";
+
+namespace {
+
+class MetalBackend : public SearchBackend {
+public:
+    explicit MetalBackend(MTL::Device* device) : device(device) {}
+
+    ~MetalBackend() override {
+        for (MTL::ComputePipelineState* pipeline : pipelines) {
+            if (pipeline) pipeline->release();
+        }
+        if (library) library->release();
+        if (commandQueue) commandQueue->release();
+        device->release();
+    }
+
+    const char* name() const override { return "metal"; }
+
+    bool compile(const std::vector<std::string>& patterns, const SearchOptions& options,
+                 std::string& error) override {
+        if (options.extended_regex || options.max_errors > 0 || options.ignore_case) {
+            error = "the Metal backend only searches exact, case-sensitive literal patterns";
+            return false;
+        }
+        this->patterns = patterns;
+        last_stats = SearchStats();
+        last_stats.engine = "metal";
+        return true;
+    }
+
+    // The shader handles one pattern per dispatch; all dispatches share one
+    // buffer over the text
+    std::vector<Match> search(const char* text, size_t text_length) override {
+        std::vector<Match> matches;
+        const auto start = std::chrono::steady_clock::now();
+        MTL::Buffer* textBuffer = wrapText(text, text_length);
+        for (size_t id = 0; id < patterns.size(); ++id) {
+            for (size_t position : searchOne(textBuffer, text_length, patterns[id])) {
+                matches.push_back({position, static_cast<uint32_t>(id)});
+            }
+        }
+        textBuffer->release();
+        std::sort(matches.begin(), matches.end());
+        last_stats.scan_seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return matches;
+    }
+
+private:
+    // Page-aligned text (a mapped input file) is handed to the GPU in place.
+    // The buffer is rounded up to whole pages, which are readable because the
+    // last byte's page is; the shader stops at text_length. Other text is copied.
+    MTL::Buffer* wrapText(const char* text, size_t text_length) {
+        const size_t page = static_cast<size_t>(getpagesize());
+        if (reinterpret_cast<uintptr_t>(text) % page == 0) {
+            const size_t padded = (text_length + page - 1) / page * page;
+            MTL::Buffer* buffer = device->newBuffer(const_cast<char*>(text), padded,
+                                                    MTL::ResourceStorageModeShared, nullptr);
+            if (buffer) return buffer;
+        }
+        return device->newBuffer(text, text_length, MTL::ResourceStorageModeShared);
+    }
+
+    std::vector<size_t> searchOne(MTL::Buffer* textBuffer, size_t text_length,
+                                  const std::string& pattern) {
+        std::vector<size_t> matches;
+        if (pattern.empty() || pattern.size() > text_length) return matches;
+        MTL::ComputePipelineState* pipelineState = prepare(pattern.size());
+        if (!pipelineState) return matches;
+
+        // 1. Prepare data. Lengths are passed in, so neither buffer needs a
+        // terminator.
+        const uint32_t textLength = static_cast<uint32_t>(text_length);
+        const uint32_t patternLength = static_cast<uint32_t>(pattern.size());
+
+        // 2. Create buffers
+        int initialMatchCount = 0;
+        std::vector<int> matchPositions(max_matches, 0);
+
+        MTL::Buffer* patternBuffer = device->newBuffer(pattern.data(), pattern.size(), MTL::ResourceStorageModeShared);
+        MTL::Buffer* matchCountBuffer = device->newBuffer(&initialMatchCount, sizeof(int), MTL::ResourceStorageModeShared);
+        MTL::Buffer* matchPositionsBuffer = device->newBuffer(matchPositions.data(), max_matches * sizeof(int), MTL::ResourceStorageModeShared);
+
+        // 3. Create command buffer
+        MTL::CommandBuffer* commandBuffer = commandQueue->commandBuffer();
+
+        // 4. Encode compute command
+        MTL::ComputeCommandEncoder* computeEncoder = commandBuffer->computeCommandEncoder();
+        computeEncoder->setComputePipelineState(pipelineState);
+        computeEncoder->setBuffer(textBuffer, 0, 0);       // buffer 0: text
+        computeEncoder->setBuffer(patternBuffer, 0, 1);    // buffer 1: pattern
+        computeEncoder->setBuffer(matchPositionsBuffer, 0, 2); // buffer 2: match positions
+        computeEncoder->setBuffer(matchCountBuffer, 0, 3); // buffer 3: match count
+        computeEncoder->setBytes(&max_matches, sizeof(int), 4); // buffer 4: capacity
+        computeEncoder->setBytes(&textLength, sizeof(textLength), 5);       // buffer 5: text length
+        computeEncoder->setBytes(&patternLength, sizeof(patternLength), 6); // buffer 6: pattern length
+
+        // 5. Configure threads
+        MTL::Size gridSize = MTL::Size(text_length - pattern.size() + 1, 1, 1);
+        NS::UInteger maxThreads = pipelineState->maxTotalThreadsPerThreadgroup();
+        MTL::Size threadgroupSize = MTL::Size(std::min(maxThreads, (NS::UInteger)gridSize.width), 1, 1);
+
+        computeEncoder->dispatchThreads(gridSize, threadgroupSize);
+        computeEncoder->endEncoding();
+
+        // 6. Commit and wait
+        commandBuffer->commit();
+        commandBuffer->waitUntilCompleted();
+
+        // 7. Get results (copy data back from GPU)
+        int matchCount = *(static_cast<int*>(matchCountBuffer->contents()));
+        if (matchCount > max_matches) {
+            std::cerr << "Warning: Found " << matchCount << " matches but only "
+                      << max_matches << " can be stored" << std::endl;
+            matchCount = max_matches;
+        }
+        memcpy(matchPositions.data(), matchPositionsBuffer->contents(), matchCount * sizeof(int));
+
+        // Threads finish in any order; the contract is ascending positions
+        matches.assign(matchPositions.begin(), matchPositions.begin() + matchCount);
+        std::sort(matches.begin(), matches.end());
+
+        // 8. Free per-search resources
+        computeEncoder->release();
+        commandBuffer->release();
+        patternBuffer->release();
+        matchCountBuffer->release();
+        matchPositionsBuffer->release();
+
+        return matches;
+    }
+
+    // The pipeline for a pattern of `pattern_length` bytes: specialised for
+    // that length up to kMaxFixedPatternLength, generic above. The shader is
+    // compiled once and each pipeline is built on first use.
+    MTL::ComputePipelineState* prepare(size_t pattern_length) {
+        const uint32_t fixedLength =
+            pattern_length <= kMaxFixedPatternLength ? static_cast<uint32_t>(pattern_length) : 0;
+        if (pipelines[fixedLength]) return pipelines[fixedLength];
+
+        NS::Error* error = nullptr;
+        if (!library) {
+            library = device->newLibrary(
+                NS::String::string(grepShaderSource, NS::UTF8StringEncoding), nullptr, &error);
+            if (!library) {
+                std::cerr << "Failed to compile shader: " << error->localizedDescription()->utf8String() << std::endl;
+                return nullptr;
+            }
+            commandQueue = device->newCommandQueue();
+        }
+
+        MTL::FunctionConstantValues* constants = MTL::FunctionConstantValues::alloc()->init();
+        constants->setConstantValue(&fixedLength, MTL::DataTypeUInt, NS::UInteger(0));
+        MTL::Function* grepFunction = library->newFunction(
+            NS::String::string("grep_kernel", NS::UTF8StringEncoding), constants, &error);
+        constants->release();
+        if (!grepFunction) {
+            std::cerr << "Failed to specialise shader: " << error->localizedDescription()->utf8String() << std::endl;
+            return nullptr;
+        }
+        MTL::ComputePipelineState* pipelineState = device->newComputePipelineState(grepFunction, &error);
+        grepFunction->release();
+        if (!pipelineState) {
+            std::cerr << "Failed to create pipeline: " << error->localizedDescription()->utf8String() << std::endl;
+            return nullptr;
+        }
+        pipelines[fixedLength] = pipelineState;
+        return pipelineState;
+    }
+
+    // Same bound as the CPU kernels' kMaxFixedLiteral
+    static constexpr size_t kMaxFixedPatternLength = 16;
+
+    const int max_matches = 1000;  // Matches the historical shader-side limit
+
+    MTL::Device* device;
+    MTL::Library* library = nullptr;
+    // Index 0 is the generic pipeline, 1..kMaxFixedPatternLength the specialised ones
+    MTL::ComputePipelineState* pipelines[kMaxFixedPatternLength + 1] = {};
+    MTL::CommandQueue* commandQueue = nullptr;
+    std::vector<std::string> patterns;
+};
+
+} // namespace
+
+std::unique_ptr<SearchBackend> createMetalBackend() {
+    MTL::Device* device = MTL::CreateSystemDefaultDevice();
+    if (!device) return nullptr;
+    return std::make_unique<MetalBackend>(device);
+}
+
+#else
+
+std::unique_ptr<SearchBackend> createMetalBackend() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,341 @@
+#include "multi_file_search.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "archive_search.hpp"
+#include "decompress.hpp"
+#include "file_reader.hpp"
+#include "input_file.hpp"
+#include "match_output.hpp"
+#include "output_writer.hpp"
+#include "stream_search.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace {
+
+// Output held in memory beyond this goes to a temporary file
+constexpr size_t kHeldBytes = 16 << 20;
+
+// Read back from the temporary file in pieces of this size
+constexpr size_t kSpillReadBytes = 1 << 20;
+
+void appendText(OutputWriter& out, const std::string& text) { out.write(text); }
+void appendText(std::string& out, const std::string& text) { out += text; }
+
+// Output of a file that is not yet due to be written: the first kHeldBytes
+// in memory, anything beyond in an unnamed temporary file
+class HeldOutput {
+public:
+    HeldOutput() = default;
+    HeldOutput(HeldOutput&& other) noexcept
+        : text(std::move(other.text)), spill(std::exchange(other.spill, nullptr)) {}
+    HeldOutput& operator=(HeldOutput&& other) noexcept {
+        std::swap(text, other.text);
+        std::swap(spill, other.spill);
+        return *this;
+    }
+    ~HeldOutput() {
+        if (spill) fclose(spill);
+    }
+
+    std::string& buffer() { return text; }
+
+    // Move the buffer to the temporary file once it is large. Without a
+    // temporary file the output stays in memory.
+    void limit() {
+        if (text.size() <= kHeldBytes) return;
+        if (!spill) spill = tmpfile();
+        if (spill && fwrite(text.data(), 1, text.size(), spill) == text.size()) {
+            text.clear();
+            text.shrink_to_fit();
+        }
+    }
+
+    void writeTo(OutputWriter& out) {
+        if (spill) {
+            rewind(spill);
+            std::unique_ptr<char[]> piece(new char[kSpillReadBytes]);
+            size_t got;
+            while ((got = fread(piece.get(), 1, kSpillReadBytes, spill)) > 0) {
+                out.write(piece.get(), got);
+            }
+            fclose(spill);
+            spill = nullptr;
+        }
+        out.write(text);
+        text.clear();
+    }
+
+private:
+    std::string text;
+    FILE* spill = nullptr;
+};
+
+// Writes each file's output in queue order. The file whose turn it is (all
+// files before it are done) writes straight to standard output; a file that
+// has output before its turn holds it until the files before it are written.
+class OrderedOutput {
+public:
+    // Whether file `index` may write to standardOutput() until finish(index)
+    bool current(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return index == written;
+    }
+
+    void finish(size_t index, HeldOutput held) {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting.emplace(index, std::move(held));
+        OutputWriter& out = standardOutput();
+        const size_t written_before = written;
+        for (auto next = waiting.begin(); next != waiting.end() && next->first == written;
+             next = waiting.erase(next)) {
+            next->second.writeTo(out);
+            ++written;
+        }
+        if (written != written_before && out.interactive()) out.flush();
+    }
+
+private:
+    std::mutex mutex;
+    std::map<size_t, HeldOutput> waiting;
+    size_t written = 0;
+};
+
+// The output of one file. write(print) calls print(OutputWriter&) on
+// standard output once it is the file's turn, and print(std::string&) into
+// the held output before that, so a file that is next in order is printed
+// without being copied. Bytes print() writes in place only need to stay
+// valid until write() returns.
+class FileOutput {
+public:
+    FileOutput(OrderedOutput& order, size_t index) : order(order), index(index) {}
+
+    template <typename Print>
+    void write(Print&& print) {
+        if (!direct && order.current(index)) {
+            direct = true;
+            held.writeTo(standardOutput());
+        }
+        if (direct) {
+            OutputWriter& out = standardOutput();
+            print(out);
+            if (out.refersInPlace()) out.flush();
+        } else {
+            print(held.buffer());
+            held.limit();
+        }
+    }
+
+    void finish() { order.finish(index, std::move(held)); }
+
+private:
+    OrderedOutput& order;
+    const size_t index;
+    bool direct = false;
+    HeldOutput held;
+};
+
+class FileSearch {
+public:
+    FileSearch(SearchBackend& backend, const std::vector<std::string>& patterns,
+               const SearchOptions& options, bool decompress, FileReader& reader)
+        : backend(backend), patterns(patterns), options(options), decompress(decompress),
+          reader(reader) {}
+
+    void searchOne(ReadFile& file) {
+        FileOutput out(output, file.index);  // Most files have none
+        size_t count = 0;
+        size_t bytes = 0;
+        std::string error;
+        if (file.error != 0) {
+            error = "cannot open " + file.path + ": " + strerror(file.error);
+        } else if (file.loaded) {
+            if (!decompress ||
+                !searchUnpacked(file.path, file.data, file.length, out, count, bytes, error)) {
+                if (file.length > 0) {
+                    const std::vector<Match> matches = search(file.data, file.length);
+                    count = matches.size();
+                    print(out, file.path, file.data, file.length, matches);
+                }
+                bytes = file.length;
+            }
+            reader.release(file.slot);
+        } else {
+            searchUnloaded(file.path, out, count, bytes, error);
+        }
+
+        totals_bytes += bytes;
+        totals_matches += count;
+        if (!error.empty()) {
+            ++unreadable;
+            std::lock_guard<std::mutex> lock(error_mutex);
+            std::cerr << error << std::endl;
+        }
+        out.finish();
+    }
+
+    std::atomic<size_t> totals_bytes{0};
+    std::atomic<size_t> totals_matches{0};
+    std::atomic<size_t> unreadable{0};
+
+private:
+    // Too large for a reader slot, or not a regular file: map or stream it
+    void searchUnloaded(const std::string& path, FileOutput& out, size_t& count, size_t& bytes,
+                        std::string& error) {
+        InputFile input;
+        if (!input.open(path, error)) return;
+        if (decompress && input.mapped()) {
+            if (searchUnpacked(path, input.data(), input.size(), out, count, bytes, error)) return;
+        } else if (decompress) {
+            Compression compression;
+            std::unique_ptr<StreamSource> source = openDecompressed(input, compression, error);
+            if (source) {
+                searchUnpacked(path, std::move(source), out, count, bytes, error);
+            } else {
+                error = path + ": " + error;
+            }
+            return;
+        } else if (!input.mapped()) {
+            std::unique_ptr<StreamSource> source = createFdSource(input.descriptor());
+            searchSource(path, *source, out, count, bytes, error);
+            return;
+        }
+        const std::vector<Match> matches = search(input.data(), input.size());
+        count = matches.size();
+        bytes = input.size();
+        print(out, path, input.data(), input.size(), matches);
+    }
+
+    // -z: search an archive's members, or decompressed bytes. Returns false
+    // when `data` is neither an archive nor compressed.
+    bool searchUnpacked(const std::string& path, const char* data, size_t length,
+                        FileOutput& out, size_t& count, size_t& bytes, std::string& error) {
+        ArchiveSearch archive(backend, patterns, options, backend_mutex, memberOutput(out));
+        if (archive.search(path, data, length, error)) {
+            count = archive.matches();
+            bytes = archive.bytes();
+            return true;
+        }
+        Compression compression;
+        std::unique_ptr<StreamSource> source = openDecompressed(data, length, compression, error);
+        if (source) {
+            searchUnpacked(path, std::move(source), out, count, bytes, error);
+        } else if (!error.empty()) {
+            error = path + ": " + error;
+        }
+        return compression != Compression::None;
+    }
+
+    // The same for a stream, which may hold a tar or zip archive
+    void searchUnpacked(const std::string& path, std::unique_ptr<StreamSource> source,
+                        FileOutput& out, size_t& count, size_t& bytes, std::string& error) {
+        ArchiveSearch archive(backend, patterns, options, backend_mutex, memberOutput(out));
+        if (archive.search(path, source, error)) {
+            count = archive.matches();
+            bytes = archive.bytes();
+        } else {
+            searchSource(path, *source, out, count, bytes, error);
+        }
+    }
+
+    static ArchiveSearch::OutputFn memberOutput(FileOutput& out) {
+        return [&out](const std::string& member) {
+            out.write([&](auto& to) { appendText(to, member); });
+        };
+    }
+
+    // As in a single-file search, each block's lines are printed as soon as
+    // it is done and the count comes last
+    void searchSource(const std::string& path, StreamSource& source, FileOutput& out,
+                      size_t& count, size_t& bytes, std::string& error) {
+        std::unique_lock<std::mutex> lock(backend_mutex, std::defer_lock);
+        if (!backend.concurrentSearch()) lock.lock();
+        StreamTotals streamed;
+        searchStream(
+            source, backend, streamOverlap(patterns, options),
+            [&](const char* block, size_t length, const std::vector<Match>& matches,
+                size_t lines_before) {
+                // The block's buffer is reused once this returns
+                out.write([&](auto& to) {
+                    printMatches(to, path, block, length, matches, lines_before, options);
+                });
+            },
+            streamed, error);
+        if (!error.empty()) error = path + ": " + error;
+        count = streamed.matches;
+        bytes = streamed.bytes;
+        if (count > 0) {
+            out.write([&](auto& to) { printSummary(to, count, patterns, options, path); });
+        }
+    }
+
+    // The summary line and matching lines of one file, or nothing
+    void print(FileOutput& out, const std::string& path, const char* text, size_t text_length,
+               const std::vector<Match>& matches) const {
+        if (matches.empty()) return;
+        out.write([&](auto& to) {
+            printSummary(to, matches.size(), patterns, options, path);
+            printMatches(to, path, text, text_length, matches, 0, options);
+        });
+    }
+
+    std::vector<Match> search(const char* text, size_t text_length) {
+        std::unique_lock<std::mutex> lock(backend_mutex, std::defer_lock);
+        if (!backend.concurrentSearch()) lock.lock();
+        return backend.search(text, text_length);
+    }
+
+    SearchBackend& backend;
+    const std::vector<std::string>& patterns;
+    const SearchOptions& options;
+    const bool decompress;  // -z
+    FileReader& reader;
+    OrderedOutput output;
+    std::mutex backend_mutex;  // Serialises backends without concurrentSearch()
+    std::mutex error_mutex;
+};
+
+} // namespace
+
+bool searchFiles(BoundedQueue<std::string>& paths, SearchBackend& backend,
+                 const std::vector<std::string>& patterns, const SearchOptions& options,
+                 bool decompress, FileSearchTotals& totals) {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<FileReader> reader = createFileReader();
+    FileSearch search(backend, patterns, options, decompress, *reader);
+    WorkStealingPool& pool = sharedPool();
+    TaskGroup group;
+    size_t files = 0;
+
+    // The reader runs on its own thread and may block on a full set of
+    // slots; this thread scans alongside the pool until both are done
+    pool.hold(group);
+    std::thread reader_thread([&] {
+        reader->run(paths, [&](ReadFile&& file) {
+            ++files;
+            pool.submit(group, [&search, file = std::move(file)]() mutable {
+                search.searchOne(file);
+            });
+        });
+        pool.release(group);
+    });
+    pool.wait(group);
+    reader_thread.join();
+    standardOutput().flush();
+
+    totals.reader = reader->name();
+    totals.files = files;
+    totals.bytes = search.totals_bytes;
+    totals.matches = search.totals_matches;
+    totals.unreadable = search.unreadable;
+    totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return totals.unreadable == 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "search_backend.hpp"
+
+// What a many-file search read and found, for --stats
+struct FileSearchTotals {
+    const char* reader = "";  // FileReader that loaded the small files
+    size_t files = 0;
+    size_t bytes = 0;
+    size_t matches = 0;
+    size_t unreadable = 0;
+    double seconds = 0;       // Wall time from the first read to the last match
+};
+
+// Search every path popped from `paths` until it is closed. A FileReader
+// thread loads small files in batches (see file_reader.hpp) and hands each
+// to a scan task on the shared pool; larger files are mapped by the task and
+// split further, and special files are streamed. Files with matches are
+// printed in queue order as in a single-file search: the summary line and
+// then the lines, or for a streamed file the lines and then the summary. The
+// file whose turn it is writes straight to standard output; later files hold
+// their output until every file before them is done. With `decompress` (-z), compressed files are
+// streamed through their decoder (see decompress.hpp) and their decoded
+// bytes counted, and the members of tar and zip archives are printed as
+// files of their own (see archive_search.hpp). Files that cannot be read are
+// reported on stderr. Returns false if any file could not be read.
+bool searchFiles(BoundedQueue<std::string>& paths, SearchBackend& backend,
+                 const std::vector<std::string>& patterns, const SearchOptions& options,
+                 bool decompress, FileSearchTotals& totals);
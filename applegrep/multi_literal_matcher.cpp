@@ -0,0 +1,60 @@
+#include "multi_literal_matcher.hpp"
+
+#include <algorithm>
+
+#include "aho_corasick.hpp"
+#include "literal_matcher.hpp"
+#include "teddy.hpp"
+
+namespace {
+
+// Teddy verifies every candidate against its whole bucket, so its cost grows
+// with the set size; past this many patterns the automaton wins
+constexpr size_t kTeddyMaxPatterns = 64;
+
+// Exactly one pattern can match: run the single-literal planner's engine
+class SingleLiteralMatcher : public PatternMatcher {
+public:
+    SingleLiteralMatcher(std::unique_ptr<LiteralMatcher> literal, uint32_t pattern_id)
+        : literal(std::move(literal)), pattern_id(pattern_id) {}
+
+    const char* name() const override { return literal->name(); }
+
+    void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                 std::vector<Match>& matches) const override {
+        if (literal->length() > text_length) return;
+        const size_t limit = std::min(to, text_length - literal->length() + 1);
+        if (from < limit) literal->findAll(text, from, limit, pattern_id, matches);
+    }
+
+    size_t memoryUsage() const override {
+        return sizeof(*this) + literal->memoryUsage();
+    }
+
+private:
+    std::unique_ptr<LiteralMatcher> literal;
+    uint32_t pattern_id;
+};
+
+} // namespace
+
+std::unique_ptr<PatternMatcher> compileLiterals(const std::vector<std::string>& patterns,
+                                                bool fold_case,
+                                                const char* sample, size_t sample_length) {
+    size_t live = 0, last_live = 0;
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        if (!patterns[id].empty()) {
+            ++live;
+            last_live = id;
+        }
+    }
+    if (live == 1) {
+        return std::make_unique<SingleLiteralMatcher>(
+            compileLiteral(patterns[last_live], fold_case, sample, sample_length),
+            static_cast<uint32_t>(last_live));
+    }
+    if (live <= kTeddyMaxPatterns) {
+        return std::make_unique<TeddyMatcher>(patterns, fold_case);
+    }
+    return std::make_unique<AhoCorasickMatcher>(patterns, fold_case);
+}
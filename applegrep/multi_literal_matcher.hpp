@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pattern_matcher.hpp"
+
+// Pick and build the engine for a set of literal patterns: a single-literal
+// engine for one pattern, Teddy for small sets and Aho-Corasick for large
+// ones (pattern files). Empty patterns are kept (so ids stay aligned with the
+// input) but never match. With fold_case ASCII letters match either case. An
+// optional sample of the input refines single-pattern prefilters.
+std::unique_ptr<PatternMatcher> compileLiterals(const std::vector<std::string>& patterns,
+                                                bool fold_case,
+                                                const char* sample = nullptr,
+                                                size_t sample_length = 0);
@@ -0,0 +1,117 @@
+#include "nfa.hpp"
+
+namespace {
+
+// Builds states back to front: each node is compiled knowing the state that
+// follows it, so no patch lists are needed
+class NfaBuilder {
+public:
+    explicit NfaBuilder(Nfa& nfa) : nfa(nfa) {}
+
+    uint32_t compile(const RegexNode& node, uint32_t next) {
+        switch (node.kind) {
+            case RegexNode::Kind::Empty:
+                return next;
+            case RegexNode::Kind::Bytes:
+                return push(NfaState::Kind::Bytes, next, 0, setIndex(node.bytes));
+            case RegexNode::Kind::LineStart:
+                return push(NfaState::Kind::LineStart, next);
+            case RegexNode::Kind::LineEnd:
+                return push(NfaState::Kind::LineEnd, next);
+            case RegexNode::Kind::Concat:
+                for (size_t i = node.children.size(); i-- > 0;) {
+                    next = compile(node.children[i], next);
+                }
+                return next;
+            case RegexNode::Kind::Alternate: {
+                uint32_t start = compile(node.children.back(), next);
+                for (size_t i = node.children.size() - 1; i-- > 0;) {
+                    start = push(NfaState::Kind::Split, compile(node.children[i], next), start);
+                }
+                return start;
+            }
+            case RegexNode::Kind::Repeat:
+                return compileRepeat(node, next);
+        }
+        return next;
+    }
+
+private:
+    uint32_t compileRepeat(const RegexNode& node, uint32_t next) {
+        const RegexNode& body = node.children[0];
+        uint32_t start = next;
+        if (node.max < 0) {
+            // body*: a split that either enters the body or leaves; the body
+            // loops back to the split
+            const uint32_t loop = push(NfaState::Kind::Split, 0, next);
+            nfa.states[loop].out = compile(body, loop);
+            start = loop;
+        } else {
+            // Optional copies, innermost first: (body (body)?)?
+            for (int i = node.min; i < node.max; ++i) {
+                start = push(NfaState::Kind::Split, compile(body, start), next);
+            }
+        }
+        for (int i = 0; i < node.min; ++i) start = compile(body, start);
+        return start;
+    }
+
+    uint32_t push(NfaState::Kind kind, uint32_t out, uint32_t out1 = 0, uint32_t index = 0) {
+        nfa.states.push_back({kind, out, out1, index});
+        return static_cast<uint32_t>(nfa.states.size() - 1);
+    }
+
+    uint32_t setIndex(const std::bitset<256>& bytes) {
+        auto inserted = nfa.set_ids.emplace(bytes, static_cast<uint32_t>(nfa.byte_sets.size()));
+        if (inserted.second) nfa.byte_sets.push_back(bytes);
+        return inserted.first->second;
+    }
+
+    Nfa& nfa;
+};
+
+} // namespace
+
+void Nfa::add(const RegexNode& root, uint32_t pattern_id) {
+    NfaBuilder builder(*this);
+    states.push_back({NfaState::Kind::Match, 0, 0, pattern_id});
+    starts.push_back(builder.compile(root, static_cast<uint32_t>(states.size() - 1)));
+}
+
+void Nfa::finish() {
+    // Refine one partition of the bytes by every set: two bytes stay in one
+    // class only if every set holds both or neither. The newline gets a
+    // class of its own since lines are matched one at a time.
+    std::vector<std::bitset<256>> sets = byte_sets;
+    std::bitset<256> newline;
+    newline.set('\n');
+    sets.push_back(newline);
+
+    uint16_t classes[256] = {};
+    size_t count = 1;
+    for (const std::bitset<256>& set : sets) {
+        uint16_t split[256][2];
+        for (size_t c = 0; c < count; ++c) split[c][0] = split[c][1] = UINT16_MAX;
+        size_t refined = 0;
+        for (int b = 0; b < 256; ++b) {
+            uint16_t& target = split[classes[b]][set.test(b)];
+            if (target == UINT16_MAX) target = static_cast<uint16_t>(refined++);
+            classes[b] = target;
+        }
+        count = refined;
+    }
+
+    set_ids = {};
+    class_count = count;
+    for (int b = 255; b >= 0; --b) {
+        byte_classes[b] = static_cast<uint8_t>(classes[b]);
+        class_bytes[classes[b]] = static_cast<uint8_t>(b);
+    }
+}
+
+size_t Nfa::memoryUsage() const {
+    return sizeof(*this) +
+           states.capacity() * sizeof(NfaState) +
+           byte_sets.capacity() * sizeof(std::bitset<256>) +
+           starts.capacity() * sizeof(uint32_t);
+}
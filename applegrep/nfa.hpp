@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "regex_syntax.hpp"
+
+struct NfaState {
+    enum class Kind : uint8_t {
+        Bytes,      // Consume one byte of byte_sets[index], then go to out
+        Split,      // Go to out and out1
+        LineStart,  // Go to out at the start of a line
+        LineEnd,    // Go to out at the end of a line
+        Match,      // Pattern `index` matched
+    };
+
+    Kind kind;
+    uint32_t out = 0;
+    uint32_t out1 = 0;
+    uint32_t index = 0;
+};
+
+// Thompson NFA for a set of regexes, each with its own Match state. Bytes
+// are grouped into classes that no state tells apart, so a DFA built from it
+// needs one transition per class rather than per byte.
+struct Nfa {
+    std::vector<NfaState> states;
+    std::vector<std::bitset<256>> byte_sets;
+    std::vector<uint32_t> starts;  // One per added regex
+
+    uint8_t byte_classes[256] = {};
+    size_t class_count = 1;
+    uint8_t class_bytes[256] = {};  // A representative byte of each class
+
+    // Compile `root` (from parseRegex) so that a match reports pattern_id
+    void add(const RegexNode& root, uint32_t pattern_id);
+
+    // Compute the byte classes; call after the last add()
+    void finish();
+
+    size_t memoryUsage() const;
+
+    // Index of each distinct byte set, while patterns are being added
+    std::unordered_map<std::bitset<256>, uint32_t> set_ids;
+};
@@ -0,0 +1,115 @@
+#include "output_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace {
+
+// Copied bytes are held up to this much before the block is written
+constexpr size_t kBufferBytes = 256 << 10;
+
+// writev() takes at most IOV_MAX (1024 on Linux and macOS) pieces a call
+constexpr size_t kMaxPieces = 1024;
+
+// In-place runs up to this long are cheaper to copy than to give a piece of
+// their own; writes above kDirectBytes skip the buffer
+constexpr size_t kCopyBytes = 256;
+constexpr size_t kDirectBytes = kBufferBytes / 4;
+
+} // namespace
+
+OutputWriter::OutputWriter(int fd)
+    : fd(fd), is_terminal(isatty(fd) == 1), buffer(new char[kBufferBytes]) {
+    pieces.reserve(kMaxPieces);
+}
+
+OutputWriter::~OutputWriter() { flush(); }
+
+void OutputWriter::write(const char* bytes, size_t length) {
+    if (length == 0) return;
+    if (length > kDirectBytes) {
+        flush();
+        writeAll(bytes, length);
+        return;
+    }
+    if (used + length > kBufferBytes || pieces.size() == kMaxPieces) flush();
+    char* to = buffer.get() + used;
+    memcpy(to, bytes, length);
+    used += length;
+    add(to, length);
+}
+
+void OutputWriter::writeNumber(size_t value) {
+    char digits[20];
+    const char* end = std::to_chars(digits, digits + sizeof digits, value).ptr;
+    write(digits, static_cast<size_t>(end - digits));
+}
+
+void OutputWriter::writeInPlace(const char* bytes, size_t length) {
+    if (length <= kCopyBytes) {
+        write(bytes, length);
+        return;
+    }
+    if (pieces.size() == kMaxPieces) flush();
+    add(bytes, length);
+    in_place = true;
+}
+
+bool OutputWriter::flush() {
+    size_t first = 0;
+    while (first < pieces.size() && !failed) {
+        const int count = static_cast<int>(std::min(pieces.size() - first, kMaxPieces));
+        ssize_t wrote = ::writev(fd, &pieces[first], count);
+        if (wrote < 0) {
+            if (errno != EINTR) failed = true;
+            continue;
+        }
+        // Step past what was written; a short write leaves a partial piece
+        while (wrote > 0) {
+            iovec& piece = pieces[first];
+            const size_t taken = std::min(static_cast<size_t>(wrote), piece.iov_len);
+            piece.iov_base = static_cast<char*>(piece.iov_base) + taken;
+            piece.iov_len -= taken;
+            wrote -= static_cast<ssize_t>(taken);
+            if (piece.iov_len == 0) ++first;
+        }
+    }
+    pieces.clear();
+    used = 0;
+    in_place = false;
+    return !failed;
+}
+
+// Runs that continue the last piece (copies landing next to each other in
+// the buffer) extend it instead of taking a new one
+void OutputWriter::add(const char* bytes, size_t length) {
+    if (!pieces.empty()) {
+        iovec& last = pieces.back();
+        if (static_cast<const char*>(last.iov_base) + last.iov_len == bytes) {
+            last.iov_len += length;
+            return;
+        }
+    }
+    pieces.push_back({const_cast<char*>(bytes), length});
+}
+
+void OutputWriter::writeAll(const char* bytes, size_t length) {
+    while (length > 0 && !failed) {
+        const ssize_t wrote = ::write(fd, bytes, length);
+        if (wrote < 0) {
+            if (errno != EINTR) failed = true;
+            continue;
+        }
+        bytes += wrote;
+        length -= static_cast<size_t>(wrote);
+    }
+}
+
+OutputWriter& standardOutput() {
+    static OutputWriter writer(STDOUT_FILENO);
+    return writer;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+// Collects output in one large block and hands it to the kernel with
+// writev(), instead of an ostream call per field and a flush per file.
+// Bytes are either copied into the writer's buffer (prefixes, numbers, short
+// lines) or referenced where they are (long lines of a mapped input), so
+// printing a match allocates nothing and a long line is never copied. Not
+// thread-safe: callers that print from several threads serialise.
+class OutputWriter {
+public:
+    explicit OutputWriter(int fd);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    void write(const char* bytes, size_t length);
+    void write(const std::string& text) { write(text.data(), text.size()); }
+    void writeNumber(size_t value);
+
+    // Bytes that stay valid and unchanged until the next flush(); long runs
+    // are written from where they are
+    void writeInPlace(const char* bytes, size_t length);
+
+    // Whether unflushed output refers to bytes passed to writeInPlace(), so
+    // they must be flushed before those bytes go away
+    bool refersInPlace() const { return in_place; }
+
+    // Write out everything so far. Returns false once a write has failed
+    // (say, a closed pipe with SIGPIPE ignored); later output is dropped.
+    bool flush();
+
+    // Whether the output is a terminal, where each file's or block's output
+    // should show up as soon as it is complete
+    bool interactive() const { return is_terminal; }
+
+private:
+    void add(const char* bytes, size_t length);
+    void writeAll(const char* bytes, size_t length);
+
+    const int fd;
+    const bool is_terminal;
+    bool failed = false;
+    bool in_place = false;
+    std::unique_ptr<char[]> buffer;
+    size_t used = 0;
+    std::vector<iovec> pieces;
+};
+
+// The writer for standard output, created on first use and flushed at exit
+OutputWriter& standardOutput();
@@ -0,0 +1,105 @@
+#include "path_filter.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Ignore files larger than this are read only this far
+constexpr size_t kMaxIgnoreFileBytes = 1 << 20;
+
+struct Rule {
+    std::string glob;
+    bool negated = false;
+    bool directory_only = false;
+};
+
+// Split a leading '!' and a trailing '/' off a glob. Returns false when
+// nothing is left.
+bool parseRule(std::string glob, Rule& rule) {
+    rule.negated = !glob.empty() && glob[0] == '!';
+    if (rule.negated) glob.erase(0, 1);
+    rule.directory_only = !glob.empty() && glob.back() == '/';
+    while (!glob.empty() && glob.back() == '/') glob.pop_back();
+    rule.glob = std::move(glob);
+    return !rule.glob.empty();
+}
+
+// One line of an ignore file, as git reads it: '#' starts a comment and
+// trailing spaces go unless escaped. "\#" and "\!" reach the glob as
+// escapes, so they match the byte itself.
+bool parseIgnoreLine(std::string line, Rule& rule) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    size_t end = line.size();
+    while (end > 0 && line[end - 1] == ' ' && !(end > 1 && line[end - 2] == '\\')) --end;
+    line.resize(end);
+    if (line.empty() || line[0] == '#') return false;
+    return parseRule(std::move(line), rule);
+}
+
+void readIgnoreFile(int dir_fd, const char* name, IgnoreLayer& layer) {
+    const int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    std::string text;
+    char buffer[16 << 10];
+    while (text.size() < kMaxIgnoreFileBytes) {
+        const ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        text.append(buffer, static_cast<size_t>(got));
+    }
+    close(fd);
+
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        Rule rule;
+        if (parseIgnoreLine(text.substr(start, end - start), rule)) {
+            layer.globs.add(rule.glob, rule.directory_only);
+            layer.whitelist.push_back(rule.negated);
+        }
+        start = end + 1;
+    }
+}
+
+} // namespace
+
+void PathFilter::addGlob(const std::string& glob) {
+    Rule rule;
+    if (!parseRule(glob, rule)) return;
+    globs.add(rule.glob, rule.directory_only);
+    excludes.push_back(rule.negated);
+    if (!rule.negated) has_includes = true;
+}
+
+std::shared_ptr<const IgnoreLayer> PathFilter::enter(
+    int dir_fd, size_t base, bool has_gitignore, bool has_ignore,
+    const std::shared_ptr<const IgnoreLayer>& parent) const {
+    if (!ignore_files || (!has_gitignore && !has_ignore)) return parent;
+
+    auto layer = std::make_shared<IgnoreLayer>();
+    // Later rules win, so .ignore goes last
+    if (has_gitignore) readIgnoreFile(dir_fd, ".gitignore", *layer);
+    if (has_ignore) readIgnoreFile(dir_fd, ".ignore", *layer);
+    if (layer->globs.empty()) return parent;
+    layer->globs.finish();
+    layer->base = base;
+    layer->parent = parent;
+    return layer;
+}
+
+bool PathFilter::skip(std::string_view path, size_t root_base, bool is_directory,
+                      const IgnoreLayer* layer) const {
+    if (!globs.empty()) {
+        const uint32_t id = globs.match(path.substr(root_base), is_directory);
+        if (id != GlobSet::kNoMatch) return excludes[id];
+        if (has_includes && !is_directory) return true;
+    }
+    for (; layer; layer = layer->parent.get()) {
+        const uint32_t id = layer->globs.match(path.substr(layer->base), is_directory);
+        if (id != GlobSet::kNoMatch) return !layer->whitelist[id];
+    }
+    return false;
+}
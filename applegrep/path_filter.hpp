@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "glob_set.hpp"
+
+// The rules of one directory's .gitignore and .ignore files. Rules of the
+// directories above it are checked only when none of these matches.
+struct IgnoreLayer {
+    GlobSet globs;
+    std::vector<bool> whitelist;  // Per glob: the rule started with '!'
+    size_t base = 0;              // Length of the directory's path plus its '/'
+    std::shared_ptr<const IgnoreLayer> parent;
+};
+
+// Decides which entries a recursive walk skips, from --glob overrides and
+// from the .gitignore and .ignore files found on the way down. The walker
+// checks every entry once, so a skipped directory is never listed.
+//
+// Precedence follows ripgrep: the last matching --glob wins, and a matching
+// include is kept whatever the ignore files say. When there are include
+// globs, files that match none are skipped (directories are still walked).
+// Then the deepest ignore file with a matching rule decides, its last
+// matching rule first; .ignore rules beat .gitignore rules of the same
+// directory. Ignore files above the roots, .git/info/exclude and global
+// excludes are not read.
+class PathFilter {
+public:
+    // A --glob value: `GLOB` includes, `!GLOB` excludes
+    void addGlob(const std::string& glob);
+
+    // Read .gitignore and .ignore files (on by default)
+    void setIgnoreFiles(bool enabled) { ignore_files = enabled; }
+    bool ignoreFiles() const { return ignore_files; }
+
+    // Compile the globs; call after the last addGlob()
+    void finish() { globs.finish(); }
+
+    // The layer for the directory open as dir_fd, whose entries' paths are
+    // `base` bytes longer than their names, given which ignore files its
+    // listing holds. Returns `parent` when there are none.
+    std::shared_ptr<const IgnoreLayer> enter(int dir_fd, size_t base,
+                                             bool has_gitignore, bool has_ignore,
+                                             const std::shared_ptr<const IgnoreLayer>& parent) const;
+
+    // Whether to skip `path`, whose part relative to its walk root starts at
+    // root_base, under the ignore rules of `layer` and its parents
+    bool skip(std::string_view path, size_t root_base, bool is_directory,
+              const IgnoreLayer* layer) const;
+
+    bool active() const { return ignore_files || !globs.empty(); }
+
+private:
+    bool ignore_files = true;
+    GlobSet globs;
+    std::vector<bool> excludes;  // Per glob: it started with '!'
+    bool has_includes = false;
+};
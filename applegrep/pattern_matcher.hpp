@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "match.hpp"
+
+// A compiled set of patterns, literal or regex, searched in a single pass
+// over the text. The CPU backend splits the text into ranges and calls
+// findAll() once per range, possibly from several threads at a time.
+class PatternMatcher {
+public:
+    virtual ~PatternMatcher() = default;
+
+    virtual const char* name() const = 0;
+
+    // Append every match that starts in [from, to) and ends within
+    // text_length, ordered by position, then pattern id
+    virtual void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                         std::vector<Match>& matches) const = 0;
+
+    // Bytes held by the compiled engine, for --stats
+    virtual size_t memoryUsage() const = 0;
+
+    // How often a lazily built automaton dropped its cache for lack of room,
+    // over every findAll() so far, for --stats
+    virtual size_t cacheFlushes() const { return 0; }
+};
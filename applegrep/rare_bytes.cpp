@@ -0,0 +1,75 @@
+#include "rare_bytes.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+const uint8_t kByteFrequencyRank[256] = {
+      0,   1,   2,   3,   4,   5,   6,   7,   8, 200, 241,   9, 127, 163,  10,  11,  // 0x00
+     12,  13,  14,  15,  16,  17,  18,  19,  20,  21,  68,  22,  23,  24,  25,  26,  // 0x10
+    255, 164, 180, 205, 156, 161, 169, 176, 229, 230, 221, 181, 218, 210, 233, 242,  // 0x20
+    225, 215, 211, 196, 194, 204, 193, 188, 192, 201, 209, 198, 189, 185, 190, 154,  // 0x30
+    179, 216, 197, 222, 207, 232, 203, 199, 187, 219, 178, 191, 220, 206, 224, 223,  // 0x40
+    214, 167, 217, 236, 227, 195, 186, 174, 202, 184, 166, 171, 172, 170, 158, 250,  // 0x50
+    168, 247, 234, 245, 240, 254, 235, 231, 237, 251, 173, 228, 244, 238, 249, 248,  // 0x60
+    243, 183, 246, 252, 253, 239, 212, 208, 213, 226, 182, 177, 165, 175, 157,  27,  // 0x70
+    159, 132, 131, 114, 123, 109, 126, 106, 107, 117, 104,  85,  90, 113,  73,  91,  // 0x80
+     94,  93, 119, 103, 140, 105,  81,  79, 135, 142,  83,  98, 146, 144,  74, 118,  // 0x90
+    116, 141, 155, 110, 136, 128, 108, 138, 152, 151,  76, 145,  84, 133,  95,  87,  // 0xa0
+    120, 147, 115, 134, 101, 111, 150, 149, 125,  99, 122, 143, 139, 129, 121,  82,  // 0xb0
+     28,  29, 153, 162, 112, 137,  30,  71,  78,  69,  31,  32,  80,  33,  86,  97,  // 0xc0
+    148, 130,  34,  35,  36,  37,  38,  88,  39,  40,  41,  42,  43,  44,  45,  46,  // 0xd0
+     77, 124, 160,  47, 100, 102,  89,  92,  75,  96,  48,  49,  50,  51,  52,  70,  // 0xe0
+     72,  53,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  // 0xf0
+};
+
+namespace {
+
+// Smaller samples say more about chance than about the input
+constexpr size_t kMinSampleLength = 4096;
+constexpr size_t kMaxSampleLength = 64 * 1024;
+
+} // namespace
+
+RareBytes selectRareBytes(const std::string& pattern,
+                          const char* sample, size_t sample_length, bool fold_case) {
+    // Score every byte value: sample count first, background rank as tiebreak
+    uint64_t score[256];
+    for (int b = 0; b < 256; ++b) score[b] = kByteFrequencyRank[b];
+    if (sample && sample_length >= kMinSampleLength) {
+        uint64_t counts[256] = {};
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(sample);
+        for (size_t i = 0, n = std::min(sample_length, kMaxSampleLength); i < n; ++i) {
+            ++counts[bytes[i]];
+        }
+        for (int b = 0; b < 256; ++b) score[b] += counts[b] << 8;
+    }
+    if (fold_case) {
+        for (int b = 'a'; b <= 'z'; ++b) score[b] += score[b ^ 0x20];
+    }
+
+    auto scoreAt = [&](size_t offset) {
+        return score[static_cast<unsigned char>(pattern[offset])];
+    };
+
+    RareBytes rare{0, 0};
+    for (size_t i = 1; i < pattern.size(); ++i) {
+        if (scoreAt(i) < scoreAt(rare.offset1)) rare.offset1 = i;
+    }
+    if (pattern.size() == 1) return rare;
+
+    // Second anchor: rarest byte at another offset. A different byte value
+    // filters better than a repeat of the first one, and among equals the
+    // farther offset is less correlated with the first.
+    const unsigned char first_byte = pattern[rare.offset1];
+    auto key = [&](size_t offset) {
+        const bool repeat = static_cast<unsigned char>(pattern[offset]) == first_byte;
+        const size_t distance = offset > rare.offset1 ? offset - rare.offset1
+                                                      : rare.offset1 - offset;
+        return std::make_tuple(repeat, scoreAt(offset), pattern.size() - distance);
+    };
+    rare.offset2 = rare.offset1 == 0 ? 1 : 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (i != rare.offset1 && key(i) < key(rare.offset2)) rare.offset2 = i;
+    }
+    return rare;
+}
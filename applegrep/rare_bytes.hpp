@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Background popularity rank of every byte value, 0 = rarest, 255 = most
+// common, measured over a mix of C/C++ headers, documentation and logs.
+extern const uint8_t kByteFrequencyRank[256];
+
+// Pattern offsets whose bytes the vector literal filter compares. Both are
+// < pattern length; they are equal only for one-byte patterns.
+struct RareBytes {
+    size_t offset1;
+    size_t offset2;
+};
+
+// Pick the two rarest pattern bytes so that the prefilter produces as few
+// false candidates as possible. When `sample` (e.g. the first block of the
+// input) is large enough, its byte counts take precedence over the
+// background table. With fold_case (lower-case pattern) a letter is as
+// common as both its cases together.
+RareBytes selectRareBytes(const std::string& pattern,
+                          const char* sample = nullptr, size_t sample_length = 0,
+                          bool fold_case = false);
@@ -0,0 +1,231 @@
+#include "regex_literals.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include "case_fold.hpp"
+
+namespace {
+
+// Sets and strings are kept small: past these limits a set is widened (or
+// dropped) rather than grown, since a prefilter with hundreds of strings or
+// very long ones buys nothing over a short, selective one
+constexpr size_t kMaxSetSize = 64;
+constexpr size_t kMaxClassSize = 16;
+constexpr size_t kMaxLiteralLength = 64;
+
+// A set holding the empty string says nothing: every match "starts with" ""
+using LiteralSet = std::set<std::string>;
+
+const LiteralSet kAnything = {""};
+
+struct Info {
+    bool exact_known = false;
+    LiteralSet exact;     // Every string the node matches
+    LiteralSet prefixes = kAnything;
+    LiteralSet suffixes = kAnything;
+    LiteralSet required = kAnything;
+};
+
+// a x b, or false when the result would be too large
+bool cross(const LiteralSet& a, const LiteralSet& b, LiteralSet& out) {
+    if (a.size() * b.size() > kMaxSetSize) return false;
+    out.clear();
+    for (const std::string& x : a) {
+        for (const std::string& y : b) {
+            if (x.size() + y.size() > kMaxLiteralLength) return false;
+            out.insert(x + y);
+        }
+    }
+    return true;
+}
+
+size_t shortest(const LiteralSet& set) {
+    size_t length = kMaxLiteralLength;
+    for (const std::string& literal : set) length = std::min(length, literal.size());
+    return length;
+}
+
+// Selectivity of a set: long strings are good, many strings are bad. Zero
+// for sets that say nothing.
+int score(const LiteralSet& set) {
+    if (set.empty() || set.count("")) return 0;
+    int value = static_cast<int>(std::min<size_t>(shortest(set), 8)) * 4;
+    for (size_t n = set.size(); n > 1; n = (n + 1) / 2) --value;
+    return value;
+}
+
+// On a tie the longer literals win, they verify fewer false candidates
+const LiteralSet& best(const LiteralSet& a, const LiteralSet& b) {
+    const int score_a = score(a), score_b = score(b);
+    if (score_a != score_b) return score_b > score_a ? b : a;
+    return score_b > 0 && shortest(b) > shortest(a) ? b : a;
+}
+
+Info exactly(LiteralSet set) {
+    Info info;
+    info.exact_known = true;
+    info.exact = set;
+    info.prefixes = set;
+    info.suffixes = set;
+    info.required = std::move(set);
+    return info;
+}
+
+Info concat(const Info& a, const Info& b) {
+    Info info;
+    LiteralSet joined;
+    if (a.exact_known && b.exact_known && cross(a.exact, b.exact, joined)) {
+        info = exactly(std::move(joined));
+        info.required = best(info.required, best(a.required, b.required));
+        return info;
+    }
+
+    // An exact left side extends into the right side's prefixes
+    if (a.exact_known) {
+        info.prefixes = cross(a.exact, b.prefixes, joined) ? joined : a.exact;
+    } else {
+        info.prefixes = a.prefixes;
+    }
+    if (b.exact_known) {
+        info.suffixes = cross(a.suffixes, b.exact, joined) ? joined : b.exact;
+    } else {
+        info.suffixes = b.suffixes;
+    }
+
+    // Inside the concatenation, one side's suffix runs into the other's prefix
+    info.required = best(a.required, b.required);
+    if (cross(a.suffixes, b.prefixes, joined)) info.required = best(info.required, joined);
+    info.required = best(info.required, best(info.prefixes, info.suffixes));
+    return info;
+}
+
+// Union of sets, each of which covers its own branch
+LiteralSet unite(const std::vector<Info>& branches, LiteralSet Info::*member) {
+    LiteralSet all;
+    for (const Info& branch : branches) {
+        const LiteralSet& set = branch.*member;
+        if (set.empty() || set.count("")) return kAnything;
+        all.insert(set.begin(), set.end());
+        if (all.size() > kMaxSetSize) return kAnything;
+    }
+    return all;
+}
+
+Info analyze(const RegexNode& node, bool fold_case) {
+    switch (node.kind) {
+        case RegexNode::Kind::Empty:
+        case RegexNode::Kind::LineStart:
+        case RegexNode::Kind::LineEnd:
+            return exactly(kAnything);
+
+        case RegexNode::Kind::Bytes: {
+            // Folded literals are matched up to ASCII case, so a letter's
+            // two cases are one literal
+            LiteralSet set;
+            for (int c = 0; c < 256; ++c) {
+                if (!node.bytes.test(c)) continue;
+                const unsigned char byte = fold_case ? foldAscii(static_cast<unsigned char>(c)) : c;
+                set.insert(std::string(1, static_cast<char>(byte)));
+            }
+            if (set.size() > kMaxClassSize) return Info();
+            return exactly(std::move(set));
+        }
+
+        case RegexNode::Kind::Concat: {
+            // Join runs of exact pieces first, so that "[0-9] 12:00" keeps
+            // " 12:00" as one literal instead of only ten longer ones
+            std::vector<Info> parts;
+            for (const RegexNode& child : node.children) {
+                Info info = analyze(child, fold_case);
+                if (!parts.empty() && parts.back().exact_known && info.exact_known) {
+                    LiteralSet joined;
+                    if (cross(parts.back().exact, info.exact, joined) &&
+                        score(joined) >= score(parts.back().exact)) {
+                        parts.back() = concat(parts.back(), info);
+                        continue;
+                    }
+                }
+                parts.push_back(std::move(info));
+            }
+
+            Info info = parts[0];
+            for (size_t i = 1; i < parts.size(); ++i) info = concat(info, parts[i]);
+            return info;
+        }
+
+        case RegexNode::Kind::Alternate: {
+            std::vector<Info> branches;
+            bool all_exact = true;
+            for (const RegexNode& child : node.children) {
+                branches.push_back(analyze(child, fold_case));
+                all_exact = all_exact && branches.back().exact_known;
+            }
+            Info info;
+            if (all_exact) {
+                LiteralSet set;
+                for (const Info& branch : branches) set.insert(branch.exact.begin(), branch.exact.end());
+                if (set.size() <= kMaxSetSize) {
+                    info.exact_known = true;
+                    info.exact = std::move(set);
+                }
+            }
+            info.prefixes = unite(branches, &Info::prefixes);
+            info.suffixes = unite(branches, &Info::suffixes);
+            info.required = unite(branches, &Info::required);
+            return info;
+        }
+
+        case RegexNode::Kind::Repeat: {
+            if (node.max == 0) return exactly(kAnything);
+            const Info body = analyze(node.children[0], fold_case);
+            if (node.min == 0) {
+                // x? is x or nothing; longer optional repeats say nothing
+                if (node.max != 1 || !body.exact_known) return Info();
+                LiteralSet set = body.exact;
+                set.insert("");
+                Info info;
+                info.exact_known = set.size() <= kMaxSetSize;
+                info.exact = std::move(set);
+                return info;
+            }
+
+            // x{n,m} is n copies of x and then an optional tail. Copies past
+            // the length limit add nothing, so stop early (and lose exactness).
+            Info info = body;
+            const int copies = std::min(node.min, static_cast<int>(kMaxLiteralLength));
+            for (int i = 1; i < copies; ++i) info = concat(info, body);
+            if (copies < node.min || node.max != node.min) info = concat(info, Info());
+            return info;
+        }
+    }
+    return Info();
+}
+
+std::vector<std::string> toVector(const LiteralSet& set) {
+    if (score(set) == 0) return {};
+    return std::vector<std::string>(set.begin(), set.end());
+}
+
+// Below this score scanning for the literals is not worth it
+constexpr int kMinPrefilterScore = 8;
+
+} // namespace
+
+RegexLiterals extractLiterals(const RegexNode& root, bool fold_case) {
+    const Info info = analyze(root, fold_case);
+    RegexLiterals literals;
+    literals.prefixes = toVector(info.prefixes);
+    literals.suffixes = toVector(info.suffixes);
+    literals.required = toVector(info.required);
+    return literals;
+}
+
+std::vector<std::string> prefilterLiterals(const RegexLiterals& literals) {
+    const LiteralSet prefixes(literals.prefixes.begin(), literals.prefixes.end());
+    const LiteralSet suffixes(literals.suffixes.begin(), literals.suffixes.end());
+    const LiteralSet required(literals.required.begin(), literals.required.end());
+    const LiteralSet& chosen = best(best(prefixes, suffixes), required);
+    if (score(chosen) < kMinPrefilterScore) return {};
+    return std::vector<std::string>(chosen.begin(), chosen.end());
+}
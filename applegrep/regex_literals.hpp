@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "regex_syntax.hpp"
+
+// Literal strings implied by a regex, for prefiltering. Each set is either
+// empty (nothing useful is known) or such that every match of the regex
+// starts with / ends with / contains at least one of its strings.
+struct RegexLiterals {
+    std::vector<std::string> prefixes;
+    std::vector<std::string> suffixes;
+    std::vector<std::string> required;
+};
+
+// With fold_case the strings are lower case and only imply a match up to
+// ASCII case, for a prefilter that folds case too.
+RegexLiterals extractLiterals(const RegexNode& root, bool fold_case);
+
+// The most selective of the three sets, or an empty vector when none is
+// selective enough to be worth scanning for first
+std::vector<std::string> prefilterLiterals(const RegexLiterals& literals);
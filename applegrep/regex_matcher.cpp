@@ -0,0 +1,127 @@
+#include "regex_matcher.hpp"
+
+#include <algorithm>
+
+#include "lazy_dfa.hpp"
+#include "line_ranges.hpp"
+#include "multi_literal_matcher.hpp"
+#include "regex_literals.hpp"
+#include "shift_or.hpp"
+
+namespace {
+
+// Per scanning thread. Past this the DFA cache is dropped and rebuilt, which
+// bounds memory for regexes whose DFA would blow up.
+constexpr size_t kDfaCacheBytes = 8 << 20;
+
+// Candidates are collected this many start positions at a time
+constexpr size_t kPrefilterWindow = 64 << 10;
+
+} // namespace
+
+RegexMatcher::RegexMatcher(Nfa nfa, std::unique_ptr<PatternMatcher> prefilter)
+    : nfa(std::move(nfa)), prefilter(std::move(prefilter)) {
+    engine_name = "lazy-dfa";
+    if (this->prefilter) engine_name += std::string(" + ") + this->prefilter->name() + " prefilter";
+}
+
+void RegexMatcher::findAll(const char* text, size_t text_length, size_t from, size_t to,
+                           std::vector<Match>& matches) const {
+    // Lines starting in [from, to) belong to this range
+    size_t line = firstLineStart(text, text_length, from);
+    if (line >= to || line >= text_length) return;
+
+    LazyDfa dfa(nfa, kDfaCacheBytes);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+
+    if (!prefilter) {
+        while (line < to && line < text_length) {
+            const size_t line_end = lineEnd(text, text_length, line);
+            const uint32_t pattern_id = dfa.matchLine(bytes + line, line_end - line);
+            if (pattern_id != LazyDfa::kNoMatch) matches.push_back({line, pattern_id});
+            line = line_end + 1;
+        }
+        cache_flushes += dfa.flushes();
+        return;
+    }
+
+    // 1. Candidates may start up to the end of the last line that starts in
+    // range (the literals hold no newline, so none spans two lines)
+    const size_t scan_end = lineEnd(text, text_length, to - 1);
+
+    // 2. Run the DFA on each line holding a candidate, once per line. `line`
+    // is the start of the first line not looked at yet.
+    std::vector<Match> candidates;
+    for (size_t window = line; window < scan_end; window += kPrefilterWindow) {
+        candidates.clear();
+        prefilter->findAll(text, text_length, window,
+                           std::min(scan_end, window + kPrefilterWindow), candidates);
+        for (const Match& candidate : candidates) {
+            if (candidate.position < line) continue;
+
+            const size_t line_start = lineStart(text, line, candidate.position);
+            const size_t line_end = lineEnd(text, text_length, candidate.position);
+
+            const uint32_t pattern_id = dfa.matchLine(bytes + line_start, line_end - line_start);
+            if (pattern_id != LazyDfa::kNoMatch) matches.push_back({line_start, pattern_id});
+            line = line_end + 1;
+        }
+    }
+    cache_flushes += dfa.flushes();
+}
+
+size_t RegexMatcher::memoryUsage() const {
+    return nfa.memoryUsage() + (prefilter ? prefilter->memoryUsage() : 0);
+}
+
+std::unique_ptr<PatternMatcher> compileRegexes(const std::vector<std::string>& patterns,
+                                               bool fold_case, std::string& error) {
+    Nfa nfa;
+    std::vector<std::string> literals;
+    bool prefilterable = true;  // Every regex implies a literal so far
+    std::vector<ClassString> class_strings;
+    std::vector<uint32_t> class_string_ids;
+    bool all_class_strings = true;
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        if (patterns[id].empty()) continue;
+
+        RegexNode root;
+        if (!parseRegex(patterns[id], fold_case, root, error)) {
+            error = "invalid regex '" + patterns[id] + "': " + error;
+            return nullptr;
+        }
+        nfa.add(root, static_cast<uint32_t>(id));
+
+        if (prefilterable) {
+            const std::vector<std::string> implied = prefilterLiterals(extractLiterals(root, fold_case));
+            prefilterable = !implied.empty();
+            for (const std::string& literal : implied) {
+                if (literal.find('\n') != std::string::npos) prefilterable = false;
+            }
+            literals.insert(literals.end(), implied.begin(), implied.end());
+        }
+
+        if (all_class_strings) {
+            ClassString classes;
+            all_class_strings = classString(root, classes);
+            class_strings.push_back(std::move(classes));
+            class_string_ids.push_back(static_cast<uint32_t>(id));
+        }
+    }
+    nfa.finish();
+
+    // 1. A selective literal skips most of the text; the DFA only confirms
+    if (prefilterable && !literals.empty()) {
+        std::sort(literals.begin(), literals.end());
+        literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+        return std::make_unique<RegexMatcher>(std::move(nfa), compileLiterals(literals, fold_case));
+    }
+
+    // 2. Short fixed-length patterns step bit-parallel, with no table misses
+    if (all_class_strings && ShiftOrMatcher::fits(class_strings)) {
+        return std::make_unique<ShiftOrMatcher>(class_strings, class_string_ids);
+    }
+
+    // 3. Anything else walks the lazy DFA over every line
+    return std::make_unique<RegexMatcher>(std::move(nfa), nullptr);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nfa.hpp"
+#include "pattern_matcher.hpp"
+
+// grep -E: the text is searched line by line and each line that matches
+// (any of) the regexes is reported once, at the position where the line
+// starts, with the id of the first pattern that matched in it.
+//
+// When every regex implies some literal (see regex_literals.hpp), the
+// literal engine scans for those first and the DFA only runs on lines that
+// contain a candidate.
+class RegexMatcher : public PatternMatcher {
+public:
+    RegexMatcher(Nfa nfa, std::unique_ptr<PatternMatcher> prefilter);
+
+    const char* name() const override { return engine_name.c_str(); }
+
+    void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                 std::vector<Match>& matches) const override;
+
+    size_t memoryUsage() const override;
+
+    size_t cacheFlushes() const override { return cache_flushes; }
+
+private:
+    Nfa nfa;
+    std::unique_ptr<PatternMatcher> prefilter;  // May be null
+    std::string engine_name;
+    mutable std::atomic<size_t> cache_flushes{0};  // Summed over each findAll()'s DFA
+};
+
+// Parse and compile a set of extended regexes. Empty patterns are kept (so
+// ids stay aligned with the input) but never match, as for literals. Returns
+// nullptr and fills `error` when a pattern does not parse. fold_case is -i.
+std::unique_ptr<PatternMatcher> compileRegexes(const std::vector<std::string>& patterns,
+                                               bool fold_case, std::string& error);
@@ -0,0 +1,366 @@
+#include "regex_syntax.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "case_fold.hpp"
+
+namespace {
+
+// Deeper group nesting is rejected rather than risking the stack
+constexpr int kMaxNesting = 250;
+
+// Give every ASCII letter in the set its other case too
+void foldLetters(std::bitset<256>& bytes) {
+    for (int c = 'a'; c <= 'z'; ++c) {
+        if (bytes.test(c) || bytes.test(c ^ 0x20)) {
+            bytes.set(c);
+            bytes.set(c ^ 0x20);
+        }
+    }
+}
+
+std::bitset<256> byteSet(unsigned char c) {
+    std::bitset<256> set;
+    set.set(c);
+    return set;
+}
+
+// [:name:] classes in the C locale
+bool namedClass(const std::string& name, std::bitset<256>& set) {
+    int (*test)(int) = nullptr;
+    if (name == "alpha") test = isalpha;
+    else if (name == "digit") test = isdigit;
+    else if (name == "alnum") test = isalnum;
+    else if (name == "upper") test = isupper;
+    else if (name == "lower") test = islower;
+    else if (name == "space") test = isspace;
+    else if (name == "blank") test = isblank;
+    else if (name == "punct") test = ispunct;
+    else if (name == "print") test = isprint;
+    else if (name == "graph") test = isgraph;
+    else if (name == "cntrl") test = iscntrl;
+    else if (name == "xdigit") test = isxdigit;
+    else return false;
+
+    for (int c = 0; c < 128; ++c) {
+        if (test(c)) set.set(c);
+    }
+    return true;
+}
+
+class Parser {
+public:
+    Parser(const std::string& pattern, bool fold_case, std::string& error)
+        : pattern(pattern), fold_case(fold_case), error(error) {}
+
+    bool parse(RegexNode& root) { return parseAlternation(root, 0); }
+
+private:
+    bool fail(const std::string& message) {
+        error = message + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    bool atEnd() const { return pos >= pattern.size(); }
+    unsigned char peek() const { return pattern[pos]; }
+
+    bool parseAlternation(RegexNode& node, int depth) {
+        if (depth > kMaxNesting) return fail("groups nested too deeply");
+
+        std::vector<RegexNode> branches(1);
+        if (!parseConcat(branches.back(), depth)) return false;
+        while (!atEnd() && peek() == '|') {
+            ++pos;
+            branches.emplace_back();
+            if (!parseConcat(branches.back(), depth)) return false;
+        }
+
+        if (branches.size() == 1) {
+            node = std::move(branches.front());
+        } else {
+            node.kind = RegexNode::Kind::Alternate;
+            node.children = std::move(branches);
+        }
+        return true;
+    }
+
+    bool parseConcat(RegexNode& node, int depth) {
+        std::vector<RegexNode> items;
+        while (!atEnd()) {
+            const unsigned char c = peek();
+            // An unmatched ')' at the top level is an ordinary character
+            if (c == '|' || (c == ')' && depth > 0)) break;
+
+            RegexNode atom;
+            if (!parseAtom(atom, depth)) return false;
+            if (!parseRepeats(atom)) return false;
+            items.push_back(std::move(atom));
+        }
+
+        if (items.empty()) {
+            node.kind = RegexNode::Kind::Empty;
+        } else if (items.size() == 1) {
+            node = std::move(items.front());
+        } else {
+            node.kind = RegexNode::Kind::Concat;
+            node.children = std::move(items);
+        }
+        return true;
+    }
+
+    bool parseAtom(RegexNode& atom, int depth) {
+        const unsigned char c = peek();
+        ++pos;
+        switch (c) {
+            case '(':
+                if (!parseAlternation(atom, depth + 1)) return false;
+                if (atEnd() || peek() != ')') return fail("missing )");
+                ++pos;
+                return true;
+            case '[':
+                return parseBracket(atom);
+            case '.':
+                atom.kind = RegexNode::Kind::Bytes;
+                atom.bytes.set();
+                atom.bytes.reset('\n');
+                return true;
+            case '^':
+                atom.kind = RegexNode::Kind::LineStart;
+                return true;
+            case '$':
+                atom.kind = RegexNode::Kind::LineEnd;
+                return true;
+            case '\\':
+                return parseEscape(atom);
+            default:
+                // Includes * + ? with nothing to repeat and a '{' that does
+                // not start a bound, which GNU grep -E also takes literally
+                break;
+        }
+        if (fold_case && c >= 0x80) return parseFoldedCharacter(atom);
+        atom.kind = RegexNode::Kind::Bytes;
+        atom.bytes = byteSet(c);
+        if (fold_case) foldLetters(atom.bytes);
+        return true;
+    }
+
+    // The UTF-8 character starting at pos - 1, as an alternation of the
+    // encodings of its case folding orbit. Invalid bytes stand for themselves.
+    bool parseFoldedCharacter(RegexNode& atom) {
+        const size_t start = pos - 1;
+        uint32_t code_point;
+        pos = start + decodeUtf8(reinterpret_cast<const unsigned char*>(pattern.data()) + start,
+                                 pattern.size() - start, code_point);
+
+        uint32_t member = code_point;
+        do {
+            std::string encoded;
+            appendUtf8(member, encoded);
+            RegexNode sequence;
+            for (unsigned char b : encoded) {
+                RegexNode byte;
+                byte.kind = RegexNode::Kind::Bytes;
+                byte.bytes = byteSet(b);
+                sequence.children.push_back(std::move(byte));
+            }
+            if (sequence.children.size() == 1) {
+                atom.children.push_back(std::move(sequence.children.front()));
+            } else {
+                sequence.kind = RegexNode::Kind::Concat;
+                atom.children.push_back(std::move(sequence));
+            }
+        } while ((member = simpleFold(member)) != code_point);
+
+        if (atom.children.size() == 1) {
+            RegexNode only = std::move(atom.children.front());
+            atom = std::move(only);
+        } else {
+            atom.kind = RegexNode::Kind::Alternate;
+        }
+        return true;
+    }
+
+    bool parseEscape(RegexNode& atom) {
+        if (atEnd()) return fail("trailing backslash");
+        const unsigned char c = peek();
+        ++pos;
+
+        atom.kind = RegexNode::Kind::Bytes;
+        switch (c) {
+            case 'd': case 'D':
+                namedClass("digit", atom.bytes);
+                break;
+            case 'w': case 'W':
+                namedClass("alnum", atom.bytes);
+                atom.bytes.set('_');
+                break;
+            case 's': case 'S':
+                namedClass("space", atom.bytes);
+                break;
+            case 'b': case 'B': case '<': case '>': case '`': case '\'':
+                return fail(std::string("unsupported escape \\") + static_cast<char>(c));
+            default:
+                if (c >= '1' && c <= '9') return fail("backreferences are not supported");
+                atom.bytes = byteSet(c);
+                if (fold_case) foldLetters(atom.bytes);
+                return true;
+        }
+        if (isupper(c)) {
+            atom.bytes.flip();
+            atom.bytes.reset('\n');
+        }
+        return true;
+    }
+
+    bool parseBracket(RegexNode& atom) {
+        atom.kind = RegexNode::Kind::Bytes;
+        bool negate = false;
+        if (!atEnd() && peek() == '^') {
+            negate = true;
+            ++pos;
+        }
+
+        // A ']' right after the opening bracket is a member
+        bool first = true;
+        for (;;) {
+            if (atEnd()) return fail("missing ]");
+            const unsigned char c = peek();
+            if (c == ']' && !first) {
+                ++pos;
+                break;
+            }
+            first = false;
+
+            const char next = pos + 1 < pattern.size() ? pattern[pos + 1] : '\0';
+            if (c == '[' && (next == ':' || next == '.' || next == '=')) {
+                if (next != ':') return fail("collating elements are not supported");
+                const size_t close = pattern.find(":]", pos + 2);
+                if (close == std::string::npos) return fail("missing :]");
+                const std::string name = pattern.substr(pos + 2, close - pos - 2);
+                if (!namedClass(name, atom.bytes)) return fail("unknown class [:" + name + ":]");
+                pos = close + 2;
+                continue;
+            }
+
+            ++pos;
+            unsigned char high = c;
+            if (pos + 1 < pattern.size() && peek() == '-' && pattern[pos + 1] != ']') {
+                high = pattern[pos + 1];
+                if (high < c) return fail("invalid range");
+                pos += 2;
+            }
+            for (int b = c; b <= high; ++b) atom.bytes.set(b);
+        }
+
+        // Fold before negating: with -i, [^a] excludes 'A' too
+        if (fold_case) foldLetters(atom.bytes);
+        if (negate) {
+            atom.bytes.flip();
+            atom.bytes.reset('\n');
+        }
+        return true;
+    }
+
+    // Parse "{n}", "{n,}" or "{n,m}" at pos. Anything else leaves pos
+    // untouched and returns false, and the '{' is taken literally.
+    bool parseBound(int& min, int& max) {
+        size_t at = pos + 1;
+        auto number = [&](int& value) {
+            const size_t start = at;
+            long parsed = 0;
+            while (at < pattern.size() && isdigit(static_cast<unsigned char>(pattern[at]))) {
+                parsed = std::min<long>(parsed * 10 + (pattern[at] - '0'), kRegexMaxRepeat + 1L);
+                ++at;
+            }
+            value = static_cast<int>(parsed);
+            return at > start;
+        };
+
+        if (!number(min)) return false;
+        max = min;
+        if (at < pattern.size() && pattern[at] == ',') {
+            ++at;
+            if (!number(max)) max = -1;
+        }
+        if (at >= pattern.size() || pattern[at] != '}') return false;
+        pos = at + 1;
+        return true;
+    }
+
+    bool parseRepeats(RegexNode& atom) {
+        while (!atEnd()) {
+            int min, max;
+            const unsigned char c = peek();
+            if (c == '*') {
+                min = 0, max = -1;
+            } else if (c == '+') {
+                min = 1, max = -1;
+            } else if (c == '?') {
+                min = 0, max = 1;
+            } else if (c == '{') {
+                if (!parseBound(min, max)) return true;
+                if (min > kRegexMaxRepeat || max > kRegexMaxRepeat) {
+                    return fail("repetition count too large");
+                }
+                if (max >= 0 && max < min) return fail("invalid repetition bounds");
+            } else {
+                return true;
+            }
+            if (c != '{') ++pos;
+
+            RegexNode repeat;
+            repeat.kind = RegexNode::Kind::Repeat;
+            repeat.min = min;
+            repeat.max = max;
+            repeat.children.push_back(std::move(atom));
+            atom = std::move(repeat);
+        }
+        return true;
+    }
+
+    const std::string& pattern;
+    const bool fold_case;
+    std::string& error;
+    size_t pos = 0;
+};
+
+// NFA states the node compiles to (see nfa.cpp), saturating at kLimit
+size_t stateCount(const RegexNode& node) {
+    const size_t kLimit = kRegexMaxStates + 1;
+    auto add = [&](size_t a, size_t b) { return std::min(a + b, kLimit); };
+
+    switch (node.kind) {
+        case RegexNode::Kind::Empty:
+            return 0;
+        case RegexNode::Kind::Bytes:
+        case RegexNode::Kind::LineStart:
+        case RegexNode::Kind::LineEnd:
+            return 1;
+        case RegexNode::Kind::Concat:
+        case RegexNode::Kind::Alternate: {
+            size_t count = node.kind == RegexNode::Kind::Alternate ? node.children.size() - 1 : 0;
+            for (const RegexNode& child : node.children) count = add(count, stateCount(child));
+            return count;
+        }
+        case RegexNode::Kind::Repeat: {
+            const size_t body = stateCount(node.children[0]);
+            const size_t copies = node.max < 0 ? node.min + 1 : node.max;
+            const size_t splits = node.max < 0 ? 1 : node.max - node.min;
+            return add(std::min(body * copies, kLimit), splits);
+        }
+    }
+    return kLimit;
+}
+
+} // namespace
+
+bool parseRegex(const std::string& pattern, bool fold_case, RegexNode& root, std::string& error) {
+    root = RegexNode();
+    if (!Parser(pattern, fold_case, error).parse(root)) return false;
+    if (stateCount(root) > kRegexMaxStates) {
+        error = "regex too large";
+        return false;
+    }
+    return true;
+}
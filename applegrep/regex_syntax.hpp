@@ -0,0 +1,41 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Parsed form of a POSIX extended regular expression. Patterns and text are
+// treated as bytes, as grep does in the C locale.
+struct RegexNode {
+    enum class Kind {
+        Empty,      // Matches the empty string
+        Bytes,      // One byte out of `bytes`
+        Concat,     // children in sequence
+        Alternate,  // Any one of children
+        Repeat,     // children[0], min to max times (max < 0: unbounded)
+        LineStart,  // ^
+        LineEnd,    // $
+    };
+
+    Kind kind = Kind::Empty;
+    std::bitset<256> bytes;
+    std::vector<RegexNode> children;
+    int min = 0;
+    int max = 0;
+};
+
+// Counted repetition bounds above this are rejected, since every copy costs
+// NFA states; so are regexes that would compile to more than kRegexMaxStates
+constexpr int kRegexMaxRepeat = 1000;
+constexpr size_t kRegexMaxStates = 1 << 20;
+
+// Parse `pattern`. Supports alternation, grouping, * + ? and {n,m}
+// repetition, bracket expressions with ranges and [:class:] names, '.', the
+// ^ and $ anchors, and the \d \w \s (and negated) shorthands. Returns false
+// and fills `error` on a syntax error.
+//
+// With fold_case (-i) every byte set also holds the other case of its ASCII
+// letters, and a UTF-8 character outside brackets matches its whole simple
+// case folding orbit (see case_fold.hpp).
+bool parseRegex(const std::string& pattern, bool fold_case, RegexNode& root, std::string& error);
@@ -0,0 +1,118 @@
+#include "scan_kernels.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// ---- newline counters ----
+
+size_t countNewlinesScalar(const char* text, size_t length) {
+    size_t count = 0;
+    const char* end = text + length;
+    while (const void* hit = memchr(text, '\n', end - text)) {
+        ++count;
+        text = static_cast<const char*>(hit) + 1;
+    }
+    return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.2,popcnt")))
+size_t countNewlinesSse42(const char* text, size_t length) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0, i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+        count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+    }
+    return count + countNewlinesScalar(text + i, length - i);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t countNewlinesAvx2(const char* text, size_t length) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0, i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+        count += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+    }
+    return count + countNewlinesSse42(text + i, length - i);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+size_t countNewlinesAvx512(const char* text, size_t length) {
+    const __m512i newline = _mm512_set1_epi8('\n');
+    size_t count = 0, i = 0;
+    for (; i + 64 <= length; i += 64) {
+        const __m512i block = _mm512_loadu_si512(text + i);
+        count += _mm_popcnt_u64(_mm512_cmpeq_epi8_mask(block, newline));
+    }
+    return count + countNewlinesSse42(text + i, length - i);
+}
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+size_t countNewlinesNeon(const char* text, size_t length) {
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text);
+    size_t count = 0, i = 0;
+    for (; i + 16 <= length; i += 16) {
+        // Matching lanes are 0xff; shift to 1 and sum across the vector
+        const uint8x16_t eq = vceqq_u8(vld1q_u8(bytes + i), newline);
+        count += vaddvq_u8(vshrq_n_u8(eq, 7));
+    }
+    return count + countNewlinesScalar(text + i, length - i);
+}
+
+#endif
+
+ScanKernels kernelsForTier(CpuTier tier) {
+    switch (tier) {
+#if defined(__x86_64__) || defined(__i386__)
+        case CpuTier::Avx512:
+            // Four Shift-Or lanes fill a 256-bit register; AVX-512 has nothing to add
+            return {tier, findLiteralAvx512, findLiteralFoldAvx512, &kFixedLiteralAvx512,
+                    countNewlinesAvx512, findTeddyAvx512,
+                    findShiftOrAvx2};
+        case CpuTier::Avx2:
+            return {tier, findLiteralAvx2, findLiteralFoldAvx2, &kFixedLiteralAvx2,
+                    countNewlinesAvx2, findTeddyAvx2,
+                    findShiftOrAvx2};
+        case CpuTier::Sse42:
+            return {tier, findLiteralSse2, findLiteralFoldSse2, &kFixedLiteralSse2,
+                    countNewlinesSse42, findTeddySsse3,
+                    findShiftOrSse2};
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+        case CpuTier::Neon:
+            return {tier, findLiteralNeon, findLiteralFoldNeon, &kFixedLiteralNeon,
+                    countNewlinesNeon, findTeddyNeon,
+                    findShiftOrNeon};
+#endif
+        default:
+            return {CpuTier::Scalar, findLiteralScalar, findLiteralFoldScalar, &kFixedLiteralScalar,
+                    countNewlinesScalar, findTeddyScalar, findShiftOrScalar};
+    }
+}
+
+std::once_flag kernels_once;
+ScanKernels active_kernels;
+
+} // namespace
+
+void selectScanKernels(CpuTier tier) {
+    std::call_once(kernels_once, [tier] { active_kernels = kernelsForTier(tier); });
+}
+
+const ScanKernels& scanKernels() {
+    std::call_once(kernels_once, [] { active_kernels = kernelsForTier(detectCpuTier()); });
+    return active_kernels;
+}
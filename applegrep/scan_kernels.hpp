@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+#include "cpu_features.hpp"
+#include "literal_scan.hpp"
+#include "shift_or.hpp"
+#include "teddy.hpp"
+
+// Number of '\n' bytes in text[0, length)
+using CountNewlinesFn = size_t (*)(const char* text, size_t length);
+
+// Hot scan kernels, resolved once per process for one CPU tier
+struct ScanKernels {
+    CpuTier tier;
+    FindLiteralFn find_literal;
+    FindLiteralFn find_literal_fold;  // -i: needle already lower case
+    const FixedLiteralKernels* find_literal_fixed;  // Both of the above, by needle length
+    CountNewlinesFn count_newlines;
+    FindTeddyFn find_teddy;
+    FindShiftOrFn find_shift_or;
+};
+
+// Pin the table to `tier` (the --cpu-features override). Must be called
+// before the first scanKernels() call; later calls are ignored.
+void selectScanKernels(CpuTier tier);
+
+// The active table. Resolves to detectCpuTier() unless overridden.
+const ScanKernels& scanKernels();
@@ -0,0 +1,19 @@
+#include "search_backend.hpp"
+
+std::unique_ptr<SearchBackend> createBackend(const std::string& backend_name,
+                                             std::string& error) {
+    if (backend_name == "cpu") {
+        return createCpuBackend();
+    }
+    if (backend_name == "metal") {
+        std::unique_ptr<SearchBackend> backend = createMetalBackend();
+        if (!backend) error = "no Metal device available";
+        return backend;
+    }
+    if (backend_name == "auto") {
+        std::unique_ptr<SearchBackend> backend = createMetalBackend();
+        return backend ? std::move(backend) : createCpuBackend();
+    }
+    error = "unknown backend '" + backend_name + "' (expected cpu, metal or auto)";
+    return nullptr;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "match.hpp"
+
+// How the patterns given to compile() are interpreted
+struct SearchOptions {
+    bool extended_regex = false;  // -E: POSIX extended regexes, matched per line
+    uint32_t max_errors = 0;      // --max-errors: approximate search for one literal
+    bool ignore_case = false;     // -i: letters match either case (see case_fold.hpp)
+};
+
+// What the compiled patterns and the last search() cost, for --stats
+struct SearchStats {
+    std::string engine;          // Engine that scans the text
+    double compile_seconds = 0;  // Building the matcher
+    size_t engine_bytes = 0;     // Memory held by the compiled matcher
+    double scan_seconds = 0;     // Scanning the text
+    size_t cache_flushes = 0;    // Lazy DFA cache rebuilds, over every search so far
+};
+
+// Every search engine implements the same contract as the original
+// grep_kernel: given the text and the patterns, report where each pattern
+// starts. Matches are returned ordered by position, then pattern id. Empty
+// patterns never match. With extended_regex, each matching line is reported
+// once, at its start. With max_errors, matches report where they end and how
+// many edits they needed (see ApproximateMatcher).
+class SearchBackend {
+public:
+    virtual ~SearchBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    // Prepare the patterns for search(). Returns false and fills `error`
+    // when a pattern is invalid or the options are not supported.
+    virtual bool compile(const std::vector<std::string>& patterns, const SearchOptions& options,
+                         std::string& error) = 0;
+
+    virtual std::vector<Match> search(const char* text, size_t text_length) = 0;
+
+    // Whether search() may run on several threads at once, one input each.
+    // stats() then describes whichever search finished last.
+    virtual bool concurrentSearch() const { return false; }
+
+    const SearchStats& stats() const { return last_stats; }
+
+protected:
+    SearchStats last_stats;
+};
+
+// Native multi-core engine, available everywhere.
+std::unique_ptr<SearchBackend> createCpuBackend();
+
+// Metal engine. Returns nullptr when the platform has no Metal device.
+std::unique_ptr<SearchBackend> createMetalBackend();
+
+// Resolve a --backend value ("cpu", "metal" or "auto"). "auto" prefers Metal
+// and falls back to the CPU engine. Returns nullptr and fills `error` when the
+// requested backend is unknown or unavailable.
+std::unique_ptr<SearchBackend> createBackend(const std::string& backend_name,
+                                             std::string& error);
@@ -0,0 +1,391 @@
+#include "shift_or.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include "line_ranges.hpp"
+#include "literal_scan.hpp"
+#include "scan_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Kernels test for a pattern end once per block and replay a block that
+// had one byte by byte, which keeps the branch out of the per-byte chain.
+// Inside a block they take two bytes a step,
+//
+//     d2 = ((d << 2) & ~(starts | starts << 1)) | ((m1 << 1) & ~starts) | m2
+//
+// so the dependency on the previous state is three operations per two
+// bytes; the state after the first byte is only needed for the end test.
+constexpr size_t kBlock = 8;
+
+template <size_t kLanes>
+size_t shiftOrScalar(const ShiftOrTables& tables, const char* text,
+                     size_t from, size_t limit, uint64_t* state) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    uint64_t d[kLanes], keep[kLanes], keep2[kLanes], ends[kLanes], saved[kLanes];
+    for (size_t l = 0; l < kLanes; ++l) {
+        d[l] = state[l];
+        keep[l] = ~tables.starts[l];
+        keep2[l] = ~(tables.starts[l] | tables.starts[l] << 1);
+        ends[l] = tables.ends[l];
+    }
+
+    size_t pos = from;
+    for (; pos + kBlock <= limit; pos += kBlock) {
+        std::copy(d, d + kLanes, saved);
+        uint64_t hits = 0;
+        for (size_t k = 0; k < kBlock; k += 2) {
+            const uint64_t* m1 = tables.masks[bytes[pos + k]];
+            const uint64_t* m2 = tables.masks[bytes[pos + k + 1]];
+            for (size_t l = 0; l < kLanes; ++l) {
+                const uint64_t d1 = ((d[l] << 1) & keep[l]) | m1[l];
+                d[l] = ((d[l] << 2) & keep2[l]) | ((m1[l] << 1) & keep[l]) | m2[l];
+                hits |= ~(d1 & d[l]) & ends[l];
+            }
+        }
+        if (hits) {
+            std::copy(saved, saved + kLanes, d);
+            break;
+        }
+    }
+    for (; pos < limit; ++pos) {
+        const uint64_t* masks = tables.masks[bytes[pos]];
+        uint64_t hits = 0;
+        for (size_t l = 0; l < kLanes; ++l) {
+            d[l] = ((d[l] << 1) & keep[l]) | masks[l];
+            hits |= ~d[l] & ends[l];
+        }
+        if (hits) break;
+    }
+    std::copy(d, d + kLanes, state);
+    return pos < limit ? pos : kNoMatch;
+}
+
+} // namespace
+
+size_t findShiftOrScalar(const ShiftOrTables& tables, const char* text,
+                         size_t from, size_t limit, uint64_t* state) {
+    switch (tables.lane_count) {
+        case 1: return shiftOrScalar<1>(tables, text, from, limit, state);
+        case 2: return shiftOrScalar<2>(tables, text, from, limit, state);
+        default: return shiftOrScalar<kShiftOrLanes>(tables, text, from, limit, state);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace {
+
+// Two lanes per register; lanes 2 and 3 only when they are in use
+template <size_t kRegisters>
+__attribute__((target("sse2")))
+size_t shiftOrSse2(const ShiftOrTables& tables, const char* text,
+                   size_t from, size_t limit, uint64_t* state) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i d[kRegisters], starts[kRegisters], starts2[kRegisters], ends[kRegisters], saved[kRegisters];
+    for (size_t r = 0; r < kRegisters; ++r) {
+        d[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 2 * r));
+        starts[r] = _mm_load_si128(reinterpret_cast<const __m128i*>(tables.starts + 2 * r));
+        starts2[r] = _mm_or_si128(starts[r], _mm_slli_epi64(starts[r], 1));
+        ends[r] = _mm_load_si128(reinterpret_cast<const __m128i*>(tables.ends + 2 * r));
+    }
+
+    size_t pos = from;
+    bool found = false;
+    for (; pos + kBlock <= limit; pos += kBlock) {
+        std::copy(d, d + kRegisters, saved);
+        __m128i hits = zero;
+        for (size_t k = 0; k < kBlock; k += 2) {
+            const uint64_t* masks1 = tables.masks[bytes[pos + k]];
+            const uint64_t* masks2 = tables.masks[bytes[pos + k + 1]];
+            for (size_t r = 0; r < kRegisters; ++r) {
+                const __m128i m1 = _mm_load_si128(reinterpret_cast<const __m128i*>(masks1 + 2 * r));
+                const __m128i m2 = _mm_load_si128(reinterpret_cast<const __m128i*>(masks2 + 2 * r));
+                const __m128i d1 = _mm_or_si128(_mm_andnot_si128(starts[r], _mm_slli_epi64(d[r], 1)), m1);
+                const __m128i tail = _mm_or_si128(_mm_andnot_si128(starts[r], _mm_slli_epi64(m1, 1)), m2);
+                d[r] = _mm_or_si128(_mm_andnot_si128(starts2[r], _mm_slli_epi64(d[r], 2)), tail);
+                hits = _mm_or_si128(hits, _mm_andnot_si128(_mm_and_si128(d1, d[r]), ends[r]));
+            }
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(hits, zero)) != 0xffff) {
+            std::copy(saved, saved + kRegisters, d);
+            break;
+        }
+    }
+    for (; pos < limit && !found; ++pos) {
+        const uint64_t* masks = tables.masks[bytes[pos]];
+        __m128i hits = zero;
+        for (size_t r = 0; r < kRegisters; ++r) {
+            const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(masks + 2 * r));
+            d[r] = _mm_or_si128(_mm_andnot_si128(starts[r], _mm_slli_epi64(d[r], 1)), mask);
+            hits = _mm_or_si128(hits, _mm_andnot_si128(d[r], ends[r]));
+        }
+        found = _mm_movemask_epi8(_mm_cmpeq_epi8(hits, zero)) != 0xffff;
+    }
+    for (size_t r = 0; r < kRegisters; ++r) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 2 * r), d[r]);
+    }
+    return found ? pos - 1 : kNoMatch;
+}
+
+} // namespace
+
+size_t findShiftOrSse2(const ShiftOrTables& tables, const char* text,
+                       size_t from, size_t limit, uint64_t* state) {
+    if (tables.lane_count <= 2) return shiftOrSse2<1>(tables, text, from, limit, state);
+    return shiftOrSse2<2>(tables, text, from, limit, state);
+}
+
+// All four lanes in one register
+__attribute__((target("avx2")))
+size_t findShiftOrAvx2(const ShiftOrTables& tables, const char* text,
+                       size_t from, size_t limit, uint64_t* state) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    const __m256i starts = _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.starts));
+    const __m256i ends = _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.ends));
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state));
+
+    const __m256i starts2 = _mm256_or_si256(starts, _mm256_slli_epi64(starts, 1));
+    size_t pos = from;
+    for (; pos + kBlock <= limit; pos += kBlock) {
+        const __m256i saved = d;
+        __m256i hits = _mm256_setzero_si256();
+        for (size_t k = 0; k < kBlock; k += 2) {
+            const __m256i m1 =
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.masks[bytes[pos + k]]));
+            const __m256i m2 =
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.masks[bytes[pos + k + 1]]));
+            const __m256i d1 = _mm256_or_si256(_mm256_andnot_si256(starts, _mm256_slli_epi64(d, 1)), m1);
+            const __m256i tail = _mm256_or_si256(_mm256_andnot_si256(starts, _mm256_slli_epi64(m1, 1)), m2);
+            d = _mm256_or_si256(_mm256_andnot_si256(starts2, _mm256_slli_epi64(d, 2)), tail);
+            hits = _mm256_or_si256(hits, _mm256_andnot_si256(_mm256_and_si256(d1, d), ends));
+        }
+        if (!_mm256_testz_si256(hits, hits)) {
+            d = saved;
+            break;
+        }
+    }
+    bool found = false;
+    for (; pos < limit && !found; ++pos) {
+        const __m256i mask =
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.masks[bytes[pos]]));
+        d = _mm256_or_si256(_mm256_andnot_si256(starts, _mm256_slli_epi64(d, 1)), mask);
+        // testc is 1 when every end bit is set in d, i.e. nothing ended
+        found = !_mm256_testc_si256(d, ends);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state), d);
+    return found ? pos - 1 : kNoMatch;
+}
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+namespace {
+
+template <size_t kRegisters>
+size_t shiftOrNeon(const ShiftOrTables& tables, const char* text,
+                   size_t from, size_t limit, uint64_t* state) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    uint64x2_t d[kRegisters], starts[kRegisters], starts2[kRegisters], ends[kRegisters], saved[kRegisters];
+    for (size_t r = 0; r < kRegisters; ++r) {
+        d[r] = vld1q_u64(state + 2 * r);
+        starts[r] = vld1q_u64(tables.starts + 2 * r);
+        starts2[r] = vorrq_u64(starts[r], vshlq_n_u64(starts[r], 1));
+        ends[r] = vld1q_u64(tables.ends + 2 * r);
+    }
+    auto any = [](uint64x2_t v) { return vmaxvq_u32(vreinterpretq_u32_u64(v)) != 0; };
+
+    size_t pos = from;
+    for (; pos + kBlock <= limit; pos += kBlock) {
+        std::copy(d, d + kRegisters, saved);
+        uint64x2_t hits = vdupq_n_u64(0);
+        for (size_t k = 0; k < kBlock; k += 2) {
+            const uint64_t* masks1 = tables.masks[bytes[pos + k]];
+            const uint64_t* masks2 = tables.masks[bytes[pos + k + 1]];
+            for (size_t r = 0; r < kRegisters; ++r) {
+                const uint64x2_t m1 = vld1q_u64(masks1 + 2 * r);
+                const uint64x2_t d1 = vorrq_u64(vbicq_u64(vshlq_n_u64(d[r], 1), starts[r]), m1);
+                const uint64x2_t tail =
+                    vorrq_u64(vbicq_u64(vshlq_n_u64(m1, 1), starts[r]), vld1q_u64(masks2 + 2 * r));
+                d[r] = vorrq_u64(vbicq_u64(vshlq_n_u64(d[r], 2), starts2[r]), tail);
+                hits = vorrq_u64(hits, vbicq_u64(ends[r], vandq_u64(d1, d[r])));
+            }
+        }
+        if (any(hits)) {
+            std::copy(saved, saved + kRegisters, d);
+            break;
+        }
+    }
+    bool found = false;
+    for (; pos < limit && !found; ++pos) {
+        const uint64_t* masks = tables.masks[bytes[pos]];
+        uint64x2_t hits = vdupq_n_u64(0);
+        for (size_t r = 0; r < kRegisters; ++r) {
+            d[r] = vorrq_u64(vbicq_u64(vshlq_n_u64(d[r], 1), starts[r]), vld1q_u64(masks + 2 * r));
+            hits = vorrq_u64(hits, vbicq_u64(ends[r], d[r]));
+        }
+        found = any(hits);
+    }
+    for (size_t r = 0; r < kRegisters; ++r) vst1q_u64(state + 2 * r, d[r]);
+    return found ? pos - 1 : kNoMatch;
+}
+
+} // namespace
+
+size_t findShiftOrNeon(const ShiftOrTables& tables, const char* text,
+                       size_t from, size_t limit, uint64_t* state) {
+    if (tables.lane_count <= 2) return shiftOrNeon<1>(tables, text, from, limit, state);
+    return shiftOrNeon<2>(tables, text, from, limit, state);
+}
+
+#endif
+
+namespace {
+
+bool appendClasses(const RegexNode& node, ClassString& classes) {
+    switch (node.kind) {
+        case RegexNode::Kind::Empty:
+            return true;
+
+        case RegexNode::Kind::Bytes:
+            // Matches never span lines, so a newline in a class is dead
+            classes.push_back(node.bytes);
+            classes.back().reset('\n');
+            return classes.size() <= kShiftOrMaxLength;
+
+        case RegexNode::Kind::Concat:
+            for (const RegexNode& child : node.children) {
+                if (!appendClasses(child, classes)) return false;
+            }
+            return true;
+
+        case RegexNode::Kind::Repeat: {
+            if (node.min != node.max) return false;
+            const size_t before = classes.size();
+            if (!appendClasses(node.children[0], classes)) return false;
+            if (node.min == 0) {
+                classes.resize(before);
+                return true;
+            }
+            const ClassString body(classes.begin() + before, classes.end());
+            for (int i = 1; i < node.min; ++i) {
+                if (classes.size() + body.size() > kShiftOrMaxLength) return false;
+                classes.insert(classes.end(), body.begin(), body.end());
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+// First-fit decreasing: lane and bit offset of each pattern, or false when
+// they do not fit
+bool pack(const std::vector<ClassString>& patterns, std::vector<size_t>& lanes,
+          std::vector<unsigned>& offsets) {
+    std::vector<size_t> order(patterns.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return patterns[a].size() > patterns[b].size();
+    });
+
+    size_t used[kShiftOrLanes] = {};
+    lanes.assign(patterns.size(), 0);
+    offsets.assign(patterns.size(), 0);
+    for (size_t i : order) {
+        size_t lane = 0;
+        while (lane < kShiftOrLanes && used[lane] + patterns[i].size() > kShiftOrMaxLength) ++lane;
+        if (lane == kShiftOrLanes) return false;
+        lanes[i] = lane;
+        offsets[i] = static_cast<unsigned>(used[lane]);
+        used[lane] += patterns[i].size();
+    }
+    return true;
+}
+
+} // namespace
+
+bool classString(const RegexNode& root, ClassString& classes) {
+    classes.clear();
+    return appendClasses(root, classes) && !classes.empty();
+}
+
+bool ShiftOrMatcher::fits(const std::vector<ClassString>& patterns) {
+    std::vector<size_t> lanes;
+    std::vector<unsigned> offsets;
+    return !patterns.empty() && pack(patterns, lanes, offsets);
+}
+
+ShiftOrMatcher::ShiftOrMatcher(const std::vector<ClassString>& patterns,
+                               const std::vector<uint32_t>& ids)
+    : find_shift_or(scanKernels().find_shift_or) {
+    std::vector<size_t> lanes;
+    std::vector<unsigned> offsets;
+    pack(patterns, lanes, offsets);
+
+    for (auto& masks : tables.masks) std::fill(masks, masks + kShiftOrLanes, ~uint64_t(0));
+    std::fill(tables.starts, tables.starts + kShiftOrLanes, 0);
+    std::fill(tables.ends, tables.ends + kShiftOrLanes, 0);
+    tables.lane_count = 1;
+
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        const size_t lane = lanes[i];
+        const unsigned offset = offsets[i];
+        const unsigned end = offset + static_cast<unsigned>(patterns[i].size()) - 1;
+        tables.starts[lane] |= uint64_t(1) << offset;
+        tables.ends[lane] |= uint64_t(1) << end;
+        for (size_t j = 0; j < patterns[i].size(); ++j) {
+            for (int c = 0; c < 256; ++c) {
+                if (patterns[i][j].test(c)) tables.masks[c][lane] &= ~(uint64_t(1) << (offset + j));
+            }
+        }
+        lane_ends[lane].push_back({end, ids[i]});
+        tables.lane_count = std::max(tables.lane_count, lane + 1);
+    }
+}
+
+void ShiftOrMatcher::findAll(const char* text, size_t text_length, size_t from, size_t to,
+                             std::vector<Match>& matches) const {
+    // Lines starting in [from, to) belong to this range
+    size_t line = firstLineStart(text, text_length, from);
+    if (line >= to || line >= text_length) return;
+
+    // A newline fails every class and so resets the state: one pass over
+    // the range sees each line on its own
+    const size_t scan_end = lineEnd(text, text_length, to - 1);
+    uint64_t state[kShiftOrLanes];
+    std::fill(state, state + kShiftOrLanes, ~uint64_t(0));
+
+    size_t pos = line;
+    while (pos < scan_end) {
+        const size_t hit = find_shift_or(tables, text, pos, scan_end, state);
+        if (hit == kNoMatch) break;
+
+        uint32_t pattern_id = UINT32_MAX;
+        for (size_t lane = 0; lane < tables.lane_count; ++lane) {
+            for (const End& end : lane_ends[lane]) {
+                if (!((state[lane] >> end.bit) & 1)) pattern_id = std::min(pattern_id, end.id);
+            }
+        }
+        matches.push_back({lineStart(text, line, hit), pattern_id});
+
+        // The rest of the line adds nothing; start afresh on the next one
+        line = lineEnd(text, text_length, hit) + 1;
+        pos = line;
+        std::fill(state, state + kShiftOrLanes, ~uint64_t(0));
+    }
+}
+
+size_t ShiftOrMatcher::memoryUsage() const {
+    size_t bytes = sizeof(*this);
+    for (const auto& ends : lane_ends) bytes += ends.capacity() * sizeof(End);
+    return bytes;
+}
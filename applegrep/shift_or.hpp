@@ -0,0 +1,88 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pattern_matcher.hpp"
+#include "regex_syntax.hpp"
+
+// A regex that is a fixed sequence of byte classes, such as
+// "[0-9]{3}-[0-9]{4}" or "a.b": one set of allowed bytes per position
+using ClassString = std::vector<std::bitset<256>>;
+
+// Shift-Or state is packed into lanes of one 64-bit word each, and all lanes
+// are stepped together: 4 lanes fill one 256-bit register (or two 128-bit ones)
+constexpr size_t kShiftOrLanes = 4;
+constexpr size_t kShiftOrMaxLength = 64;
+
+// Packed Shift-Or tables. Each pattern owns a run of bits in one lane, bit
+// j standing for "the last j + 1 bytes match the pattern's first j + 1
+// classes" when clear. Per text byte c every lane steps as
+//
+//     state = ((state << 1) & ~starts) | masks[c]
+//
+// and a pattern ends at that byte when its end bit is clear. Bits of masks[c]
+// are clear where the class at that position allows c; unused bits are set,
+// so unused lanes never match.
+struct ShiftOrTables {
+    alignas(32) uint64_t masks[256][kShiftOrLanes];
+    alignas(32) uint64_t starts[kShiftOrLanes];
+    alignas(32) uint64_t ends[kShiftOrLanes];
+    size_t lane_count;
+};
+
+// Step `state` over text[from, limit). Returns the first position at which
+// some pattern ends, leaving `state` just past that byte, or kNoMatch with
+// `state` at limit.
+using FindShiftOrFn = size_t (*)(const ShiftOrTables& tables, const char* text,
+                                 size_t from, size_t limit, uint64_t* state);
+
+size_t findShiftOrScalar(const ShiftOrTables& tables, const char* text,
+                         size_t from, size_t limit, uint64_t* state);
+
+// Vector kernels step all lanes with one shift/and-not/or per byte
+#if defined(__x86_64__) || defined(__i386__)
+size_t findShiftOrSse2(const ShiftOrTables& tables, const char* text,
+                       size_t from, size_t limit, uint64_t* state);
+size_t findShiftOrAvx2(const ShiftOrTables& tables, const char* text,
+                       size_t from, size_t limit, uint64_t* state);
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+size_t findShiftOrNeon(const ShiftOrTables& tables, const char* text,
+                       size_t from, size_t limit, uint64_t* state);
+#endif
+
+// The class string matched by `root`, or false when it is not one (it has
+// alternation, variable repeats or anchors)
+bool classString(const RegexNode& root, ClassString& classes);
+
+// Bit-parallel Shift-Or for a few short class strings. Line-oriented like
+// RegexMatcher: each line holding a match is reported once, at its start,
+// with the lowest pattern id that ends first in it.
+class ShiftOrMatcher : public PatternMatcher {
+public:
+    // `ids[i]` is reported for `patterns[i]`. The patterns must fit (see
+    // fits()).
+    ShiftOrMatcher(const std::vector<ClassString>& patterns, const std::vector<uint32_t>& ids);
+
+    // Whether the patterns pack into kShiftOrLanes lanes
+    static bool fits(const std::vector<ClassString>& patterns);
+
+    const char* name() const override { return "shift-or"; }
+
+    void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                 std::vector<Match>& matches) const override;
+
+    size_t memoryUsage() const override;
+
+private:
+    struct End {
+        unsigned bit;
+        uint32_t id;
+    };
+
+    ShiftOrTables tables;
+    std::vector<End> lane_ends[kShiftOrLanes];
+    FindShiftOrFn find_shift_or;
+};
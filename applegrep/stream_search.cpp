@@ -0,0 +1,190 @@
+#include "stream_search.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include <unistd.h>
+
+#include "bounded_queue.hpp"
+#include "line_ranges.hpp"
+#include "scan_kernels.hpp"
+
+namespace {
+
+// Large enough that a busy pipe fills whole chunks for every core, small
+// enough that the ring stays a fixed, modest amount of memory. One buffer is
+// being read, one waits to be scanned, one is scanned and one written out.
+constexpr size_t kBufferBytes = 16 << 20;
+constexpr size_t kRingBuffers = 4;
+
+// Page-aligned, so that the Metal backend can wrap a block without a copy
+struct AlignedBuffer {
+    std::unique_ptr<char, decltype(&std::free)> bytes{nullptr, &std::free};
+    size_t capacity = 0;
+
+    // Reallocate to `new_capacity`, keeping the first `keep` bytes
+    bool resize(size_t new_capacity, size_t keep) {
+        void* fresh = nullptr;
+        if (posix_memalign(&fresh, static_cast<size_t>(getpagesize()), new_capacity) != 0) {
+            return false;
+        }
+        if (keep > 0) memcpy(fresh, bytes.get(), keep);
+        bytes.reset(static_cast<char*>(fresh));
+        capacity = new_capacity;
+        return true;
+    }
+};
+
+// A block the reader filled: `used` bytes, of which the lines before `cut`
+// are to be reported
+struct ReadBlock {
+    size_t buffer;
+    size_t used;
+    size_t cut;
+};
+
+struct ScannedBlock {
+    size_t buffer;
+    size_t cut;
+    std::vector<Match> matches;
+    size_t lines_before;
+};
+
+// The reader stage. Waits for input, takes whatever else is ready without
+// waiting, and queues the block once no more is; the unreported tail is
+// copied to the front of the next free buffer first. Fails with `error` when
+// a read or an allocation fails.
+void readBlocks(StreamSource& source, size_t overlap, std::vector<AlignedBuffer>& ring,
+                BoundedQueue<size_t>& free_buffers, BoundedQueue<ReadBlock>& to_scan,
+                std::string& error) {
+    size_t current;
+    if (!free_buffers.pop(current)) return;
+    size_t used = 0;  // Bytes in the current buffer, carried ones included
+    bool at_end = false;
+    while (!at_end) {
+        AlignedBuffer& buffer = ring[current];
+        do {
+            const ssize_t got =
+                source.read(buffer.bytes.get() + used, buffer.capacity - used, error);
+            if (got < 0) return;
+            if (got == 0) at_end = true;
+            used += static_cast<size_t>(got);
+        } while (!at_end && used < buffer.capacity && source.ready());
+
+        // Report the lines no later input can change; at the end, all of them
+        const char* text = buffer.bytes.get();
+        const size_t cut = at_end ? used
+                                  : lineStart(text, 0, used - std::min(used, overlap));
+        if (cut == 0) {
+            // Not one line is complete. A full buffer holds a single long
+            // line, so give it room to end.
+            if (used == buffer.capacity && !buffer.resize(2 * buffer.capacity, used)) {
+                error = "cannot allocate stream buffers";
+                return;
+            }
+            continue;
+        }
+
+        size_t next;
+        if (!free_buffers.pop(next)) return;
+        const size_t carry = used - cut;
+        if (carry > ring[next].capacity / 2 && !ring[next].resize(2 * carry, 0)) {
+            error = "cannot allocate stream buffers";
+            return;
+        }
+        memcpy(ring[next].bytes.get(), text + cut, carry);
+        if (!to_scan.push({current, used, cut})) return;
+        current = next;
+        used = carry;
+    }
+}
+
+} // namespace
+
+size_t streamOverlap(const std::vector<std::string>& patterns, const SearchOptions& options) {
+    if (options.extended_regex || options.max_errors > 0) return 0;
+    size_t longest = 0;
+    for (const std::string& pattern : patterns) {
+        if (pattern.find('\n') != std::string::npos) longest = std::max(longest, pattern.size());
+    }
+    if (longest == 0) return 0;
+    // A folded character can take up to three times the bytes of its pattern
+    // character (k and KELVIN SIGN)
+    return (options.ignore_case ? 3 * longest : longest) - 1;
+}
+
+bool searchStream(int fd, SearchBackend& backend, size_t overlap, const StreamBlockFn& on_block,
+                  StreamTotals& totals, std::string& error) {
+    const std::unique_ptr<StreamSource> source = createFdSource(fd);
+    return searchStream(*source, backend, overlap, on_block, totals, error);
+}
+
+bool searchStream(StreamSource& source, SearchBackend& backend, size_t overlap,
+                  const StreamBlockFn& on_block, StreamTotals& totals, std::string& error) {
+    std::vector<AlignedBuffer> ring(kRingBuffers);
+    BoundedQueue<size_t> free_buffers(kRingBuffers);
+    for (size_t i = 0; i < kRingBuffers; ++i) {
+        if (!ring[i].resize(kBufferBytes, 0)) {
+            error = "cannot allocate stream buffers";
+            return false;
+        }
+        free_buffers.push(i);
+    }
+    BoundedQueue<ReadBlock> to_scan(kRingBuffers);
+    BoundedQueue<ScannedBlock> to_write(kRingBuffers);
+
+    // Reader: fills the next buffer while the current one is scanned
+    std::string read_error;
+    std::thread reader([&] {
+        readBlocks(source, overlap, ring, free_buffers, to_scan, read_error);
+        to_scan.close();
+    });
+
+    // Writer: hands a block to on_block while later ones are scanned, then
+    // gives its buffer back to the reader
+    std::thread writer([&] {
+        ScannedBlock block;
+        while (to_write.pop(block)) {
+            on_block(ring[block.buffer].bytes.get(), block.cut, block.matches, block.lines_before);
+            free_buffers.push(block.buffer);
+        }
+    });
+
+    // Scanner: this thread, with the backend spreading each block over the pool
+    const CountNewlinesFn count_newlines = scanKernels().count_newlines;
+    size_t lines_before = 0;
+    ReadBlock block;
+    while (to_scan.pop(block)) {
+        const char* text = ring[block.buffer].bytes.get();
+
+        // Matchers see the carried tail too, so a match may run past the cut.
+        // Timed here: with concurrent searches, stats() may be another's.
+        const auto scan_start = std::chrono::steady_clock::now();
+        std::vector<Match> matches = backend.search(text, block.used);
+        totals.scan_seconds += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - scan_start).count();
+        const auto past_cut = std::lower_bound(
+            matches.begin(), matches.end(), block.cut,
+            [](const Match& match, size_t position) { return match.position < position; });
+        matches.erase(past_cut, matches.end());
+
+        totals.bytes += block.cut;
+        totals.matches += matches.size();
+        const size_t lines = count_newlines(text, block.cut);
+        to_write.push({block.buffer, block.cut, std::move(matches), lines_before});
+        lines_before += lines;
+    }
+    to_write.close();
+    writer.join();
+    reader.join();
+
+    if (!read_error.empty()) {
+        error = read_error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "match.hpp"
+#include "search_backend.hpp"
+#include "stream_source.hpp"
+
+// Called once per searched block with the complete lines it holds,
+// text[0, length), and their matches in order. `lines_before` is the number
+// of lines in earlier blocks; match.line, when the backend numbers lines,
+// counts from the start of the block.
+using StreamBlockFn = std::function<void(const char* text, size_t length,
+                                         const std::vector<Match>& matches,
+                                         size_t lines_before)>;
+
+// What a streamed search read and found, for the summary and --stats
+struct StreamTotals {
+    size_t bytes = 0;
+    size_t matches = 0;
+    double scan_seconds = 0;
+};
+
+// Bytes a match may extend past the end of the line it starts on. Only
+// literal patterns holding a newline cross lines; the rest need no overlap.
+size_t streamOverlap(const std::vector<std::string>& patterns, const SearchOptions& options);
+
+// Search `source` as it is read, for pipes and other inputs that cannot be
+// mapped, and for decompressed input. Reads go into a fixed ring of
+// page-aligned buffers, and a block is searched as soon as a read leaves no
+// more input ready, so matches in a slow stream (tail -F) are reported as
+// they arrive and memory stays bounded on an endless one. A block reports
+// the lines that are complete and end at least `overlap` bytes before the
+// buffered input does; the rest is carried to the front of the next buffer.
+// A single line longer than a buffer grows that buffer.
+//
+// Reading, scanning and output overlap: a reader thread fills the next
+// buffer while the calling thread scans the current one, and a writer thread
+// runs `on_block` for the one before. Bounded queues between the stages keep
+// a fast stage from running more than the ring ahead of a slow one.
+//
+// Returns false and fills `error` when reading fails.
+bool searchStream(StreamSource& source, SearchBackend& backend, size_t overlap,
+                  const StreamBlockFn& on_block, StreamTotals& totals, std::string& error);
+
+// The same, reading `fd`
+bool searchStream(int fd, SearchBackend& backend, size_t overlap, const StreamBlockFn& on_block,
+                  StreamTotals& totals, std::string& error);
@@ -0,0 +1,125 @@
+#include "stream_source.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+// Scratch space for skipping through sources that can only be read
+constexpr size_t kSkipBytes = 64 << 10;
+
+class FdSource : public StreamSource {
+public:
+    explicit FdSource(int fd) : fd(fd) {}
+
+    ssize_t read(char* to, size_t room, std::string& error) override {
+        for (;;) {
+            const ssize_t got = ::read(fd, to, room);
+            if (got >= 0) return got;
+            if (errno != EINTR) {
+                error = std::string("cannot read input: ") + strerror(errno);
+                return -1;
+            }
+        }
+    }
+
+    bool ready() override {
+        pollfd request = {fd, POLLIN, 0};
+        return poll(&request, 1, 0) > 0;
+    }
+
+private:
+    const int fd;
+};
+
+class MemorySource : public StreamSource {
+public:
+    MemorySource(const char* data, size_t length) : data(data), length(length) {}
+
+    ssize_t read(char* to, size_t room, std::string&) override {
+        const size_t count = std::min(room, length - offset);
+        memcpy(to, data + offset, count);
+        offset += count;
+        return static_cast<ssize_t>(count);
+    }
+
+    bool ready() override { return true; }
+
+    ssize_t skip(size_t count, std::string&) override {
+        count = std::min(count, length - offset);
+        offset += count;
+        return static_cast<ssize_t>(count);
+    }
+
+private:
+    const char* const data;
+    const size_t length;
+    size_t offset = 0;
+};
+
+class PrefixedSource : public StreamSource {
+public:
+    PrefixedSource(std::string prefix, std::unique_ptr<StreamSource> source)
+        : prefix(std::move(prefix)), source(std::move(source)) {}
+
+    ssize_t read(char* to, size_t room, std::string& error) override {
+        if (offset == prefix.size()) return source->read(to, room, error);
+        const size_t count = std::min(room, prefix.size() - offset);
+        memcpy(to, prefix.data() + offset, count);
+        offset += count;
+        return static_cast<ssize_t>(count);
+    }
+
+    bool ready() override { return offset < prefix.size() || source->ready(); }
+
+private:
+    const std::string prefix;
+    const std::unique_ptr<StreamSource> source;
+    size_t offset = 0;
+};
+
+} // namespace
+
+ssize_t StreamSource::skip(size_t count, std::string& error) {
+    char scratch[kSkipBytes];
+    size_t skipped = 0;
+    while (skipped < count) {
+        const ssize_t got = read(scratch, std::min(count - skipped, sizeof scratch), error);
+        if (got < 0) return -1;
+        if (got == 0) break;
+        skipped += static_cast<size_t>(got);
+    }
+    return static_cast<ssize_t>(skipped);
+}
+
+std::unique_ptr<StreamSource> createFdSource(int fd) {
+    return std::make_unique<FdSource>(fd);
+}
+
+std::unique_ptr<StreamSource> createMemorySource(const char* data, size_t length) {
+    return std::make_unique<MemorySource>(data, length);
+}
+
+std::unique_ptr<StreamSource> createPrefixedSource(std::string prefix,
+                                                   std::unique_ptr<StreamSource> source) {
+    return std::make_unique<PrefixedSource>(std::move(prefix), std::move(source));
+}
+
+bool peekSource(std::unique_ptr<StreamSource>& source, size_t count, std::string& prefix,
+                std::string& error) {
+    prefix.assign(count, '\0');
+    size_t have = 0;
+    while (have < count) {
+        const ssize_t got = source->read(&prefix[have], count - have, error);
+        if (got < 0) return false;
+        if (got == 0) break;
+        have += static_cast<size_t>(got);
+    }
+    prefix.resize(have);
+    source = createPrefixedSource(prefix, std::move(source));
+    return true;
+}
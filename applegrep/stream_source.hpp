@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <sys/types.h>
+
+// The bytes a streamed search reads: a descriptor, memory, or a decoder
+// wrapped around another source. read() is only called from one thread.
+class StreamSource {
+public:
+    virtual ~StreamSource() = default;
+
+    // Fill up to `room` bytes of `to`. Returns 0 at the end of the input,
+    // and -1 with `error` filled when reading fails.
+    virtual ssize_t read(char* to, size_t room, std::string& error) = 0;
+
+    // Whether read() would return without waiting for more input
+    virtual bool ready() = 0;
+
+    // Drop the next `count` bytes, or fewer at the end of the input. Returns
+    // the bytes dropped, and -1 with `error` filled when reading fails.
+    virtual ssize_t skip(size_t count, std::string& error);
+};
+
+// Reads `fd`, which stays owned by the caller
+std::unique_ptr<StreamSource> createFdSource(int fd);
+
+// Reads [data, data + length), which must outlive the source
+std::unique_ptr<StreamSource> createMemorySource(const char* data, size_t length);
+
+// Returns `prefix` first and then the rest of `source`: for input whose
+// first bytes were read to identify it
+std::unique_ptr<StreamSource> createPrefixedSource(std::string prefix,
+                                                   std::unique_ptr<StreamSource> source);
+
+// Read the first `count` bytes of `source` (fewer only at its end) into
+// `prefix` and replace `source` with one that returns them again first.
+// Returns false with `error` filled when reading fails.
+bool peekSource(std::unique_ptr<StreamSource>& source, size_t count, std::string& prefix,
+                std::string& error);
@@ -0,0 +1,283 @@
+#include "teddy.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "case_fold.hpp"
+#include "literal_scan.hpp"
+#include "scan_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+size_t findTeddyScalar(const TeddyMasks& masks, const char* text,
+                       size_t from, size_t limit, uint8_t& buckets) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    for (size_t pos = from; pos < limit; ++pos) {
+        uint8_t hit = 0xff;
+        for (size_t k = 0; k < masks.fingerprint_length && hit; ++k) {
+            const unsigned char c = bytes[pos + k];
+            hit &= masks.lo[k][c & 0x0f] & masks.hi[k][c >> 4];
+        }
+        if (hit) {
+            buckets = hit;
+            return pos;
+        }
+    }
+    return kNoMatch;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+namespace {
+
+template <size_t kFingerprint>
+__attribute__((target("ssse3")))
+size_t teddySsse3(const TeddyMasks& masks, const char* text,
+                  size_t from, size_t limit, uint8_t& buckets) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i lo[kFingerprint], hi[kFingerprint];
+    for (size_t k = 0; k < kFingerprint; ++k) {
+        lo[k] = _mm_load_si128(reinterpret_cast<const __m128i*>(masks.lo[k]));
+        hi[k] = _mm_load_si128(reinterpret_cast<const __m128i*>(masks.hi[k]));
+    }
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        __m128i acc = _mm_set1_epi8(-1);
+        for (size_t k = 0; k < kFingerprint; ++k) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos + k));
+            const __m128i low = _mm_shuffle_epi8(lo[k], _mm_and_si128(block, nibble));
+            const __m128i high = _mm_shuffle_epi8(hi[k], _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+            acc = _mm_and_si128(acc, _mm_and_si128(low, high));
+        }
+        const uint32_t hits = _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) ^ 0xffff;
+        if (hits) {
+            alignas(16) uint8_t lanes[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+            const unsigned lane = __builtin_ctz(hits);
+            buckets = lanes[lane];
+            return pos + lane;
+        }
+    }
+    return findTeddyScalar(masks, text, pos, limit, buckets);
+}
+
+template <size_t kFingerprint>
+__attribute__((target("avx2")))
+size_t teddyAvx2(const TeddyMasks& masks, const char* text,
+                 size_t from, size_t limit, uint8_t& buckets) {
+    // vpshufb looks up within each 128-bit lane, so both lanes get the table
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i lo[kFingerprint], hi[kFingerprint];
+    for (size_t k = 0; k < kFingerprint; ++k) {
+        lo[k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(masks.lo[k])));
+        hi[k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(masks.hi[k])));
+    }
+
+    size_t pos = from;
+    for (; pos + 32 <= limit; pos += 32) {
+        __m256i acc = _mm256_set1_epi8(-1);
+        for (size_t k = 0; k < kFingerprint; ++k) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos + k));
+            const __m256i low = _mm256_shuffle_epi8(lo[k], _mm256_and_si256(block, nibble));
+            const __m256i high = _mm256_shuffle_epi8(hi[k], _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+            acc = _mm256_and_si256(acc, _mm256_and_si256(low, high));
+        }
+        const uint32_t hits = ~static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(acc, _mm256_setzero_si256())));
+        if (hits) {
+            alignas(32) uint8_t lanes[32];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+            const unsigned lane = __builtin_ctz(hits);
+            buckets = lanes[lane];
+            return pos + lane;
+        }
+    }
+    return teddySsse3<kFingerprint>(masks, text, pos, limit, buckets);
+}
+
+template <size_t kFingerprint>
+__attribute__((target("avx512f,avx512bw")))
+size_t teddyAvx512(const TeddyMasks& masks, const char* text,
+                   size_t from, size_t limit, uint8_t& buckets) {
+    const __m512i nibble = _mm512_set1_epi8(0x0f);
+    __m512i lo[kFingerprint], hi[kFingerprint];
+    for (size_t k = 0; k < kFingerprint; ++k) {
+        lo[k] = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(reinterpret_cast<const __m128i*>(masks.lo[k])));
+        hi[k] = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(reinterpret_cast<const __m128i*>(masks.hi[k])));
+    }
+
+    size_t pos = from;
+    for (; pos + 64 <= limit; pos += 64) {
+        __m512i acc = _mm512_set1_epi8(-1);
+        for (size_t k = 0; k < kFingerprint; ++k) {
+            const __m512i block = _mm512_loadu_si512(text + pos + k);
+            const __m512i low = _mm512_shuffle_epi8(lo[k], _mm512_and_si512(block, nibble));
+            const __m512i high = _mm512_shuffle_epi8(hi[k], _mm512_and_si512(_mm512_srli_epi16(block, 4), nibble));
+            acc = _mm512_and_si512(acc, _mm512_and_si512(low, high));
+        }
+        const uint64_t hits = _mm512_test_epi8_mask(acc, acc);
+        if (hits) {
+            alignas(64) uint8_t lanes[64];
+            _mm512_store_si512(lanes, acc);
+            const unsigned lane = __builtin_ctzll(hits);
+            buckets = lanes[lane];
+            return pos + lane;
+        }
+    }
+    return teddyAvx2<kFingerprint>(masks, text, pos, limit, buckets);
+}
+
+} // namespace
+
+size_t findTeddySsse3(const TeddyMasks& masks, const char* text,
+                      size_t from, size_t limit, uint8_t& buckets) {
+    switch (masks.fingerprint_length) {
+        case 1: return teddySsse3<1>(masks, text, from, limit, buckets);
+        case 2: return teddySsse3<2>(masks, text, from, limit, buckets);
+        default: return teddySsse3<3>(masks, text, from, limit, buckets);
+    }
+}
+
+size_t findTeddyAvx2(const TeddyMasks& masks, const char* text,
+                     size_t from, size_t limit, uint8_t& buckets) {
+    switch (masks.fingerprint_length) {
+        case 1: return teddyAvx2<1>(masks, text, from, limit, buckets);
+        case 2: return teddyAvx2<2>(masks, text, from, limit, buckets);
+        default: return teddyAvx2<3>(masks, text, from, limit, buckets);
+    }
+}
+
+size_t findTeddyAvx512(const TeddyMasks& masks, const char* text,
+                       size_t from, size_t limit, uint8_t& buckets) {
+    switch (masks.fingerprint_length) {
+        case 1: return teddyAvx512<1>(masks, text, from, limit, buckets);
+        case 2: return teddyAvx512<2>(masks, text, from, limit, buckets);
+        default: return teddyAvx512<3>(masks, text, from, limit, buckets);
+    }
+}
+
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+
+namespace {
+
+template <size_t kFingerprint>
+size_t teddyNeon(const TeddyMasks& masks, const char* text,
+                 size_t from, size_t limit, uint8_t& buckets) {
+    const uint8x16_t nibble = vdupq_n_u8(0x0f);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text);
+    uint8x16_t lo[kFingerprint], hi[kFingerprint];
+    for (size_t k = 0; k < kFingerprint; ++k) {
+        lo[k] = vld1q_u8(masks.lo[k]);
+        hi[k] = vld1q_u8(masks.hi[k]);
+    }
+
+    size_t pos = from;
+    for (; pos + 16 <= limit; pos += 16) {
+        uint8x16_t acc = vdupq_n_u8(0xff);
+        for (size_t k = 0; k < kFingerprint; ++k) {
+            const uint8x16_t block = vld1q_u8(bytes + pos + k);
+            const uint8x16_t low = vqtbl1q_u8(lo[k], vandq_u8(block, nibble));
+            const uint8x16_t high = vqtbl1q_u8(hi[k], vshrq_n_u8(block, 4));
+            acc = vandq_u8(acc, vandq_u8(low, high));
+        }
+        if (vmaxvq_u8(acc)) {
+            alignas(16) uint8_t lanes[16];
+            vst1q_u8(lanes, acc);
+            unsigned lane = 0;
+            while (!lanes[lane]) ++lane;
+            buckets = lanes[lane];
+            return pos + lane;
+        }
+    }
+    return findTeddyScalar(masks, text, pos, limit, buckets);
+}
+
+} // namespace
+
+size_t findTeddyNeon(const TeddyMasks& masks, const char* text,
+                     size_t from, size_t limit, uint8_t& buckets) {
+    switch (masks.fingerprint_length) {
+        case 1: return teddyNeon<1>(masks, text, from, limit, buckets);
+        case 2: return teddyNeon<2>(masks, text, from, limit, buckets);
+        default: return teddyNeon<3>(masks, text, from, limit, buckets);
+    }
+}
+
+#endif
+
+TeddyMatcher::TeddyMatcher(const std::vector<std::string>& patterns, bool fold_case)
+    : find_teddy(scanKernels().find_teddy), fold_case(fold_case) {
+    for (const std::string& pattern : patterns) {
+        this->patterns.push_back(fold_case ? foldAscii(pattern) : pattern);
+    }
+
+    // 1. The fingerprint covers the first bytes every (non-empty) pattern has
+    std::vector<uint32_t> ids;
+    size_t shortest = kTeddyMaxFingerprint;
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        if (patterns[id].empty()) continue;
+        ids.push_back(static_cast<uint32_t>(id));
+        shortest = std::min(shortest, patterns[id].size());
+    }
+    memset(&masks, 0, sizeof(masks));
+    masks.fingerprint_length = shortest;
+
+    // 2. Patterns sharing a prefix go to the same bucket, which keeps the
+    // nibble sets of each bucket small and false candidates rare
+    std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) {
+        return this->patterns[a].compare(0, shortest, this->patterns[b], 0, shortest) < 0;
+    });
+    const size_t per_bucket = std::max<size_t>(1, (ids.size() + kTeddyBuckets - 1) / kTeddyBuckets);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const size_t bucket = i / per_bucket;
+        buckets[bucket].push_back(ids[i]);
+        for (size_t k = 0; k < shortest; ++k) {
+            const unsigned char c = this->patterns[ids[i]][k];
+            masks.lo[k][c & 0x0f] |= 1u << bucket;
+            masks.hi[k][c >> 4] |= 1u << bucket;
+            // The cases of a letter differ in bit 0x20 only, i.e. in the
+            // high nibble
+            if (fold_case && isAsciiLetter(c)) masks.hi[k][(c ^ 0x20) >> 4] |= 1u << bucket;
+        }
+    }
+    for (auto& bucket : buckets) std::sort(bucket.begin(), bucket.end());
+}
+
+void TeddyMatcher::findAll(const char* text, size_t text_length, size_t from, size_t to,
+                           std::vector<Match>& matches) const {
+    const size_t fingerprint = masks.fingerprint_length;
+    if (buckets[0].empty() || text_length < fingerprint) return;
+    const size_t limit = std::min(to, text_length - fingerprint + 1);
+
+    size_t pos = from;
+    uint8_t hit = 0;
+    while (pos < limit && (pos = find_teddy(masks, text, pos, limit, hit)) != kNoMatch) {
+        const size_t first = matches.size();
+        for (unsigned bucket = 0; hit; ++bucket, hit >>= 1) {
+            if (!(hit & 1)) continue;
+            for (uint32_t id : buckets[bucket]) {
+                const std::string& pattern = patterns[id];
+                if (pattern.size() <= text_length - pos &&
+                    (fold_case ? equalsFoldedAscii(text + pos, pattern.data(), pattern.size())
+                               : memcmp(text + pos, pattern.data(), pattern.size()) == 0)) {
+                    matches.push_back({pos, id});
+                }
+            }
+        }
+        // Several buckets can match at one position; keep ids ascending
+        if (matches.size() - first > 1) std::sort(matches.begin() + first, matches.end());
+        ++pos;
+    }
+}
+
+size_t TeddyMatcher::memoryUsage() const {
+    size_t bytes = sizeof(*this) + patterns.capacity() * sizeof(std::string);
+    for (const std::string& pattern : patterns) bytes += pattern.capacity();
+    for (const auto& bucket : buckets) bytes += bucket.capacity() * sizeof(uint32_t);
+    return bytes;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pattern_matcher.hpp"
+
+constexpr size_t kTeddyBuckets = 8;
+constexpr size_t kTeddyMaxFingerprint = 3;
+
+// Packed nibble tables of a Teddy matcher. For fingerprint byte k, bit b of
+// lo[k][n] (hi[k][n]) is set when a pattern in bucket b has low (high)
+// nibble n at offset k. A text position is a candidate for bucket b when
+// every fingerprint byte passes both lookups for b.
+struct TeddyMasks {
+    alignas(16) uint8_t lo[kTeddyMaxFingerprint][16];
+    alignas(16) uint8_t hi[kTeddyMaxFingerprint][16];
+    size_t fingerprint_length;
+};
+
+// First position p in [from, limit) that is a candidate for at least one
+// bucket, with the candidate buckets in `buckets`, or kNoMatch. Reads up to
+// limit + fingerprint_length - 1 bytes.
+using FindTeddyFn = size_t (*)(const TeddyMasks& masks, const char* text,
+                               size_t from, size_t limit, uint8_t& buckets);
+
+size_t findTeddyScalar(const TeddyMasks& masks, const char* text,
+                       size_t from, size_t limit, uint8_t& buckets);
+
+// Vector kernels look up 16/32/64 positions per pshufb/tbl
+#if defined(__x86_64__) || defined(__i386__)
+size_t findTeddySsse3(const TeddyMasks& masks, const char* text,
+                      size_t from, size_t limit, uint8_t& buckets);
+size_t findTeddyAvx2(const TeddyMasks& masks, const char* text,
+                     size_t from, size_t limit, uint8_t& buckets);
+size_t findTeddyAvx512(const TeddyMasks& masks, const char* text,
+                       size_t from, size_t limit, uint8_t& buckets);
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+size_t findTeddyNeon(const TeddyMasks& masks, const char* text,
+                     size_t from, size_t limit, uint8_t& buckets);
+#endif
+
+// Teddy: a packed-SIMD multi-literal matcher for small pattern sets. Patterns
+// are grouped into 8 buckets by prefix; one pass over the text yields
+// candidate positions per bucket, which are verified against that bucket's
+// patterns only. With fold_case both cases of a letter set the nibble masks,
+// and candidates are verified up to ASCII case.
+class TeddyMatcher : public PatternMatcher {
+public:
+    TeddyMatcher(const std::vector<std::string>& patterns, bool fold_case);
+
+    const char* name() const override { return "teddy"; }
+
+    void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                 std::vector<Match>& matches) const override;
+
+    size_t memoryUsage() const override;
+
+private:
+    std::vector<std::string> patterns;
+    std::vector<uint32_t> buckets[kTeddyBuckets];
+    TeddyMasks masks;
+    FindTeddyFn find_teddy;
+    bool fold_case;
+};
@@ -0,0 +1,134 @@
+#include "two_way.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "case_fold.hpp"
+
+namespace {
+
+// Start (minus one) of the maximal suffix of x under the byte order, or under
+// the reversed order when kReversed. Also returns that suffix's period.
+template <bool kReversed>
+ptrdiff_t maximalSuffix(const unsigned char* x, ptrdiff_t m, size_t& period) {
+    ptrdiff_t ms = -1, j = 0, k = 1;
+    ptrdiff_t p = 1;
+    while (j + k < m) {
+        const unsigned char a = x[j + k];
+        const unsigned char b = x[ms + k];
+        if (kReversed ? a > b : a < b) {
+            j += k;
+            k = 1;
+            p = j - ms;
+        } else if (a == b) {
+            if (k != p) {
+                ++k;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            ms = j;
+            j = ms + 1;
+            k = p = 1;
+        }
+    }
+    period = static_cast<size_t>(p);
+    return ms;
+}
+
+} // namespace
+
+TwoWayMatcher::TwoWayMatcher(const std::string& pattern, bool fold_case)
+    : LiteralMatcher(pattern, fold_case) {
+    // Folded, the pattern is a plain string over lower-case text bytes
+    const unsigned char* x = reinterpret_cast<const unsigned char*>(this->pattern.data());
+    const ptrdiff_t m = static_cast<ptrdiff_t>(this->pattern.size());
+
+    // The later of the two maximal suffixes gives a critical factorization
+    size_t p, q;
+    const ptrdiff_t i = maximalSuffix<false>(x, m, p);
+    const ptrdiff_t j = maximalSuffix<true>(x, m, q);
+    if (i > j) {
+        critical = i;
+        period = p;
+    } else {
+        critical = j;
+        period = q;
+    }
+
+    // The left half repeats with the period of the right one: the whole
+    // pattern is periodic and matches may overlap
+    periodic = memcmp(x, x + period, critical + 1) == 0;
+    if (!periodic) {
+        period = std::max(critical + 1, m - critical - 1) + 1;
+    }
+}
+
+template <bool kAll, bool kFold>
+size_t TwoWayMatcher::scan(const char* text, size_t from, size_t limit,
+                           uint32_t pattern_id, std::vector<Match>* matches) const {
+    const unsigned char* x = reinterpret_cast<const unsigned char*>(pattern.data());
+    const unsigned char* y = reinterpret_cast<const unsigned char*>(text);
+    const ptrdiff_t m = static_cast<ptrdiff_t>(pattern.size());
+    const ptrdiff_t per = static_cast<ptrdiff_t>(period);
+    auto at = [](const unsigned char* window, ptrdiff_t i) {
+        return kFold ? foldAscii(window[i]) : window[i];
+    };
+
+    size_t pos = from;
+    if (periodic) {
+        // `memory` is how much of the left half is known to match already
+        ptrdiff_t memory = -1;
+        while (pos < limit) {
+            const unsigned char* window = y + pos;
+            ptrdiff_t i = std::max(critical, memory) + 1;
+            while (i < m && x[i] == at(window, i)) ++i;
+            if (i >= m) {
+                i = critical;
+                while (i > memory && x[i] == at(window, i)) --i;
+                if (i <= memory) {
+                    if (!kAll) return pos;
+                    matches->push_back({pos, pattern_id});
+                }
+                pos += per;
+                memory = m - per - 1;
+            } else {
+                pos += i - critical;
+                memory = -1;
+            }
+        }
+    } else {
+        while (pos < limit) {
+            const unsigned char* window = y + pos;
+            ptrdiff_t i = critical + 1;
+            while (i < m && x[i] == at(window, i)) ++i;
+            if (i >= m) {
+                i = critical;
+                while (i >= 0 && x[i] == at(window, i)) --i;
+                if (i < 0) {
+                    if (!kAll) return pos;
+                    matches->push_back({pos, pattern_id});
+                }
+                pos += per;
+            } else {
+                pos += i - critical;
+            }
+        }
+    }
+    return kNoMatch;
+}
+
+size_t TwoWayMatcher::find(const char* text, size_t from, size_t limit) const {
+    if (fold_case) return scan<false, true>(text, from, limit, 0, nullptr);
+    return scan<false, false>(text, from, limit, 0, nullptr);
+}
+
+void TwoWayMatcher::findAll(const char* text, size_t from, size_t limit,
+                            uint32_t pattern_id, std::vector<Match>& matches) const {
+    if (fold_case) {
+        scan<true, true>(text, from, limit, pattern_id, &matches);
+    } else {
+        scan<true, false>(text, from, limit, pattern_id, &matches);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+#include "literal_matcher.hpp"
+
+// Crochemore-Perrin Two-Way matching. The pattern is split at a critical
+// factorization; the right half is matched left-to-right, the left half
+// right-to-left, and shifts are derived from the pattern period. Worst case
+// is O(n + m) comparisons with O(1) extra space, whatever the input.
+class TwoWayMatcher : public LiteralMatcher {
+public:
+    TwoWayMatcher(const std::string& pattern, bool fold_case);
+
+    const char* name() const override { return "two-way"; }
+
+    size_t find(const char* text, size_t from, size_t limit) const override;
+
+    // Keeps the periodic-case memory between consecutive matches, so dense
+    // overlapping matches stay linear as well
+    void findAll(const char* text, size_t from, size_t limit,
+                 uint32_t pattern_id, std::vector<Match>& matches) const override;
+
+private:
+    template <bool kAll, bool kFold>
+    size_t scan(const char* text, size_t from, size_t limit,
+                uint32_t pattern_id, std::vector<Match>* matches) const;
+
+    ptrdiff_t critical;  // Last index of the left half (may be -1)
+    size_t period;
+    bool periodic;
+};
@@ -0,0 +1,137 @@
+#include "unicode_fold_matcher.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include "case_fold.hpp"
+#include "multi_literal_matcher.hpp"
+
+namespace {
+
+// Above every code point (and kInvalidUtf8 byte): marks an ASCII key
+constexpr uint32_t kAsciiKey = 0x80000000;
+
+// Case variants per pattern; orbits have at most four members, so every
+// pattern keeps at least its first character
+constexpr size_t kMaxVariants = 16;
+
+// Candidates are collected this many start positions at a time
+constexpr size_t kPrefilterWindow = 64 << 10;
+
+// Every member of `code_point`'s orbit, or just the character when it is
+// ASCII: ASCII pattern letters never match non-ASCII text
+std::vector<uint32_t> caseVariants(uint32_t code_point) {
+    std::vector<uint32_t> members = {code_point};
+    if (code_point < 0x80) return members;
+    for (uint32_t c = simpleFold(code_point); c != code_point; c = simpleFold(c)) {
+        members.push_back(c);
+    }
+    return members;
+}
+
+} // namespace
+
+UnicodeFoldMatcher::UnicodeFoldMatcher(const std::vector<std::string>& patterns) {
+    std::map<std::string, uint32_t> variant_ids;
+    std::vector<std::string> variants;
+    keys.resize(patterns.size());
+    for (size_t id = 0; id < patterns.size(); ++id) {
+        const std::string& pattern = patterns[id];
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(pattern.data());
+        std::vector<std::string> prefixes = {""};
+        bool expanding = true;
+        for (size_t i = 0; i < pattern.size();) {
+            uint32_t code_point;
+            i += decodeUtf8(bytes + i, pattern.size() - i, code_point);
+            keys[id].push_back(code_point < 0x80 ? kAsciiKey | foldAscii(code_point)
+                                                 : foldCanonical(code_point));
+
+            // Spell the prefix every way it can appear, while that stays small
+            const std::vector<uint32_t> members = caseVariants(code_point);
+            expanding = expanding && prefixes.size() * members.size() <= kMaxVariants;
+            if (!expanding) continue;
+            std::vector<std::string> longer;
+            for (const std::string& prefix : prefixes) {
+                for (uint32_t member : members) {
+                    longer.push_back(prefix);
+                    appendUtf8(member, longer.back());
+                }
+            }
+            prefixes = std::move(longer);
+        }
+        if (pattern.empty()) continue;
+
+        for (const std::string& prefix : prefixes) {
+            const auto inserted = variant_ids.emplace(
+                foldAscii(prefix), static_cast<uint32_t>(variants.size()));
+            if (inserted.second) {
+                variants.push_back(inserted.first->first);
+                owners.emplace_back();
+            }
+            // "K" and "k" fold to the same variant
+            std::vector<uint32_t>& owner = owners[inserted.first->second];
+            if (owner.empty() || owner.back() != id) owner.push_back(static_cast<uint32_t>(id));
+        }
+    }
+    prefilter = compileLiterals(variants, true);
+    engine_name = std::string(prefilter->name()) + " + unicode fold";
+}
+
+bool UnicodeFoldMatcher::matchesAt(const char* text, size_t text_length, size_t position,
+                                   uint32_t pattern_id) const {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+    for (uint32_t key : keys[pattern_id]) {
+        if (position >= text_length) return false;
+        uint32_t code_point;
+        position += decodeUtf8(bytes + position, text_length - position, code_point);
+        if (key & kAsciiKey) {
+            if (code_point >= 0x80 || (kAsciiKey | foldAscii(code_point)) != key) return false;
+        } else if (foldCanonical(code_point) != key) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void UnicodeFoldMatcher::findAll(const char* text, size_t text_length, size_t from, size_t to,
+                                 std::vector<Match>& matches) const {
+    std::vector<Match> candidates;
+    for (size_t window = from; window < to; window += kPrefilterWindow) {
+        candidates.clear();
+        prefilter->findAll(text, text_length, window, std::min(to, window + kPrefilterWindow),
+                           candidates);
+
+        // Variants of different patterns can start at one position, so the
+        // window's matches are put back in (position, pattern id) order
+        const size_t first = matches.size();
+        for (const Match& candidate : candidates) {
+            for (uint32_t id : owners[candidate.pattern_id]) {
+                if (matchesAt(text, text_length, candidate.position, id)) {
+                    matches.push_back({candidate.position, id});
+                }
+            }
+        }
+        std::sort(matches.begin() + first, matches.end());
+        matches.erase(std::unique(matches.begin() + first, matches.end(),
+                                  [](const Match& a, const Match& b) {
+                                      return a.position == b.position &&
+                                             a.pattern_id == b.pattern_id;
+                                  }),
+                      matches.end());
+    }
+}
+
+size_t UnicodeFoldMatcher::memoryUsage() const {
+    size_t bytes = sizeof(*this) + engine_name.capacity() + prefilter->memoryUsage();
+    for (const auto& key : keys) bytes += key.capacity() * sizeof(uint32_t);
+    for (const auto& owner : owners) bytes += owner.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+std::unique_ptr<PatternMatcher> compileFoldedLiterals(const std::vector<std::string>& patterns,
+                                                      const char* sample, size_t sample_length) {
+    if (std::none_of(patterns.begin(), patterns.end(), hasNonAscii)) {
+        return compileLiterals(patterns, true, sample, sample_length);
+    }
+    return std::make_unique<UnicodeFoldMatcher>(patterns);
+}
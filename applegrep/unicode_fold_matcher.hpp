@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pattern_matcher.hpp"
+
+// -i for literal patterns holding UTF-8: a match may differ from the pattern
+// in byte length ("k" and KELVIN SIGN are one and three bytes), so the SIMD
+// engines cannot fold it alone. Each pattern's first characters are expanded
+// into every case variant (a handful at most); the ASCII-folding literal
+// engine finds the variants and each candidate is verified one character at
+// a time against the rest of the pattern.
+class UnicodeFoldMatcher : public PatternMatcher {
+public:
+    explicit UnicodeFoldMatcher(const std::vector<std::string>& patterns);
+
+    const char* name() const override { return engine_name.c_str(); }
+
+    void findAll(const char* text, size_t text_length, size_t from, size_t to,
+                 std::vector<Match>& matches) const override;
+
+    size_t memoryUsage() const override;
+
+private:
+    // Whether patterns[pattern_id] matches at text[position]
+    bool matchesAt(const char* text, size_t text_length, size_t position,
+                   uint32_t pattern_id) const;
+
+    // Per pattern, one key per character: an ASCII character as kAsciiKey
+    // plus its folded byte, anything else as the smallest member of its orbit
+    std::vector<std::vector<uint32_t>> keys;
+    std::vector<std::vector<uint32_t>> owners;  // Patterns each variant starts
+    std::unique_ptr<PatternMatcher> prefilter;
+    std::string engine_name;
+};
+
+// compileLiterals() with -i: ASCII patterns fold inside the literal engines,
+// patterns holding other characters go through UnicodeFoldMatcher
+std::unique_ptr<PatternMatcher> compileFoldedLiterals(const std::vector<std::string>& patterns,
+                                                      const char* sample = nullptr,
+                                                      size_t sample_length = 0);
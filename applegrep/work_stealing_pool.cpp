@@ -0,0 +1,147 @@
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// The pool the current thread works for, and its deque there
+thread_local WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+// Victim selection only needs to spread thieves out, not be good randomness
+size_t randomIndex(size_t bound) {
+    thread_local uint64_t state =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return static_cast<size_t>(state % bound);
+}
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) {
+    // Outside threads only push and steal, so a pool without workers still
+    // has a deque to hold their tasks
+    for (size_t i = 0; i < std::max<size_t>(1, thread_count); ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+void WorkStealingPool::submit(TaskGroup& group, std::function<void()> task) {
+    group.pending.fetch_add(1);
+    Queue& queue = current_pool == this ? *queues[current_queue]
+                                        : *queues[next_queue.fetch_add(1) % queues.size()];
+    {
+        // Counted before it can be popped, so a thief's decrement never
+        // takes `queued` below zero
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queued.fetch_add(1);
+        queue.tasks.push_back({std::move(task), &group});
+    }
+    {
+        // Sleepers test `queued` under this mutex; taking it here means the
+        // notification cannot slip in between their test and their wait
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingPool::runOne() {
+    Task task;
+    bool found = false;
+    if (current_pool == this) {
+        Queue& own = *queues[current_queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+    if (!found) {
+        const size_t start = randomIndex(queues.size());
+        for (size_t i = 0; i < queues.size() && !found; ++i) {
+            Queue& victim = *queues[(start + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                found = true;
+            }
+        }
+    }
+    if (!found) return false;
+
+    queued.fetch_sub(1);
+    task.run();
+    finish(task);
+    return true;
+}
+
+void WorkStealingPool::finish(Task& task) {
+    release(*task.group);
+}
+
+void WorkStealingPool::hold(TaskGroup& group) {
+    group.pending.fetch_add(1);
+}
+
+void WorkStealingPool::release(TaskGroup& group) {
+    if (group.pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_all();
+    }
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    current_pool = this;
+    current_queue = index;
+    for (;;) {
+        if (runOne()) continue;
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
+
+void WorkStealingPool::wait(TaskGroup& group) {
+    while (group.pending.load() > 0) {
+        if (runOne()) continue;
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [&] { return group.pending.load() == 0 || queued.load() > 0; });
+    }
+}
+
+void WorkStealingPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    TaskGroup group;
+    std::function<void(size_t, size_t)> run_range = [&](size_t begin, size_t end) {
+        while (end - begin > 1) {
+            const size_t middle = begin + (end - begin) / 2;
+            submit(group, [&run_range, middle, end] { run_range(middle, end); });
+            end = middle;
+        }
+        task(begin);
+    };
+    if (count > 0) run_range(0, count);
+    wait(group);
+}
+
+WorkStealingPool& sharedPool() {
+    // The thread waiting on the pool runs tasks too and makes up the last core
+    static WorkStealingPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
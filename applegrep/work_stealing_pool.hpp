@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks submitted together; wait() returns once all of them have run
+struct TaskGroup {
+    std::atomic<size_t> pending{0};
+};
+
+// Fixed set of worker threads, one deque of tasks each. A worker pushes the
+// tasks it spawns onto its own deque and pops them back LIFO (the most
+// recent one is the smallest and still in cache); idle workers steal the
+// oldest task from a randomly chosen victim. Tasks spawned from outside the
+// pool are spread over the deques.
+//
+// Large jobs split themselves (see parallelFor), so "scan this file" and
+// "scan this chunk of a file" are tasks of the same kind and one huge input
+// is cut up dynamically while small ones fill the gaps. A thread that
+// waits for a group runs queued tasks meanwhile, so tasks may wait for the
+// tasks they spawn.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t thread_count);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(TaskGroup& group, std::function<void()> task);
+
+    // Run queued tasks until every task of `group` has finished
+    void wait(TaskGroup& group);
+
+    // Keep wait(group) from returning until the matching release(), for a
+    // thread outside the pool that submits to the group as work turns up
+    void hold(TaskGroup& group);
+    void release(TaskGroup& group);
+
+    // task(0) .. task(count - 1), in parallel, returning when all are done.
+    // The index range is halved on demand: each task hands the upper half of
+    // its range to the pool until one index is left, so thieves take large
+    // pieces and the owner keeps working through its own in order.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    struct Task {
+        std::function<void()> run;
+        TaskGroup* group;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+
+    // Pop from the calling worker's own deque, else steal. False when every
+    // deque is empty.
+    bool runOne();
+    void finish(Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    // Idle workers and waiters sleep here until a task is queued or a group
+    // completes
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> next_queue{0};  // Round robin for outside submissions
+    bool stopping = false;
+};
+
+// The process-wide pool, one worker per core, created on first use
+WorkStealingPool& sharedPool();